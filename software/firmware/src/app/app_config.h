@@ -31,10 +31,16 @@
 
 #define EUI_LEN                                     6
 #define EUI_NAME_MAX_LEN                            16
+#define DEVICE_ID(_eui)                             ((uint16_t)((_eui)[0] | ((uint16_t)(_eui)[1] << 8)))
 
-#define MAX_NUM_RANGING_DEVICES                     10
-#define COMPRESSED_RANGE_DATUM_LENGTH               (1 + sizeof(int16_t))       // EUI + Range
+#define MAX_NUM_RANGING_DEVICES                     64
+#define MAX_NUM_EXPERIMENT_DEVICES                  10
+#ifndef RANGE_OUTPUT_QUALITY
+#define RANGE_OUTPUT_QUALITY                        0
+#endif
+#define COMPRESSED_RANGE_DATUM_LENGTH               (sizeof(uint16_t) + sizeof(int16_t) + (RANGE_OUTPUT_QUALITY ? sizeof(uint8_t) : 0))       // ID + Range [+ Quality]
 #define MAX_COMPRESSED_RANGE_DATA_LENGTH            (1 + (COMPRESSED_RANGE_DATUM_LENGTH * MAX_NUM_RANGING_DEVICES))
+#define MAX_TELEMETRY_DATA_LENGTH                   128
 
 #define STORAGE_QUEUE_MAX_NUM_ITEMS                 16
 
@@ -69,6 +75,7 @@ typedef enum { BATTERY_EMPTY = 3200, BATTERY_CRITICAL = 3500, BATTERY_NOMINAL =
 #define BLE_SCANNING_DURATION_MS                    10000
 
 #define BLE_DESIRED_MTU                             247
+#define BLE_MAX_NOTIFICATION_LENGTH                 (BLE_DESIRED_MTU - 3)
 #define BLE_TRANSACTION_TIMEOUT_S                   1
 #define BLE_MIN_CONNECTION_INTERVAL_1_25_MS         12          // 15 ms
 #define BLE_MAX_CONNECTION_INTERVAL_1_25_MS         24          // 30 ms
@@ -83,6 +90,7 @@ typedef enum { BATTERY_EMPTY = 3200, BATTERY_CRITICAL = 3500, BATTERY_NOMINAL =
 #define BLE_LIVE_STATS_FINDMYTOTTAG_CHAR            0x2e,0x5d,0x5e,0x39,0x31,0x52,0x45,0x0c,0x90,0xee,0x3f,0xa2,0x55,0x31,0x8c,0xd6
 #define BLE_LIVE_STATS_RANGING_CHAR                 0x2e,0x5d,0x5e,0x39,0x31,0x52,0x45,0x0c,0x90,0xee,0x3f,0xa2,0x56,0x31,0x8c,0xd6
 #define BLE_LIVE_STATS_ADDRESS_CHAR                 0x2e,0x5d,0x5e,0x39,0x31,0x52,0x45,0x0c,0x90,0xee,0x3f,0xa2,0x57,0x31,0x8c,0xd6
+#define BLE_LIVE_STATS_TELEMETRY_CHAR               0x2e,0x5d,0x5e,0x39,0x31,0x52,0x45,0x0c,0x90,0xee,0x3f,0xa2,0x59,0x31,0x8c,0xd6
 #define BLE_SCHEDULING_SERVICE_ID                   0x2e,0x5d,0x5e,0x39,0x31,0x52,0x45,0x0c,0x90,0xee,0x3f,0xa2,0x5A,0x31,0x8c,0xd6
 #define BLE_SCHEDULING_REQUEST_CHAR                 0x2e,0x5d,0x5e,0x39,0x31,0x52,0x45,0x0c,0x90,0xee,0x3f,0xa2,0x5B,0x31,0x8c,0xd6
 #define BLE_MAINTENANCE_SERVICE_ID                  0x2e,0x5d,0x5e,0x39,0x31,0x52,0x45,0x0c,0x90,0xee,0x3f,0xa2,0x60,0x31,0x8c,0xd6
@@ -94,35 +102,89 @@ typedef enum { BATTERY_EMPTY = 3200, BATTERY_CRITICAL = 3500, BATTERY_NOMINAL =
 // Ranging Protocol Configuration --------------------------------------------------------------------------------------
 
 #define RADIO_XMIT_CHANNEL                          9
+#define RADIO_NETWORK_CHANNELS                      { RADIO_XMIT_CHANNEL, 5 }
 #define NUM_ANTENNAS                                3
-#define RADIO_TX_PLUS_RX_DELAY                      32756           // TODO: FIGURE OUT THIS CORRECT VALUE
+#define RADIO_DEFAULT_TX_ANTENNA_DELAY              16378           // Used for every antenna and channel until calibrated
+#define RADIO_DEFAULT_RX_ANTENNA_DELAY              16378
+#define RADIO_TX_PLUS_RX_DELAY                      (RADIO_DEFAULT_TX_ANTENNA_DELAY + RADIO_DEFAULT_RX_ANTENNA_DELAY)
+#define RADIO_NUM_CALIBRATED_CHANNELS               2
+#define RANGE_BIAS_TABLE_STRONGEST_SIGNAL_DBM       (-61)
+#define RANGE_BIAS_TABLE_LENGTH                     34              // One entry per dB down to -94 dBm
 #define MIN_VALID_RANGE_MM                          (-1000)
 #define MAX_VALID_RANGE_MM                          (32*1000)
 
 #define SCHEDULING_INTERVAL_US                      1000000
-#define RADIO_WAKEUP_SAFETY_DELAY_US                5000
-#define RECEIVE_EARLY_START_US                      100
+#define SCHEDULING_INTERVAL_MOVING_US               200000
+#define SCHEDULING_INTERVAL_STILL_US                5000000
+#define SCHEDULING_INTERVAL_RESOLUTION_US           100000
+#define RADIO_WAKEUP_SAFETY_DELAY_US                5000            // Used until the radio wakeup latency has been measured
+#define RADIO_WAKEUP_GUARD_US                       250
+#define RADIO_MIN_SLEEP_TIME_US                     1000            // Shortest worthwhile sleep beyond the radio wakeup margin
+#define RECEIVE_EARLY_START_US                      60
+#define SYNCHRONIZATION_MIN_ROUNDS                  4
+#define RANGING_EVENT_QUEUE_LENGTH                  8
 
 #define DEVICE_TIMEOUT_SECONDS                      60
 #define NETWORK_SEARCH_TIME_SECONDS                 3
+#define NETWORK_SEARCH_SNIFF_ON_PACS                1
+#define NETWORK_SEARCH_SNIFF_OFF_US                 80
+#define NETWORK_SEARCH_WINDOW_US                    (RADIO_WAKEUP_SAFETY_DELAY_US + RADIO_MIN_SLEEP_TIME_US + (SCHEDULE_NUM_MASTER_BROADCASTS * SCHEDULE_RESEND_INTERVAL_US))
+#define NETWORK_SEARCH_WINDOWS_PER_SCAN             8
+#define NETWORK_SEARCH_MAX_NETWORKS                 4
+#define NETWORK_MERGE_SCAN_INTERVAL_ROUNDS          3
 #define MAX_EMPTY_ROUNDS_BEFORE_STATE_CHANGE        3
 
 #define SCHEDULE_XMIT_ANTENNA                       0
 #define SCHEDULE_NUM_TOTAL_BROADCASTS               5
 #define SCHEDULE_NUM_MASTER_BROADCASTS              2
 #define SCHEDULE_RESEND_INTERVAL_US                 1000
-#define SCHEDULE_BROADCAST_PERIOD_US                (SCHEDULE_NUM_TOTAL_BROADCASTS * SCHEDULE_RESEND_INTERVAL_US)
+#define SCHEDULE_MERGE_SLOT_US                      SCHEDULE_RESEND_INTERVAL_US
+#define SCHEDULE_MAX_ID_EXCEPTIONS                  31
+#define SCHEDULE_MERGE_TIMEOUT_US                   (200 + RECEIVE_EARLY_START_US)
+#define SCHEDULE_BROADCAST_PERIOD_US                ((SCHEDULE_NUM_TOTAL_BROADCASTS * SCHEDULE_RESEND_INTERVAL_US) + SCHEDULE_MERGE_SLOT_US)
+#ifndef SCHEDULE_FLOOD
+#define SCHEDULE_FLOOD                              0
+#endif
 
 #define RANGING_NUM_SEQUENCES                       NUM_ANTENNAS
 #define RANGING_BROADCAST_INTERVAL_US               1000
 #define RANGING_TIMEOUT_US                          (100 + RECEIVE_EARLY_START_US)
-#define RANGING_NUM_PACKETS_PER_ITERATION           ((3 * NUM_ANTENNAS) + NUM_ANTENNAS)
+#define RANGING_NUM_PACKETS_PER_SEQUENCE            4
+#define RANGING_NUM_PACKETS_PER_SS_SEQUENCE         2
+#define RANGING_NUM_PACKETS_PER_ITERATION           (RANGING_NUM_PACKETS_PER_SEQUENCE * NUM_ANTENNAS)
 #define RANGING_ITERATION_INTERVAL_US               (RANGING_BROADCAST_INTERVAL_US * RANGING_NUM_PACKETS_PER_ITERATION)
+#ifndef RANGING_NUM_ADAPTIVE_ANTENNAS
+#define RANGING_NUM_ADAPTIVE_ANTENNAS               NUM_ANTENNAS
+#endif
+#define RANGING_ANTENNA_REPROBE_INTERVAL_ROUNDS     10
+#define RANGING_BROADCAST_NUM_CYCLES                2
+#ifndef RANGING_MODE
+#define RANGING_MODE                                RANGING_MODE_PAIRWISE
+#endif
 
 #define RANGE_STATUS_XMIT_ANTENNA                   0
 #define RANGE_STATUS_NUM_TOTAL_BROADCASTS           4
 #define RANGE_STATUS_RESEND_INTERVAL_US             1000
 #define RANGE_STATUS_BROADCAST_PERIOD_US            (RANGE_STATUS_NUM_TOTAL_BROADCASTS * RANGE_STATUS_RESEND_INTERVAL_US)
 #define RANGE_STATUS_TIMEOUT_US                     (RANGE_STATUS_BROADCAST_PERIOD_US - 900 + RECEIVE_EARLY_START_US)
+#ifndef RANGE_STATUS_PIGGYBACK
+#define RANGE_STATUS_PIGGYBACK                      0
+#endif
+#define RANGE_STATUS_BITMAP_LENGTH                  (MAX_NUM_RANGING_DEVICES / 4)
+
+#define RANGE_FILTER_PROCESS_NOISE_MM2_PER_S        250000      // (0.5 m)^2 of peer movement per second
+#define RANGE_FILTER_MEASUREMENT_NOISE_MM2          22500       // (150 mm)^2 at strong signal levels
+#define RANGE_FILTER_STRONG_SIGNAL_DBM              (-80)
+#define RANGE_FILTER_NOISE_DOUBLING_DB              6
+#define RANGE_FILTER_GATE_SIGMAS                    3
+#define RANGE_FILTER_MAX_REJECTIONS                 3
+#define RANGE_NLOS_INDICATOR_THRESHOLD_DB           6
+#define RANGE_NLOS_VARIANCE_FACTOR                  4
+#ifndef RANGE_OUTPUT_CHANGES_ONLY
+#define RANGE_OUTPUT_CHANGES_ONLY                   0
+#endif
+#define RANGE_OUTPUT_CHANGE_THRESHOLD_MM            100
+
+#define TELEMETRY_STORAGE_INTERVAL_ROUNDS           60
 
 #endif  // #ifndef __APP_CONFIG_HEADER_H__
@@ -8,7 +8,7 @@
 
 // Peripheral Type Definitions -----------------------------------------------------------------------------------------
 
-typedef void (*ble_discovery_callback_t)(const uint8_t ble_address[6], uint8_t ranging_role);
+typedef void (*ble_discovery_callback_t)(const uint8_t ble_address[6], uint8_t ranging_role, uint8_t ranging_channel);
 
 
 // Public API Functions ------------------------------------------------------------------------------------------------
@@ -20,8 +20,10 @@ bool bluetooth_is_initialized(void);
 void bluetooth_register_discovery_callback(ble_discovery_callback_t callback);
 uint8_t bluetooth_get_current_ranging_role(void);
 void bluetooth_set_current_ranging_role(uint8_t ranging_role);
+void bluetooth_set_current_ranging_channel(uint8_t ranging_channel);
 void bluetooth_join_ranging_network(const uint8_t *ble_address, const uint8_t *requesting_address);
 void bluetooth_write_range_results(const uint8_t *results, uint16_t results_length);
+void bluetooth_write_telemetry(const uint8_t *telemetry, uint16_t telemetry_length);
 void bluetooth_start_advertising(void);
 void bluetooth_stop_advertising(void);
 bool bluetooth_is_advertising(void);
@@ -0,0 +1,19 @@
+#ifndef __RANGE_BIAS_HEADER_H__
+#define __RANGE_BIAS_HEADER_H__
+
+// Default Range Bias Table --------------------------------------------------------------------------------------------
+
+// Range bias in meters at signal levels from -61 dBm down to -94 dBm, which applies to every device until it has been
+//   calibrated, expanded into an array initializer using the supplied meters-to-DWT-ticks conversion macro
+#define DEFAULT_RANGE_BIAS_TABLE(_to_ticks) {                                       \
+   _to_ticks(-0.110), _to_ticks(-0.110), _to_ticks(-0.105), _to_ticks(-0.105),      \
+   _to_ticks(-0.100), _to_ticks(-0.100), _to_ticks(-0.093), _to_ticks(-0.093),      \
+   _to_ticks(-0.082), _to_ticks(-0.082), _to_ticks(-0.069), _to_ticks(-0.069),      \
+   _to_ticks(-0.051), _to_ticks(-0.051), _to_ticks(-0.027), _to_ticks(-0.027),      \
+   _to_ticks(0.0), _to_ticks(0.0), _to_ticks(0.021), _to_ticks(0.021),              \
+   _to_ticks(0.035), _to_ticks(0.035), _to_ticks(0.042), _to_ticks(0.042),          \
+   _to_ticks(0.049), _to_ticks(0.049), _to_ticks(0.062), _to_ticks(0.062),          \
+   _to_ticks(0.071), _to_ticks(0.071), _to_ticks(0.076), _to_ticks(0.076),          \
+   _to_ticks(0.081), _to_ticks(0.081) }
+
+#endif  // #ifndef __RANGE_BIAS_HEADER_H__
@@ -3,7 +3,7 @@
 
 // Header Inclusions ---------------------------------------------------------------------------------------------------
 
-#include "app_config.h"
+#include "app_tasks.h"
 #include "deca_device_api.h"
 
 
@@ -12,12 +12,18 @@
 #define DO_NOT_CHANGE_FLAG                                  UINT8_MAX
 #define SPEED_OF_LIGHT                                      299711693.79        // In air @ 22C, 101.325kPa, 50% RH
 #define MODULE_PANID                                        0x6611
+#define BROADCAST_PANID                                     0xFFFF
+#define NETWORK_PANID(_master_id)                           ((((_master_id) == BROADCAST_PANID) || ((_master_id) == MODULE_PANID)) ? (uint16_t)((_master_id) ^ 0x0100) : (uint16_t)(_master_id))
+#define DW_TIMESTAMP_MASK                                   0x000000FFFFFFFFFFULL
 
 #define APP_US_TO_DEVICETIMEU64(_microsecu)                 ((uint64_t)(((_microsecu) / DWT_TIME_UNITS) / 1000000.0))
 #define APP_DEVICETIMEU64_TO_US(_dw_units)                  ((uint32_t)(((_dw_units) * DWT_TIME_UNITS) * 1000000.0))
 #define DW_DELAY_FROM_US(_us)                               ((uint32_t)(APP_US_TO_DEVICETIMEU64((_us)) >> 8))
 #define US_DELAY_FROM_DW(_dwt)                              (APP_DEVICETIMEU64_TO_US(((uint64_t)(_dwt)) << 8))
 #define DW_TIMEOUT_FROM_US(_us)                             ((uint32_t)((_us) / (512.0 / 499.2)))
+#define RADIO_SPI_ASYNC_MIN_LENGTH                          64                  // Shorter transfers block instead of using DMA
+
+typedef void (*ranging_radio_spi_callback_t)(void *context, bool success);
 
 
 // Data structures for 802.15.4 packets --------------------------------------------------------------------------------
@@ -44,15 +50,20 @@ void ranging_radio_deinit(void);
 void ranging_radio_reset(void);
 void ranging_radio_register_callbacks(dwt_cb_t tx_done, dwt_cb_t rx_done, dwt_cb_t rx_timeout, dwt_cb_t rx_err);
 void ranging_radio_choose_channel(uint8_t channel);
+uint8_t ranging_radio_get_channel(void);
+void ranging_radio_choose_pan_id(uint16_t pan_id);
+void ranging_radio_set_packet_pan_id(ieee154_header_t *header);
 void ranging_radio_choose_antenna(uint8_t antenna_number);
+void ranging_radio_load_calibration(const calibration_details_t *calibration);
+uint32_t ranging_radio_get_antenna_delay(void);
 void ranging_radio_disable(void);
 void ranging_radio_sleep(bool deep_sleep);
 void ranging_radio_wakeup(void);
 bool ranging_radio_rxenable(int mode);
+void ranging_radio_readrxdata_async(uint8_t *buffer, uint16_t length, ranging_radio_spi_callback_t callback, void *context);
 uint64_t ranging_radio_readrxtimestamp(void);
 uint64_t ranging_radio_readtxtimestamp(void);
-float ranging_radio_received_signal_level(void);
+uint64_t ranging_radio_readrxdiagnostics(float *signal_level_dbm, float *nlos_indicator_db);
 uint64_t ranging_radio_compute_correction_for_signal_level(float signal_level_dbm);
-int ranging_radio_time_to_millimeters(double dwtime);
 
 #endif  // #ifndef __RANGING_HEADER_H__
@@ -26,6 +26,8 @@ void storage_deinit(void);
 void storage_disable(bool disable);
 void storage_store_experiment_details(const experiment_details_t *details);
 void storage_retrieve_experiment_details(experiment_details_t *details);
+bool storage_store_calibration_details(const calibration_details_t *details);
+bool storage_retrieve_calibration_details(calibration_details_t *details);
 void storage_store(const void *data, uint32_t data_length);
 void storage_flush(bool write_partial_pages);
 void storage_begin_reading(void);
@@ -20,12 +20,12 @@
 // Static Global Variables ---------------------------------------------------------------------------------------------
 
 static volatile uint16_t connection_mtu;
-static volatile bool is_scanning, is_advertising, is_connected, ranges_requested, quick_scanning;
+static volatile bool is_scanning, is_advertising, is_connected, ranges_requested, telemetry_requested, quick_scanning;
 static volatile bool data_requested, expected_scanning, expected_advertising, is_initialized;
 static const char adv_local_name[] = { 'T', 'o', 't', 'T', 'a', 'g' };
 static const uint8_t adv_data_flags[] = { DM_FLAG_LE_GENERAL_DISC | DM_FLAG_LE_BREDR_NOT_SUP };
 static uint8_t adv_data_conn[HCI_ADV_DATA_LEN], scan_data_conn[HCI_ADV_DATA_LEN];
-static uint8_t current_ranging_role[] = { BLUETOOTH_COMPANY_ID, 0x00 };
+static uint8_t current_ranging_role[] = { BLUETOOTH_COMPANY_ID, 0x00, 0x00 };
 static uint8_t device_id[EUI_LEN], requesting_id[EUI_LEN];
 static ble_discovery_callback_t discovery_callback;
 
@@ -62,6 +62,7 @@ enum
 {
    TOTTAG_GATT_SERVICE_CHANGED_CCC_IDX,
    TOTTAG_RANGING_CCC_IDX,
+   TOTTAG_TELEMETRY_CCC_IDX,
    TOTTAG_MAINTENANCE_RESULT_CCC_IDX,
    TOTTAG_NUM_CCC_CHARACTERISTICS
 };
@@ -70,6 +71,7 @@ static const attsCccSet_t characteristicSet[TOTTAG_NUM_CCC_CHARACTERISTICS] =
 {
    { GATT_SERVICE_CHANGED_CCC_HANDLE,  ATT_CLIENT_CFG_INDICATE,  DM_SEC_LEVEL_NONE },
    { RANGES_CCC_HANDLE,                  ATT_CLIENT_CFG_NOTIFY,  DM_SEC_LEVEL_NONE },
+   { TELEMETRY_CCC_HANDLE,               ATT_CLIENT_CFG_NOTIFY,  DM_SEC_LEVEL_NONE },
    { MAINTENANCE_RESULT_CCC_HANDLE,      ATT_CLIENT_CFG_NOTIFY,  DM_SEC_LEVEL_NONE }
 };
 
@@ -155,7 +157,7 @@ static void deviceManagerCallback(dmEvt_t *pDmEvt)
          break;
       case DM_CONN_CLOSE_IND:
          print("TotTag BLE: deviceManagerCallback: Received DM_CONN_CLOSE_IND\n");
-         is_connected = ranges_requested = data_requested = quick_scanning = false;
+         is_connected = ranges_requested = telemetry_requested = data_requested = quick_scanning = false;
          AttsCccClearTable(pDmEvt->hdr.param);
          break;
       case DM_ADV_START_IND:
@@ -189,7 +191,7 @@ static void deviceManagerCallback(dmEvt_t *pDmEvt)
                   pDmEvt->scanReport.addr[5], pDmEvt->scanReport.addr[4], pDmEvt->scanReport.addr[3],
                   pDmEvt->scanReport.addr[2], pDmEvt->scanReport.addr[1], pDmEvt->scanReport.addr[0], pDmEvt->scanReport.rssi);
             if (discovery_callback)
-               discovery_callback(pDmEvt->scanReport.addr, rangingRoleData[4]);
+               discovery_callback(pDmEvt->scanReport.addr, rangingRoleData[4], rangingRoleData[5]);
          }
          break;
       }
@@ -220,6 +222,8 @@ static void attProtocolCallback(attEvt_t *pEvt)
          print("TotTag BLE: attProtocolCallback: Data Notify Completed = %u\n", (uint32_t)pEvt->hdr.status);
          if ((pEvt->hdr.status == ATT_SUCCESS) && (pEvt->handle == MAINTENANCE_RESULT_HANDLE) && data_requested)
             continueSendingLogData((dmConnId_t)pEvt->hdr.param, connection_mtu - 3);
+         else if ((pEvt->hdr.status == ATT_SUCCESS) && (pEvt->handle == RANGES_HANDLE) && ranges_requested)
+            continueSendingRangeResults((dmConnId_t)pEvt->hdr.param, connection_mtu - 3);
          break;
       default:
          print("TotTag BLE: attProtocolCallback: Received Event ID %d\n", pEvt->hdr.event);
@@ -233,6 +237,8 @@ static void cccCallback(attsCccEvt_t *pEvt)
    print("TotTag BLE: cccCallback: index = %d, handle = %d, value = %d\n", pEvt->idx, pEvt->handle, pEvt->value);
    if (pEvt->idx == TOTTAG_RANGING_CCC_IDX)
       ranges_requested = (pEvt->value == ATT_CLIENT_CFG_NOTIFY);
+   else if (pEvt->idx == TOTTAG_TELEMETRY_CCC_IDX)
+      telemetry_requested = (pEvt->value == ATT_CLIENT_CFG_NOTIFY);
    else if (pEvt->idx == TOTTAG_MAINTENANCE_RESULT_CCC_IDX)
       data_requested = (pEvt->value == ATT_CLIENT_CFG_NOTIFY);
 }
@@ -244,7 +250,7 @@ void bluetooth_init(uint8_t* uid)
 {
    // Initialize static variables
    data_requested = expected_scanning = expected_advertising = is_initialized = false;
-   is_scanning = is_advertising = is_connected = ranges_requested = quick_scanning = false;
+   is_scanning = is_advertising = is_connected = ranges_requested = telemetry_requested = quick_scanning = false;
    memcpy(device_id, uid, EUI_LEN);
    discovery_callback = NULL;
 
@@ -331,6 +337,17 @@ void bluetooth_set_current_ranging_role(uint8_t ranging_role)
    AppAdvStop();
 }
 
+void bluetooth_set_current_ranging_channel(uint8_t ranging_channel)
+{
+   // Update the UWB channel of the current ranging network in the BLE advertisements
+   if (current_ranging_role[3] != ranging_channel)
+   {
+      current_ranging_role[3] = ranging_channel;
+      AppAdvSetAdValue(APP_ADV_DATA_CONNECTABLE, DM_ADV_TYPE_MANUFACTURER, sizeof(current_ranging_role), (uint8_t*)current_ranging_role);
+      AppAdvStop();
+   }
+}
+
 void bluetooth_join_ranging_network(const uint8_t *ble_address, const uint8_t *requesting_address)
 {
    // Attempt to connect to the peer device
@@ -345,7 +362,14 @@ void bluetooth_write_range_results(const uint8_t *results, uint16_t results_leng
 {
    // Update the current set of ranging data
    if (ranges_requested)
-      updateRangeResults(AppConnIsOpen(), results, results_length);
+      updateRangeResults(AppConnIsOpen(), results, results_length, connection_mtu - 3);
+}
+
+void bluetooth_write_telemetry(const uint8_t *telemetry, uint16_t telemetry_length)
+{
+   // Update the current ranging protocol telemetry
+   if (telemetry_requested)
+      updateTelemetry(AppConnIsOpen(), telemetry, telemetry_length);
 }
 
 void bluetooth_start_advertising(void)
@@ -82,11 +82,16 @@ void print_reset_reason(const am_hal_reset_status_t* reason)
    print("\n");
 }
 
-void print_ranges(uint32_t timestamp, const uint8_t* range_data, uint32_t range_data_length)
+void print_ranges(uint32_t timestamp, uint16_t timestamp_ms, const uint8_t* range_data, uint32_t range_data_length)
 {
-   print("%u ranges @ Timestamp %u:\n", range_data[0], timestamp);
+   print("%u ranges @ Timestamp %u.%03u:\n", range_data[0], timestamp, (uint32_t)timestamp_ms);
    for (uint8_t i = 0; i < range_data[0]; ++i)
-      print("   Range to 0x%02X: %d\n", range_data[1 + (i*COMPRESSED_RANGE_DATUM_LENGTH)], (int32_t)(*((int16_t*)(range_data + 2 + (i*COMPRESSED_RANGE_DATUM_LENGTH)))));
+#if RANGE_OUTPUT_QUALITY
+      print("   Range to 0x%04X: %d (LOS sequences: %u, NLOS indicator: %u dB)\n", (uint32_t)DEVICE_ID(range_data + 1 + (i*COMPRESSED_RANGE_DATUM_LENGTH)), (int32_t)(*((int16_t*)(range_data + 3 + (i*COMPRESSED_RANGE_DATUM_LENGTH)))),
+            (uint32_t)(range_data[5 + (i*COMPRESSED_RANGE_DATUM_LENGTH)] >> 6), (uint32_t)(range_data[5 + (i*COMPRESSED_RANGE_DATUM_LENGTH)] & 0x3F));
+#else
+      print("   Range to 0x%04X: %d\n", (uint32_t)DEVICE_ID(range_data + 1 + (i*COMPRESSED_RANGE_DATUM_LENGTH)), (int32_t)(*((int16_t*)(range_data + 3 + (i*COMPRESSED_RANGE_DATUM_LENGTH)))));
+#endif
 }
 
 #endif
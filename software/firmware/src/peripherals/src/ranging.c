@@ -1,18 +1,58 @@
 // Header Inclusions ---------------------------------------------------------------------------------------------------
 
-#include <math.h>
 #include "deca_interface.h"
 #include "logging.h"
+#include "range_bias.h"
 #include "ranging.h"
 
 
+// Chip-Specific Definitions -------------------------------------------------------------------------------------------
+
+#define DW_RX_BUFFER_0_READ_HEADER                  0x24        // Short-addressed read of register file 0x12
+#define DW_CIA_DIAGNOSTICS_READ_HEADER              0x18        // Short-addressed read of register file 0x0C
+#define DW_DGC_DBG_READ_HEADER                      { 0x47, 0x80 }  // Full-addressed read of register 0x03:0x60
+#define DW_CIA_IP_TOA_OFFSET                        0x00
+#define DW_CIA_IP_DIAG_1_OFFSET                     0x2C        // Ipatov channel area (CIR power)
+#define DW_CIA_IP_DIAG_2_OFFSET                     0x30        // Ipatov first path amplitude F1
+#define DW_CIA_IP_DIAG_3_OFFSET                     0x34        // Ipatov first path amplitude F2
+#define DW_CIA_IP_DIAG_4_OFFSET                     0x38        // Ipatov first path amplitude F3
+#define DW_CIA_IP_DIAG_12_OFFSET                    0x58        // Ipatov accumulated symbol count
+#define DW_CIA_DIAGNOSTICS_LENGTH                   (DW_CIA_IP_DIAG_12_OFFSET + sizeof(uint32_t))
+#define RADIO_SPI_COMMAND_QUEUE_LENGTH              64
+
+#define DB_PER_OCTAVE_Q16                           197283      // 10*log10(2) in Q16
+#define DB_Q8_OF_POWER_OF_TWO(_exponent)            ((int32_t)((((_exponent) * DB_PER_OCTAVE_Q16) + 128) >> 8))
+#define RSSI_CONSTANT_A_Q8                          31155       // 121.7 dB in Q8
+#define CALIBRATION_CHANNEL_INDEX(_channel)         (((_channel) == 5) ? 0 : 1)
+#define RANGE_BIAS_TICKS(_meters)                   ((int8_t)((_meters) / (SPEED_OF_LIGHT * DWT_TIME_UNITS)))
+
+#define _RADIO_SPI_ISR(_module)                     am_iomaster ## _module ## _isr
+#define RADIO_SPI_ISR(_module)                      _RADIO_SPI_ISR(_module)
+
+
 // Static Global Variables ---------------------------------------------------------------------------------------------
 
 static void *spi_handle;
+static uint32_t spi_command_queue[RADIO_SPI_COMMAND_QUEUE_LENGTH];
+static SemaphoreHandle_t spi_transfer_complete;
+static ranging_radio_spi_callback_t spi_transfer_callback;
+static void *spi_transfer_callback_context;
+static volatile bool spi_transfer_pending;
 static dwt_config_t dw_config;
 static const dwt_txconfig_t tx_config_ch5 = { 0x34, 0xFDFDFDFD, 0x0 }, tx_config_ch9 = { 0x34, 0xFEFEFEFE, 0x0 };
 static volatile bool spi_ready;
 static uint8_t eui64_array[8];
+static uint16_t pan_id = MODULE_PANID;
+static uint8_t current_antenna;
+static uint32_t antenna_delays[RADIO_NUM_CALIBRATED_CHANNELS][NUM_ANTENNAS];
+static int32_t range_corrections[RADIO_NUM_CALIBRATED_CHANNELS][NUM_ANTENNAS][RANGE_BIAS_TABLE_LENGTH];
+
+// Range bias applied to every device until it has been calibrated, shared with the offline calibration tool
+static const int8_t default_range_bias[RANGE_BIAS_TABLE_LENGTH] = DEFAULT_RANGE_BIAS_TABLE(RANGE_BIAS_TICKS);
+
+// Q8 values of 10*log10(1 + (i + 0.5) / 32), indexed by the 5 bits following the leading one of a value
+static const uint16_t db_mantissa_q8[32] = { 17, 51, 84, 115, 146, 176, 206, 234, 262, 289, 315, 341, 367, 391, 415, 439,
+   462, 485, 507, 529, 550, 571, 592, 612, 632, 652, 671, 690, 708, 726, 744, 762 };
 
 
 // Private Helper Functions --------------------------------------------------------------------------------------------
@@ -38,20 +78,116 @@ static void ranging_radio_spi_slow(void)
 {
    static const am_hal_iom_config_t spi_slow_config = {
       .eInterfaceMode = AM_HAL_IOM_SPI_MODE, .ui32ClockFreq = AM_HAL_IOM_6MHZ, .eSpiMode = AM_HAL_IOM_SPI_MODE_0,
-      .pNBTxnBuf = NULL, .ui32NBTxnBufLength = 0 };
+      .pNBTxnBuf = spi_command_queue, .ui32NBTxnBufLength = RADIO_SPI_COMMAND_QUEUE_LENGTH };
    am_hal_iom_power_ctrl(spi_handle, AM_HAL_SYSCTRL_WAKE, false);
    am_hal_iom_configure(spi_handle, &spi_slow_config);
    am_hal_iom_enable(spi_handle);
+   am_hal_iom_interrupt_enable(spi_handle, AM_HAL_IOM_INT_CMDCMP | AM_HAL_IOM_INT_DCMP | AM_HAL_IOM_INT_DERR | AM_HAL_IOM_INT_ERR);
 }
 
 static void ranging_radio_spi_fast(void)
 {
    static const am_hal_iom_config_t spi_fast_config = {
       .eInterfaceMode = AM_HAL_IOM_SPI_MODE, .ui32ClockFreq = AM_HAL_IOM_24MHZ, .eSpiMode = AM_HAL_IOM_SPI_MODE_0,
-      .pNBTxnBuf = NULL, .ui32NBTxnBufLength = 0 };
+      .pNBTxnBuf = spi_command_queue, .ui32NBTxnBufLength = RADIO_SPI_COMMAND_QUEUE_LENGTH };
    am_hal_iom_power_ctrl(spi_handle, AM_HAL_SYSCTRL_WAKE, false);
    am_hal_iom_configure(spi_handle, &spi_fast_config);
    am_hal_iom_enable(spi_handle);
+   am_hal_iom_interrupt_enable(spi_handle, AM_HAL_IOM_INT_CMDCMP | AM_HAL_IOM_INT_DCMP | AM_HAL_IOM_INT_DERR | AM_HAL_IOM_INT_ERR);
+}
+
+static void ranging_radio_spi_service(void)
+{
+   // Hand any completed non-blocking transfer to the IOM driver, which invokes its completion callback
+   uint32_t interrupt_status;
+   am_hal_iom_interrupt_status_get(spi_handle, false, &interrupt_status);
+   if (interrupt_status)
+   {
+      am_hal_iom_interrupt_clear(spi_handle, interrupt_status);
+      am_hal_iom_interrupt_service(spi_handle, interrupt_status);
+   }
+}
+
+static void ranging_radio_spi_wait(void)
+{
+   // Service a pending non-blocking transfer directly, which works from any interrupt priority
+   while (spi_transfer_pending)
+   {
+      const uint32_t interrupt_state = am_hal_interrupt_master_disable();
+      ranging_radio_spi_service();
+      am_hal_interrupt_master_set(interrupt_state);
+   }
+}
+
+static void ranging_radio_spi_transfer_done(void *context, uint32_t transaction_status)
+{
+   // Free the SPI bus before handing the completed transfer back to its owner
+   const ranging_radio_spi_callback_t callback = spi_transfer_callback;
+   spi_transfer_pending = false;
+   if (callback)
+      callback(spi_transfer_callback_context, transaction_status == AM_HAL_STATUS_SUCCESS);
+}
+
+static bool ranging_radio_spi_start(am_hal_iom_transfer_t *transaction, ranging_radio_spi_callback_t callback, void *context)
+{
+   // Queue the transfer for the IOM DMA engine, which only ever holds a single outstanding radio transfer, claiming the
+   //   bus atomically so that a radio interrupt cannot start its own transfer in between and lose its completion callback
+   while (true)
+   {
+      const uint32_t interrupt_state = am_hal_interrupt_master_disable();
+      if (!spi_transfer_pending)
+      {
+         spi_transfer_callback = callback;
+         spi_transfer_callback_context = context;
+         spi_transfer_pending = true;
+         spi_transfer_pending = (am_hal_iom_nonblocking_transfer(spi_handle, transaction, ranging_radio_spi_transfer_done, NULL) == AM_HAL_STATUS_SUCCESS);
+         am_hal_interrupt_master_set(interrupt_state);
+         return spi_transfer_pending;
+      }
+
+      // Service the transfer which currently owns the bus before trying again
+      ranging_radio_spi_service();
+      am_hal_interrupt_master_set(interrupt_state);
+   }
+}
+
+static void ranging_radio_spi_blocking_transfer(am_hal_iom_transfer_t *transaction)
+{
+   // Repeat the transfer until it succeeds, only starting it while no non-blocking transfer owns the bus
+   bool success = false;
+   while (!success)
+   {
+      const uint32_t interrupt_state = am_hal_interrupt_master_disable();
+      if (spi_transfer_pending)
+         ranging_radio_spi_service();
+      else
+         success = (am_hal_iom_blocking_transfer(spi_handle, transaction) == AM_HAL_STATUS_SUCCESS);
+      am_hal_interrupt_master_set(interrupt_state);
+   }
+}
+
+static void ranging_radio_spi_wake_task(void *context, bool success)
+{
+   // Wake the task sleeping on a long SPI transfer
+   BaseType_t xHigherPriorityTaskWoken = pdFALSE;
+   xSemaphoreGiveFromISR(spi_transfer_complete, &xHigherPriorityTaskWoken);
+   portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+}
+
+static bool ranging_radio_spi_can_sleep(uint32_t length)
+{
+   // Only long transfers from a task with interrupts enabled are worth sleeping on
+   return (length >= RADIO_SPI_ASYNC_MIN_LENGTH) && !xPortIsInsideInterrupt() && !__get_PRIMASK() &&
+          (xTaskGetSchedulerState() == taskSCHEDULER_RUNNING);
+}
+
+static void ranging_radio_spi_transfer(am_hal_iom_transfer_t *transaction)
+{
+   // Let the CPU sleep or run other tasks while long transfers complete in the background
+   if (ranging_radio_spi_can_sleep(transaction->ui32NumBytes) && ranging_radio_spi_start(transaction, ranging_radio_spi_wake_task, NULL))
+      xSemaphoreTake(spi_transfer_complete, portMAX_DELAY);
+   else
+      ranging_radio_spi_blocking_transfer(transaction);
 }
 
 static int readfromspi(uint16_t headerLength, uint8_t *headerBuffer, uint16_t readLength, uint8_t *readBuffer)
@@ -74,9 +210,7 @@ static int readfromspi(uint16_t headerLength, uint8_t *headerBuffer, uint16_t re
       .ui32PauseCondition           = 0,
       .ui32StatusSetClr             = 0
    };
-
-   // Repeat the transfer until it succeeds
-   while (am_hal_iom_blocking_transfer(spi_handle, &read_transaction) != AM_HAL_STATUS_SUCCESS);
+   ranging_radio_spi_transfer(&read_transaction);
    return 0;
 }
 
@@ -100,12 +234,25 @@ static int writetospi(uint16_t headerLength, const uint8_t *headerBuffer, uint16
       .ui32PauseCondition           = 0,
       .ui32StatusSetClr             = 0
    };
-
-   // Repeat the transfer until it succeeds
-   while (am_hal_iom_blocking_transfer(spi_handle, &write_transaction) != AM_HAL_STATUS_SUCCESS);
+   ranging_radio_spi_transfer(&write_transaction);
    return 0;
 }
 
+static int32_t value_to_db_q8(uint64_t value)
+{
+   // Compute 10*log10(value) in Q8 from the position of the leading one and the bits following it, treating 0 as 1
+   if (!value)
+      return 0;
+   const uint32_t exponent = 63 - __builtin_clzll(value);
+   const uint32_t mantissa = (exponent >= 5) ? (uint32_t)(value >> (exponent - 5)) : (uint32_t)(value << (5 - exponent));
+   return DB_Q8_OF_POWER_OF_TWO(exponent) + db_mantissa_q8[mantissa & 0x1F];
+}
+
+static uint32_t read_uint32(const uint8_t *buffer)
+{
+   return (uint32_t)buffer[0] | ((uint32_t)buffer[1] << 8) | ((uint32_t)buffer[2] << 16) | ((uint32_t)buffer[3] << 24);
+}
+
 static void wakeup_device_with_io(void)
 {
    // Assert the WAKEUP pin for >=500us
@@ -127,12 +274,24 @@ void deca_sleep(unsigned int time_ms) { am_hal_delay_us(time_ms * 1000); }
 void deca_usleep(unsigned long time_us) { am_hal_delay_us(time_us); }
 
 
+// Interrupt Service Routines ------------------------------------------------------------------------------------------
+
+void RADIO_SPI_ISR(RADIO_SPI_NUMBER)(void)
+{
+   // Complete any finished non-blocking radio transfers without being preempted by the higher-priority radio interrupt,
+   //   which services the same transfers itself whenever it needs the bus
+   const uint32_t interrupt_state = am_hal_interrupt_master_disable();
+   ranging_radio_spi_service();
+   am_hal_interrupt_master_set(interrupt_state);
+}
+
+
 // Public API Functions ------------------------------------------------------------------------------------------------
 
 void ranging_radio_init(uint8_t *uid)
 {
    // Convert the device UID into the necessary 64-bit EUI format
-   spi_ready = false;
+   spi_ready = spi_transfer_pending = false;
    eui64_array[0] = uid[0]; eui64_array[1] = uid[1]; eui64_array[2] = uid[2];
    eui64_array[3] = 0xFE; eui64_array[4] = 0xFF;
    eui64_array[5] = uid[3]; eui64_array[6] = uid[4]; eui64_array[7] = uid[5];
@@ -203,6 +362,25 @@ void ranging_radio_init(uint8_t *uid)
    configASSERT0(am_hal_gpio_pinconfig(PIN_RADIO_SPI_CS, cs_config));
    ranging_radio_spi_fast();
 
+   // Set up SPI completion interrupts for non-blocking transfers below the priority of the radio interrupt so that
+   //   radio events are always timestamped first
+   if (!spi_transfer_complete)
+      spi_transfer_complete = xSemaphoreCreateBinary();
+   configASSERT1(spi_transfer_complete != NULL);
+   NVIC_SetPriority((IRQn_Type)(IOMSTR0_IRQn + RADIO_SPI_NUMBER), NVIC_configMAX_SYSCALL_INTERRUPT_PRIORITY + 1);
+   NVIC_EnableIRQ((IRQn_Type)(IOMSTR0_IRQn + RADIO_SPI_NUMBER));
+
+   // Apply the default antenna delays and range bias until a device-specific calibration is loaded
+   calibration_details_t default_calibration;
+   for (uint8_t channel = 0; channel < RADIO_NUM_CALIBRATED_CHANNELS; ++channel)
+      for (uint8_t antenna = 0; antenna < NUM_ANTENNAS; ++antenna)
+      {
+         default_calibration.antennas[channel][antenna].tx_antenna_delay = RADIO_DEFAULT_TX_ANTENNA_DELAY;
+         default_calibration.antennas[channel][antenna].rx_antenna_delay = RADIO_DEFAULT_RX_ANTENNA_DELAY;
+         memcpy(default_calibration.antennas[channel][antenna].range_bias, default_range_bias, sizeof(default_range_bias));
+      }
+   ranging_radio_load_calibration(&default_calibration);
+
    // Reset and initialize the DW3000 radio
    ranging_radio_reset();
    dwt_setcallbacks(NULL, NULL, NULL, NULL, NULL, ranging_radio_spi_ready, NULL);
@@ -212,6 +390,8 @@ void ranging_radio_deinit(void)
 {
    // Ensure that the radio is in deep sleep mode and disable all SPI communications
    ranging_radio_sleep(true);
+   ranging_radio_spi_wait();
+   NVIC_DisableIRQ((IRQn_Type)(IOMSTR0_IRQn + RADIO_SPI_NUMBER));
    while (am_hal_iom_disable(spi_handle) != AM_HAL_STATUS_SUCCESS);
    am_hal_iom_uninitialize(spi_handle);
 
@@ -235,9 +415,10 @@ void ranging_radio_reset(void)
       am_hal_delay_us(2000);
    configASSERT0(dwt_initialise(DWT_DW_IDLE));
 
-   // Set up the DW3000 interrupts and overall configuration
-   dw_config = (dwt_config_t){ .chan = 9, .txPreambLength = DW_PREAMBLE_LENGTH, .rxPAC = DW_PAC_SIZE,
-      .txCode = 9, .rxCode = 9, .sfdType = DWT_SFD_IEEE_4Z, .dataRate = DW_DATA_RATE, .phrMode = DWT_PHRMODE_STD,
+   // Set up the DW3000 interrupts and overall configuration, keeping any previously chosen channel
+   const uint8_t channel = dw_config.chan ? dw_config.chan : RADIO_XMIT_CHANNEL;
+   dw_config = (dwt_config_t){ .chan = channel, .txPreambLength = DW_PREAMBLE_LENGTH, .rxPAC = DW_PAC_SIZE,
+      .txCode = 9, .rxCode = 9, .sfdType = DWT_SFD_IEEE_4Z, .dataRate = DW_DATA_RATE, .phrMode = DWT_PHRMODE_EXT,
       .phrRate = DWT_PHRRATE_DTA, .sfdTO = DW_SFD_TO, .stsMode = DWT_STS_MODE_OFF, .stsLength = DWT_STS_LEN_32,
       .pdoaMode = DWT_PDOA_M0 };
    configASSERT0(dwt_configure(&dw_config));
@@ -247,12 +428,12 @@ void ranging_radio_reset(void)
          DWT_INT_RXPTO_BIT_MASK | DWT_INT_RXSTO_BIT_MASK | DWT_INT_ARFE_BIT_MASK  |
          DWT_INT_SPIRDY_BIT_MASK, 0, DWT_ENABLE_INT_ONLY);
    dwt_writesysstatuslo(DWT_INT_RCINIT_BIT_MASK | DWT_INT_SPIRDY_BIT_MASK);
-   dwt_configuretxrf((dwt_txconfig_t*)&tx_config_ch9);
+   dwt_configuretxrf((dwt_txconfig_t*)((channel == 5) ? &tx_config_ch5 : &tx_config_ch9));
    dwt_configciadiag(DW_CIA_DIAG_LOG_ALL);
-   dwt_configmrxlut(9);
+   dwt_configmrxlut(channel);
 
    // Set this node's PAN ID and EUI
-   dwt_setpanid(MODULE_PANID);
+   dwt_setpanid(pan_id);
    dwt_seteui(eui64_array);
 
    // Disable double-buffer mode, receive timeouts, and auto-ack mode
@@ -263,7 +444,7 @@ void ranging_radio_reset(void)
    // Set this device so that it only receives regular and extended data packets
    dwt_configureframefilter(DWT_FF_ENABLE_802_15_4, DWT_FF_DATA_EN);
 
-   // Clear the internal TX/RX antenna delays
+   // Clear the internal TX/RX antenna delays, which are instead removed in software per antenna and channel
    dwt_settxantennadelay(0);
    dwt_setrxantennadelay(0);
 }
@@ -290,9 +471,30 @@ void ranging_radio_choose_channel(uint8_t channel)
    }
 }
 
+uint8_t ranging_radio_get_channel(void)
+{
+   return dw_config.chan;
+}
+
+void ranging_radio_choose_pan_id(uint16_t new_pan_id)
+{
+   // Only accept packets addressed to the specified PAN or to the broadcast PAN
+   if (pan_id != new_pan_id)
+      dwt_setpanid(pan_id = new_pan_id);
+}
+
+void ranging_radio_set_packet_pan_id(ieee154_header_t *header)
+{
+   // Address an outgoing packet to the current PAN
+   header->panID[0] = (uint8_t)(pan_id & 0xFF);
+   header->panID[1] = (uint8_t)(pan_id >> 8);
+}
+
 void ranging_radio_choose_antenna(uint8_t antenna_number)
 {
    // Enable the desired antenna
+   if (antenna_number < NUM_ANTENNAS)
+      current_antenna = antenna_number;
 #if REVISION_ID < REVISION_L
    switch (antenna_number)
    {
@@ -314,6 +516,26 @@ void ranging_radio_choose_antenna(uint8_t antenna_number)
 #endif
 }
 
+void ranging_radio_load_calibration(const calibration_details_t *calibration)
+{
+   // Precompute the range correction at every signal level for each antenna and channel, which also removes any
+   //   deviation of the calibrated antenna delays from the nominal delays assumed when computing ranges
+   for (uint8_t channel = 0; channel < RADIO_NUM_CALIBRATED_CHANNELS; ++channel)
+      for (uint8_t antenna = 0; antenna < NUM_ANTENNAS; ++antenna)
+      {
+         const antenna_calibration_t *antenna_calibration = &calibration->antennas[channel][antenna];
+         antenna_delays[channel][antenna] = (uint32_t)antenna_calibration->tx_antenna_delay + antenna_calibration->rx_antenna_delay;
+         const int32_t delay_deviation = (int32_t)antenna_delays[channel][antenna] - RADIO_TX_PLUS_RX_DELAY;
+         for (uint8_t i = 0; i < RANGE_BIAS_TABLE_LENGTH; ++i)
+            range_corrections[channel][antenna][i] = antenna_calibration->range_bias[i] + delay_deviation;
+      }
+}
+
+uint32_t ranging_radio_get_antenna_delay(void)
+{
+   return antenna_delays[CALIBRATION_CHANNEL_INDEX(dw_config.chan)][current_antenna];
+}
+
 void ranging_radio_disable(void)
 {
    // Turn off the radio
@@ -368,6 +590,38 @@ bool ranging_radio_rxenable(int mode)
    return (dwt_rxenable(mode) == DWT_SUCCESS);
 }
 
+void ranging_radio_readrxdata_async(uint8_t *buffer, uint16_t length, ranging_radio_spi_callback_t callback, void *context)
+{
+   // Read short packets immediately since queuing them would cost more than the transfer itself
+   if (length < RADIO_SPI_ASYNC_MIN_LENGTH)
+   {
+      dwt_readrxdata(buffer, length, 0);
+      callback(context, true);
+      return;
+   }
+
+   // Stream the RX buffer from its start using DMA and notify the caller from the SPI interrupt
+   am_hal_iom_transfer_t read_transaction = {
+      .uPeerInfo.ui32SpiChipSelect  = 0,
+      .ui32InstrLen                 = 1,
+      .ui64Instr                    = DW_RX_BUFFER_0_READ_HEADER,
+      .eDirection                   = AM_HAL_IOM_RX,
+      .ui32NumBytes                 = length,
+      .pui32TxBuffer                = NULL,
+      .pui32RxBuffer                = (uint32_t*)buffer,
+      .bContinue                    = false,
+      .ui8RepeatCount               = 0,
+      .ui8Priority                  = 1,
+      .ui32PauseCondition           = 0,
+      .ui32StatusSetClr             = 0
+   };
+   if (!ranging_radio_spi_start(&read_transaction, callback, context))
+   {
+      dwt_readrxdata(buffer, length, 0);
+      callback(context, true);
+   }
+}
+
 uint64_t ranging_radio_readrxtimestamp(void)
 {
    // Read the current DW3000 RX timestamp
@@ -384,79 +638,39 @@ uint64_t ranging_radio_readtxtimestamp(void)
    return cur_dw_timestamp;
 }
 
-float ranging_radio_received_signal_level(void)
+uint64_t ranging_radio_readrxdiagnostics(float *signal_level_dbm, float *nlos_indicator_db)
 {
-   // Read the current RX diagnostics and compute the signal level in dBm
-   static dwt_nlos_alldiag_t diagnostics;
-   dwt_nlos_alldiag(&diagnostics);
-   const float F1 = 0.25f * (float)diagnostics.F1, F2 = 0.25f * (float)diagnostics.F2, F3 = 0.25f * (float)diagnostics.F3;
-   const float N = (float)diagnostics.accumCount, D = (float)diagnostics.D, A = 121.7f;
-   return (10.0f * log10f((F1*F1 + F2*F2 + F3*F3) / (N*N))) + (6.0f * D) - A;
+   // Burst-read the Ipatov timestamp and first-path diagnostics from the CIA register file, followed by the DGC decision,
+   //   where the Ipatov timestamp equals the adjusted RX timestamp since the RX antenna delay is kept at zero
+   static uint8_t cia_registers[DW_CIA_DIAGNOSTICS_LENGTH], dgc_register[sizeof(uint32_t)];
+   uint8_t cia_header = DW_CIA_DIAGNOSTICS_READ_HEADER, dgc_header[] = DW_DGC_DBG_READ_HEADER;
+   readfromspi(sizeof(cia_header), &cia_header, sizeof(cia_registers), cia_registers);
+   readfromspi(sizeof(dgc_header), dgc_header, sizeof(dgc_register), dgc_register);
+   uint64_t rx_timestamp = 0;
+   memcpy(&rx_timestamp, cia_registers + DW_CIA_IP_TOA_OFFSET, 5);
+
+   // Compute the first-path power F1^2 + F2^2 + F3^2 from amplitudes with 2 fractional bits, which is scaled by 2^4
+   const uint64_t F1 = read_uint32(cia_registers + DW_CIA_IP_DIAG_2_OFFSET) & 0x003FFFFF;
+   const uint64_t F2 = read_uint32(cia_registers + DW_CIA_IP_DIAG_3_OFFSET) & 0x003FFFFF;
+   const uint64_t F3 = read_uint32(cia_registers + DW_CIA_IP_DIAG_4_OFFSET) & 0x003FFFFF;
+   const uint32_t N = read_uint32(cia_registers + DW_CIA_IP_DIAG_12_OFFSET) & 0x00000FFF;
+   const uint32_t cir_power = read_uint32(cia_registers + DW_CIA_IP_DIAG_1_OFFSET) & 0x0001FFFF;
+   const uint32_t D = (read_uint32(dgc_register) >> 28) & 0x07;
+   const uint64_t first_path_power_x16 = (F1 * F1) + (F2 * F2) + (F3 * F3);
+   const int32_t first_path_power_db_q8 = value_to_db_q8(first_path_power_x16) - DB_Q8_OF_POWER_OF_TWO(4);
+
+   // Report how far the total received power, scaled by 2^21, exceeds the first-path power, which grows when the direct
+   //   path is obstructed and most energy arrives over reflections
+   const bool has_reflections = first_path_power_x16 && (((uint64_t)cir_power << 25) > first_path_power_x16);
+   *nlos_indicator_db = has_reflections ? ((float)(value_to_db_q8(cir_power) + DB_Q8_OF_POWER_OF_TWO(21) - first_path_power_db_q8) * (1.0f / 256.0f)) : 0.0f;
+   *signal_level_dbm = (float)(first_path_power_db_q8 - (2 * value_to_db_q8(N)) + (int32_t)(6 * 256 * D) - RSSI_CONSTANT_A_Q8) * (1.0f / 256.0f);
+   return rx_timestamp;
 }
 
 uint64_t ranging_radio_compute_correction_for_signal_level(float signal_level_dbm)
 {
-   const uint32_t signal_level_inverted = (uint32_t)(-signal_level_dbm);
-   switch (signal_level_inverted)
-   {
-      case 61:
-      case 62:
-         return (uint64_t)(-0.110f / (SPEED_OF_LIGHT * DWT_TIME_UNITS));
-      case 63:
-      case 64:
-         return (uint64_t)(-0.105f / (SPEED_OF_LIGHT * DWT_TIME_UNITS));
-      case 65:
-      case 66:
-         return (uint64_t)(-0.100f / (SPEED_OF_LIGHT * DWT_TIME_UNITS));
-      case 67:
-      case 68:
-         return (uint64_t)(-0.093f / (SPEED_OF_LIGHT * DWT_TIME_UNITS));
-      case 69:
-      case 70:
-         return (uint64_t)(-0.082f / (SPEED_OF_LIGHT * DWT_TIME_UNITS));
-      case 71:
-      case 72:
-         return (uint64_t)(-0.069f / (SPEED_OF_LIGHT * DWT_TIME_UNITS));
-      case 73:
-      case 74:
-         return (uint64_t)(-0.051f / (SPEED_OF_LIGHT * DWT_TIME_UNITS));
-      case 75:
-      case 76:
-         return (uint64_t)(-0.027f / (SPEED_OF_LIGHT * DWT_TIME_UNITS));
-      case 77:
-      case 78:
-         return 0;
-      case 79:
-      case 80:
-         return (uint64_t)(0.021f / (SPEED_OF_LIGHT * DWT_TIME_UNITS));
-      case 81:
-      case 82:
-         return (uint64_t)(0.035f / (SPEED_OF_LIGHT * DWT_TIME_UNITS));
-      case 83:
-      case 84:
-         return (uint64_t)(0.042f / (SPEED_OF_LIGHT * DWT_TIME_UNITS));
-      case 85:
-      case 86:
-         return (uint64_t)(0.049f / (SPEED_OF_LIGHT * DWT_TIME_UNITS));
-      case 87:
-      case 88:
-         return (uint64_t)(0.062f / (SPEED_OF_LIGHT * DWT_TIME_UNITS));
-      case 89:
-      case 90:
-         return (uint64_t)(0.071f / (SPEED_OF_LIGHT * DWT_TIME_UNITS));
-      case 91:
-      case 92:
-         return (uint64_t)(0.076f / (SPEED_OF_LIGHT * DWT_TIME_UNITS));
-      case 93:
-      case 94:
-         return (uint64_t)(0.081f / (SPEED_OF_LIGHT * DWT_TIME_UNITS));
-      default:
-         return (signal_level_inverted < 61) ? (uint64_t)(-0.11f / (SPEED_OF_LIGHT * DWT_TIME_UNITS)) :
-                                               (uint64_t)(0.081f / (SPEED_OF_LIGHT * DWT_TIME_UNITS));
-   }
-}
-
-int ranging_radio_time_to_millimeters(double dwtime)
-{
-   return (int)((dwtime - RADIO_TX_PLUS_RX_DELAY) * SPEED_OF_LIGHT * DWT_TIME_UNITS * 1000.0);
+   // Look up the precomputed correction for the current antenna and channel, clamping signal levels to the table range
+   int32_t index = (int32_t)(-signal_level_dbm) + RANGE_BIAS_TABLE_STRONGEST_SIGNAL_DBM;
+   index = (index < 0) ? 0 : (index >= RANGE_BIAS_TABLE_LENGTH) ? (RANGE_BIAS_TABLE_LENGTH - 1) : index;
+   return (uint64_t)(int64_t)range_corrections[CALIBRATION_CHANNEL_INDEX(dw_config.chan)][current_antenna][index];
 }
@@ -42,6 +42,14 @@
 #define BBM_NUM_RESERVED_BLOCKS                     40
 #define BBM_LUT_BASE_ADDRESS                        ((MEMORY_BLOCK_COUNT - BBM_NUM_RESERVED_BLOCKS) * MEMORY_PAGES_PER_BLOCK)
 
+#define CALIBRATION_RECORD_VERSION                  1
+#define CALIBRATION_RECORD_VERSION_OFFSET           4
+#define CALIBRATION_RECORD_DETAILS_OFFSET           (CALIBRATION_RECORD_VERSION_OFFSET + 1)
+#define CALIBRATION_RECORD_CRC_OFFSET               (CALIBRATION_RECORD_DETAILS_OFFSET + sizeof(calibration_details_t))
+
+_Static_assert(BBM_NUM_RESERVED_BLOCKS > BBM_INTERNAL_LUT_NUM_ENTRIES, "No reserved block is guaranteed to remain free for calibration details");
+_Static_assert((CALIBRATION_RECORD_CRC_OFFSET + sizeof(uint32_t)) <= MEMORY_PAGE_SIZE_BYTES, "Calibration record does not fit into a memory page");
+
 
 // Helper Structures ---------------------------------------------------------------------------------------------------
 
@@ -53,7 +61,7 @@ typedef struct __attribute__ ((__packed__)) { uint16_t lba, pba; } bbm_lut_t;
 static void *spi_handle;
 static bbm_lut_t bad_block_lookup_table_internal[BBM_INTERNAL_LUT_NUM_ENTRIES];
 static uint8_t cache[2 * MEMORY_PAGE_SIZE_BYTES], transfer_buffer[MEMORY_PAGE_SIZE_BYTES];
-static uint32_t starting_page, current_page, reading_page, cache_index;
+static uint32_t starting_page, current_page, reading_page, cache_index, calibration_page;
 static bool is_reading, in_maintenance_mode, disabled;
 
 
@@ -192,12 +200,53 @@ static bool transfer_block(uint32_t source, uint32_t destination, uint32_t num_p
    return true;
 }
 
+static uint32_t compute_crc32(const uint8_t *data, uint32_t length)
+{
+   // Compute the standard reflected CRC-32 of the specified data
+   uint32_t crc = 0xFFFFFFFF;
+   for (uint32_t i = 0; i < length; ++i)
+   {
+      crc ^= data[i];
+      for (uint8_t bit = 0; bit < 8; ++bit)
+         crc = (crc >> 1) ^ (0xEDB88320 & (uint32_t)(-(int32_t)(crc & 1)));
+   }
+   return ~crc;
+}
+
+static bool is_replacement_block(uint16_t block)
+{
+   // Determine whether the bad block lookup table already redirects a bad block to the specified block
+   for (uint32_t i = 0; i < BBM_INTERNAL_LUT_NUM_ENTRIES; ++i)
+      if (bad_block_lookup_table_internal[i].pba == block)
+         return true;
+   return false;
+}
+
+static uint32_t find_calibration_page(void)
+{
+   // Store calibration details in the highest reserved block which is not already in use as a bad block replacement,
+   //   which remains the same across boots since replacements are only ever taken from below it afterward
+   uint16_t block = MEMORY_BLOCK_COUNT - 1;
+   while ((block > (MEMORY_BLOCK_COUNT - BBM_NUM_RESERVED_BLOCKS)) && is_replacement_block(block))
+      --block;
+   return (uint32_t)block * MEMORY_PAGES_PER_BLOCK;
+}
+
+static bool is_valid_calibration_record(const uint8_t *buffer)
+{
+   // Validate the magic number, format version, and checksum of a stored calibration record
+   uint32_t crc;
+   memcpy(&crc, buffer + CALIBRATION_RECORD_CRC_OFFSET, sizeof(crc));
+   return (memcmp(buffer, "CALI", 4) == 0) && (buffer[CALIBRATION_RECORD_VERSION_OFFSET] == CALIBRATION_RECORD_VERSION) &&
+          (crc == compute_crc32(buffer + CALIBRATION_RECORD_VERSION_OFFSET, CALIBRATION_RECORD_CRC_OFFSET - CALIBRATION_RECORD_VERSION_OFFSET));
+}
+
 static void add_bad_block(uint16_t block_address)
 {
-   // Find first available workaround block
+   // Find first available workaround block, never using the block reserved for calibration details
    uint16_t workaround_block = 0;
    for (uint32_t page = BBM_LUT_BASE_ADDRESS; !workaround_block && (page < MEMORY_PAGE_COUNT); page += MEMORY_PAGES_PER_BLOCK)
-      if (read_page(transfer_buffer, page) && (transfer_buffer[0] == 0xFF))
+      if ((page != calibration_page) && read_page(transfer_buffer, page) && (transfer_buffer[0] == 0xFF))
       {
          // Ensure that the candidate block is not already in use
          workaround_block = (uint16_t)((page & 0x0000FFC0) >> 6);
@@ -398,6 +447,7 @@ void storage_init(void)
       bad_block_lookup_table_internal[i].lba = (((bad_block_lookup_table_internal[i].lba << 8) & 0xFF00) | ((bad_block_lookup_table_internal[i].lba >> 8) & 0x00FF)) & 0x3FF;
       bad_block_lookup_table_internal[i].pba = (((bad_block_lookup_table_internal[i].pba << 8) & 0xFF00) | ((bad_block_lookup_table_internal[i].pba >> 8) & 0x00FF)) & 0x3FF;
    }
+   calibration_page = find_calibration_page();
 
    // Check for bad storage blocks if this is the first boot
    if (is_first_boot())
@@ -541,6 +591,51 @@ void storage_retrieve_experiment_details(experiment_details_t *details)
       am_hal_iom_power_ctrl(spi_handle, AM_HAL_SYSCTRL_DEEPSLEEP, true);
 }
 
+bool storage_store_calibration_details(const calibration_details_t *details)
+{
+   // Only store new calibration details in maintenance mode
+   if (!in_maintenance_mode)
+      return false;
+
+   // Write the versioned and checksummed calibration record, verifying it by reading it back
+   bool success = false;
+   for (uint8_t retry_index = 0; !success && (retry_index < MEMORY_NUM_BLOCK_ERRORS_BEFORE_REMOVAL); ++retry_index)
+   {
+      // Erase the reserved calibration block and disable memory page write protection
+      erase_block(calibration_page, calibration_page);
+      am_hal_gpio_output_set(PIN_STORAGE_WRITE_PROTECT);
+      write_register(STATUS_REGISTER_1, 0b00000010);
+
+      // Perform the write
+      memset(transfer_buffer, 0, sizeof(transfer_buffer));
+      memcpy(transfer_buffer, "CALI", 4);
+      transfer_buffer[CALIBRATION_RECORD_VERSION_OFFSET] = CALIBRATION_RECORD_VERSION;
+      memcpy(transfer_buffer + CALIBRATION_RECORD_DETAILS_OFFSET, details, sizeof(*details));
+      const uint32_t crc = compute_crc32(transfer_buffer + CALIBRATION_RECORD_VERSION_OFFSET, CALIBRATION_RECORD_CRC_OFFSET - CALIBRATION_RECORD_VERSION_OFFSET);
+      memcpy(transfer_buffer + CALIBRATION_RECORD_CRC_OFFSET, &crc, sizeof(crc));
+      success = write_page_raw(transfer_buffer, calibration_page) && read_page(transfer_buffer, calibration_page) &&
+                is_valid_calibration_record(transfer_buffer) && (memcmp(transfer_buffer + CALIBRATION_RECORD_DETAILS_OFFSET, details, sizeof(*details)) == 0);
+
+      // Re-enable memory page write protection
+      write_register(STATUS_REGISTER_1, 0b01111110);
+      am_hal_gpio_output_clear(PIN_STORAGE_WRITE_PROTECT);
+   }
+   return success;
+}
+
+bool storage_retrieve_calibration_details(calibration_details_t *details)
+{
+   // Retrieve calibration details if a valid record of the current format has been stored
+   if (!in_maintenance_mode)
+      am_hal_iom_power_ctrl(spi_handle, AM_HAL_SYSCTRL_WAKE, true);
+   const bool calibrated = read_page(transfer_buffer, calibration_page) && is_valid_calibration_record(transfer_buffer);
+   if (calibrated)
+      memcpy(details, transfer_buffer + CALIBRATION_RECORD_DETAILS_OFFSET, sizeof(*details));
+   if (!in_maintenance_mode)
+      am_hal_iom_power_ctrl(spi_handle, AM_HAL_SYSCTRL_DEEPSLEEP, true);
+   return calibrated;
+}
+
 void storage_store(const void *data, uint32_t data_length)
 {
    // Add new data to in-memory cache if not disabled
@@ -77,7 +77,7 @@ void am_rtc_isr(void)
    am_hal_rtc_alarm_get(NULL, &repeat_interval);
    am_hal_rtc_interrupt_clear(AM_HAL_RTC_INT_ALM);
    AM_CRITICAL_END
-   if (repeat_interval == AM_HAL_RTC_ALM_RPT_SEC)
+   if ((repeat_interval == AM_HAL_RTC_ALM_RPT_SEC) || (repeat_interval == AM_HAL_RTC_ALM_RPT_10TH))
       scheduler_rtc_isr();
 }
 
@@ -15,10 +15,10 @@
 
 // Static Global Variables ---------------------------------------------------------------------------------------------
 
-static uint8_t device_uid_short;
+static uint16_t device_uid_short;
 static TaskHandle_t app_task_handle = 0;
 static uint8_t device_id_to_schedule[EUI_LEN];
-static uint8_t discovered_devices[MAX_NUM_RANGING_DEVICES][1+EUI_LEN];
+static uint8_t discovered_devices[MAX_NUM_RANGING_DEVICES][2+EUI_LEN];
 static volatile bool devices_found, forwarding_request;
 static volatile uint32_t seconds_to_activate_buzzer;
 static volatile uint8_t num_discovered_devices;
@@ -31,9 +31,12 @@ static void verify_app_configuration(void)
    // Retrieve the current state of the application
    const bool is_scanning = bluetooth_is_scanning(), is_ranging = ranging_active();
 
-   // Advertised role should be UNKNOWN if not ranging
+   // Advertised role should be UNKNOWN without a network channel if not ranging
    if (!is_ranging && (bluetooth_get_current_ranging_role() != ROLE_UNKNOWN))
+   {
       bluetooth_set_current_ranging_role(ROLE_UNKNOWN);
+      bluetooth_set_current_ranging_channel(0);
+   }
 
    // Advertising should always be enabled
    if (!bluetooth_is_advertising())
@@ -46,6 +49,25 @@ static void verify_app_configuration(void)
       bluetooth_stop_scanning();
 }
 
+static uint8_t choose_network_channel(void)
+{
+   // Form a new network on the channel used by the fewest ranging devices heard nearby
+   static const uint8_t network_channels[] = RADIO_NETWORK_CHANNELS;
+   uint8_t best_channel = network_channels[0], best_channel_usage = UINT8_MAX;
+   for (uint8_t i = 0; i < sizeof(network_channels); ++i)
+   {
+      uint8_t channel_usage = 0;
+      for (uint8_t j = 0; j < num_discovered_devices; ++j)
+         channel_usage += (discovered_devices[j][EUI_LEN+1] == network_channels[i]);
+      if (channel_usage < best_channel_usage)
+      {
+         best_channel = network_channels[i];
+         best_channel_usage = channel_usage;
+      }
+   }
+   return best_channel;
+}
+
 static void handle_notification(app_notification_t notification)
 {
    // Handle the notification based on which bits are set
@@ -53,16 +75,20 @@ static void handle_notification(app_notification_t notification)
       verify_app_configuration();
    if ((notification & APP_NOTIFY_NETWORK_FOUND) != 0)
    {
-      // Determine if a master or participant device was located
+      // Determine if a master or participant device was located, along with the channel of its network
       bool master_device_located = false, participant_device_located = false;
+      uint8_t network_channel = 0;
       for (uint8_t i = 0; !master_device_located && (i < num_discovered_devices); ++i)
          switch (discovered_devices[i][EUI_LEN])
          {
             case ROLE_MASTER:
                master_device_located = true;
+               network_channel = discovered_devices[i][EUI_LEN+1];
                bluetooth_join_ranging_network(discovered_devices[i], NULL);
                break;
             case ROLE_PARTICIPANT:
+               if (!participant_device_located)
+                  network_channel = discovered_devices[i][EUI_LEN+1];
                participant_device_located = true;
                break;
             default:
@@ -72,15 +98,15 @@ static void handle_notification(app_notification_t notification)
       // Join the ranging network based on the state of the detected devices
       if (master_device_located)
       {
-         // Set our role as a ranging participant and start the ranging process
+         // Set our role as a ranging participant and start the ranging process on the channel of the network
          bluetooth_set_current_ranging_role(ROLE_PARTICIPANT);
-         ranging_begin(ROLE_PARTICIPANT);
+         ranging_begin(ROLE_PARTICIPANT, network_channel);
       }
       else if (participant_device_located)
       {
-         // Set our role as a ranging participant and start the ranging process
+         // Set our role as a ranging participant and start the ranging process on the channel of the network
          bluetooth_set_current_ranging_role(ROLE_PARTICIPANT);
-         ranging_begin(ROLE_PARTICIPANT);
+         ranging_begin(ROLE_PARTICIPANT, network_channel);
 
          // Send a request to join the network to all participant devices
          for (uint8_t i = 0; i < num_discovered_devices; ++i)
@@ -91,19 +117,19 @@ static void handle_notification(app_notification_t notification)
       {
          // Search for the non-sleeping device with the highest ID that is higher than our own
          int32_t best_device_idx = -1;
-         uint8_t highest_device_id = device_uid_short;
+         uint16_t highest_device_id = device_uid_short;
          for (uint8_t i = 0; i < num_discovered_devices; ++i)
-            if ((discovered_devices[i][EUI_LEN] != ROLE_ASLEEP) && (discovered_devices[i][0] > highest_device_id))
+            if ((discovered_devices[i][EUI_LEN] != ROLE_ASLEEP) && (DEVICE_ID(discovered_devices[i]) > highest_device_id))
             {
                best_device_idx = i;
-               highest_device_id = discovered_devices[i][0];
+               highest_device_id = DEVICE_ID(discovered_devices[i]);
             }
 
          // If a potential master candidate device was found, attempt to connect to it
          if (best_device_idx >= 0)
          {
-            // Set our role as a ranging participant and start the ranging process
-            ranging_begin(ROLE_PARTICIPANT);
+            // Set our role as a ranging participant and start the ranging process on whichever channel the candidate chooses
+            ranging_begin(ROLE_PARTICIPANT, 0);
             bluetooth_set_current_ranging_role(ROLE_PARTICIPANT);
             bluetooth_join_ranging_network(discovered_devices[best_device_idx], NULL);
          }
@@ -137,7 +163,7 @@ static void handle_notification(app_notification_t notification)
          if (!ranging_active())
          {
             role = ROLE_MASTER;
-            ranging_begin(ROLE_MASTER);
+            ranging_begin(ROLE_MASTER, choose_network_channel());
             bluetooth_set_current_ranging_role(ROLE_MASTER);
             verify_app_configuration();
          }
@@ -174,11 +200,12 @@ static void battery_event_handler(battery_event_t battery_event)
 
 static void motion_change_handler(bool in_motion)
 {
-   // Store the motion change to non-volatile memory
+   // Store the motion change to non-volatile memory and allow the ranging scheduler to adapt its round length
    storage_write_motion_status(in_motion);
+   ranging_update_motion_status(in_motion);
 }
 
-static void ble_discovery_handler(const uint8_t ble_address[EUI_LEN], uint8_t ranging_role)
+static void ble_discovery_handler(const uint8_t ble_address[EUI_LEN], uint8_t ranging_role, uint8_t ranging_channel)
 {
    // Keep track of all newly discovered devices
    if (!devices_found)
@@ -187,13 +214,15 @@ static void ble_discovery_handler(const uint8_t ble_address[EUI_LEN], uint8_t ra
       num_discovered_devices = 1;
       memcpy(discovered_devices[0], ble_address, EUI_LEN);
       discovered_devices[0][EUI_LEN] = ranging_role;
+      discovered_devices[0][EUI_LEN+1] = ranging_channel;
       if (!forwarding_request)
          am_hal_timer_clear(BLE_SCANNING_TIMER_NUMBER);
    }
    else if (num_discovered_devices < MAX_NUM_RANGING_DEVICES)
    {
       memcpy(discovered_devices[num_discovered_devices], ble_address, EUI_LEN);
-      discovered_devices[num_discovered_devices++][EUI_LEN] = ranging_role;
+      discovered_devices[num_discovered_devices][EUI_LEN] = ranging_role;
+      discovered_devices[num_discovered_devices++][EUI_LEN+1] = ranging_channel;
    }
 }
 
@@ -249,7 +278,7 @@ void app_activate_find_my_tottag(uint32_t seconds_to_activate)
 void AppTaskRanging(void *uid)
 {
    // Store the UID and application task handle
-   device_uid_short = ((uint8_t*)uid)[0];
+   device_uid_short = DEVICE_ID((uint8_t*)uid);
    app_task_handle = xTaskGetCurrentTaskHandle();
    uint32_t notification_bits = APP_NOTIFY_NETWORK_LOST;
 
@@ -36,8 +36,11 @@ void run_tasks(void)
    storage_init();
    system_enable_interrupts(true);
 
-   // Initialize the ranging radio and put it into deep sleep
+   // Initialize the ranging radio with any stored calibration and put it into deep sleep
+   calibration_details_t calibration;
    ranging_radio_init(uid);
+   if (storage_retrieve_calibration_details(&calibration))
+      ranging_radio_load_calibration(&calibration);
    ranging_radio_sleep(true);
 
    // Determine whether there is an active experiment taking place
@@ -23,10 +23,21 @@ typedef struct __attribute__ ((__packed__))
 {
    uint32_t experiment_start_time, experiment_end_time;
    uint32_t daily_start_time, daily_end_time;
-   uint8_t num_devices, uids[MAX_NUM_RANGING_DEVICES][EUI_LEN];
-   char uid_name_mappings[MAX_NUM_RANGING_DEVICES][EUI_NAME_MAX_LEN];
+   uint8_t num_devices, uids[MAX_NUM_EXPERIMENT_DEVICES][EUI_LEN];
+   char uid_name_mappings[MAX_NUM_EXPERIMENT_DEVICES][EUI_NAME_MAX_LEN];
 } experiment_details_t;
 
+typedef struct __attribute__ ((__packed__))
+{
+   uint16_t tx_antenna_delay, rx_antenna_delay;
+   int8_t range_bias[RANGE_BIAS_TABLE_LENGTH];
+} antenna_calibration_t;
+
+typedef struct __attribute__ ((__packed__))
+{
+   antenna_calibration_t antennas[RADIO_NUM_CALIBRATED_CHANNELS][NUM_ANTENNAS];
+} calibration_details_t;
+
 
 // Public API Functions ------------------------------------------------------------------------------------------------
 
@@ -36,17 +47,19 @@ void app_schedule_device(const uint8_t *uid);
 void app_activate_find_my_tottag(uint32_t seconds_to_activate);
 
 // Ranging Task Public Functions
-void ranging_begin(schedule_role_t role);
+void ranging_begin(schedule_role_t role, uint8_t channel);
 void ranging_end(void);
 bool ranging_active(void);
 void ranging_schedule_device(const uint8_t *device_id);
+void ranging_update_motion_status(bool in_motion);
 
 // Storage Task Public Functions
 void storage_flush_and_shutdown(void);
 void storage_write_battery_level(uint32_t battery_voltage_mV);
 void storage_write_charging_event(battery_event_t battery_event);
 void storage_write_motion_status(bool in_motion);
-void storage_write_ranging_data(uint32_t timestamp, const uint8_t *ranging_data, uint32_t ranging_data_len);
+void storage_write_ranging_data(uint32_t timestamp, uint16_t timestamp_ms, const uint8_t *ranging_data, uint32_t ranging_data_len);
+void storage_write_telemetry(uint32_t timestamp, const uint8_t *telemetry_data, uint32_t telemetry_data_len);
 
 // Main Task Functions
 void AppTaskRanging(void *uid);
@@ -10,6 +10,26 @@
 #include "system.h"
 
 
+// Static Global Variables ---------------------------------------------------------------------------------------------
+
+static uint8_t range_results[MAX_COMPRESSED_RANGE_DATA_LENGTH], range_notification[BLE_MAX_NOTIFICATION_LENGTH];
+static uint8_t ranges_sent;
+
+
+// Private Helper Functions --------------------------------------------------------------------------------------------
+
+static void sendRangeResults(dmConnId_t connId, uint16_t max_length)
+{
+   // Send the next ranges which fit into a single notification, prefixed by their own number of ranges
+   const uint16_t notification_length = (max_length < BLE_MAX_NOTIFICATION_LENGTH) ? max_length : BLE_MAX_NOTIFICATION_LENGTH;
+   const uint8_t max_num_ranges = (uint8_t)((notification_length - 1) / COMPRESSED_RANGE_DATUM_LENGTH);
+   range_notification[0] = ((range_results[0] - ranges_sent) < max_num_ranges) ? (range_results[0] - ranges_sent) : max_num_ranges;
+   memcpy(range_notification + 1, range_results + 1 + (ranges_sent * COMPRESSED_RANGE_DATUM_LENGTH), range_notification[0] * COMPRESSED_RANGE_DATUM_LENGTH);
+   ranges_sent += range_notification[0];
+   AttsHandleValueNtf(connId, RANGES_HANDLE, 1 + (range_notification[0] * COMPRESSED_RANGE_DATUM_LENGTH), range_notification);
+}
+
+
 // Public API ----------------------------------------------------------------------------------------------------------
 
 uint8_t handleLiveStatsRead(dmConnId_t connId, uint16_t handle, uint8_t operation, uint16_t offset, attsAttr_t *pAttr)
@@ -32,9 +52,27 @@ uint8_t handleLiveStatsWrite(dmConnId_t connId, uint16_t handle, uint8_t operati
    return ATT_SUCCESS;
 }
 
-void updateRangeResults(dmConnId_t connId, const uint8_t *results, uint16_t results_length)
+void updateRangeResults(dmConnId_t connId, const uint8_t *results, uint16_t results_length, uint16_t max_length)
+{
+   // Store the new ranging results and send as many as fit into the first notification
+   if (connId != DM_CONN_ID_NONE)
+   {
+      memcpy(range_results, results, results_length);
+      ranges_sent = 0;
+      sendRangeResults(connId, max_length);
+   }
+}
+
+void continueSendingRangeResults(dmConnId_t connId, uint16_t max_length)
+{
+   // Send the next part of the current ranging results once the previous notification has been transmitted
+   if (ranges_sent < range_results[0])
+      sendRangeResults(connId, max_length);
+}
+
+void updateTelemetry(dmConnId_t connId, const uint8_t *telemetry, uint16_t telemetry_length)
 {
-   // Update the BLE ranges characteristic
+   // Update the BLE ranging telemetry characteristic
    if (connId != DM_CONN_ID_NONE)
-      AttsHandleValueNtf(connId, RANGES_HANDLE, results_length, (uint8_t*)results);
+      AttsHandleValueNtf(connId, TELEMETRY_HANDLE, telemetry_length, (uint8_t*)telemetry);
 }
@@ -9,6 +9,9 @@
 
 // Live Statistics Services and Characteristics ------------------------------------------------------------------------
 
+_Static_assert((1 + COMPRESSED_RANGE_DATUM_LENGTH) <= BLE_MAX_NOTIFICATION_LENGTH, "A single range result does not fit into a BLE notification");
+_Static_assert(MAX_TELEMETRY_DATA_LENGTH <= BLE_MAX_NOTIFICATION_LENGTH, "Ranging telemetry does not fit into a BLE notification");
+
 static const uint8_t liveStatsService[] = { BLE_LIVE_STATS_SERVICE_ID };
 static const uint16_t liveStatsServiceLen = sizeof(liveStatsService);
 static const uint8_t battChUuid[] = { BLE_LIVE_STATS_BATTERY_CHAR };
@@ -41,6 +44,15 @@ static const uint8_t rangesDesc[] = "LiveRangingResults";
 static const uint16_t rangesDescLen = sizeof(rangesDesc);
 static uint8_t rangesCcc[] = { UINT16_TO_BYTES(0x0000) };
 static const uint16_t rangesCccLen = sizeof(rangesCcc);
+static const uint8_t telemetryChUuid[] = { BLE_LIVE_STATS_TELEMETRY_CHAR };
+static const uint8_t telemetryChar[] = { ATT_PROP_NOTIFY, UINT16_TO_BYTES(TELEMETRY_HANDLE), BLE_LIVE_STATS_TELEMETRY_CHAR };
+static const uint16_t telemetryCharLen = sizeof(telemetryChar);
+static uint8_t telemetry[] = { 0 };
+static const uint16_t telemetryLen = sizeof(telemetry);
+static const uint8_t telemetryDesc[] = "RangingTelemetry";
+static const uint16_t telemetryDescLen = sizeof(telemetryDesc);
+static uint8_t telemetryCcc[] = { UINT16_TO_BYTES(0x0000) };
+static const uint16_t telemetryCccLen = sizeof(telemetryCcc);
 
 static const attsAttr_t liveStatsList[] =
 {
@@ -155,6 +167,38 @@ static const attsAttr_t liveStatsList[] =
       sizeof(rangesCcc),
       ATTS_SET_CCC,
       (ATTS_PERMIT_READ | ATTS_PERMIT_WRITE)
+   },
+   {
+      attChUuid,
+      (uint8_t*)telemetryChar,
+      (uint16_t*)&telemetryCharLen,
+      sizeof(telemetryChar),
+      0,
+      ATTS_PERMIT_READ
+   },
+   {
+      telemetryChUuid,
+      (uint8_t*)telemetry,
+      (uint16_t*)&telemetryLen,
+      sizeof(telemetry),
+      (ATTS_SET_UUID_128 | ATTS_SET_VARIABLE_LEN),
+      0
+   },
+   {
+      attChUserDescUuid,
+      (uint8_t*)telemetryDesc,
+      (uint16_t*)&telemetryDescLen,
+      sizeof(telemetryDesc),
+      0,
+      ATTS_PERMIT_READ
+   },
+   {
+      attCliChCfgUuid,
+      (uint8_t*)telemetryCcc,
+      (uint16_t*)&telemetryCccLen,
+      sizeof(telemetryCcc),
+      ATTS_SET_CCC,
+      (ATTS_PERMIT_READ | ATTS_PERMIT_WRITE)
    }
 };
 
@@ -19,6 +19,10 @@ enum
    RANGES_HANDLE,                           // Current ranges
    RANGES_DESC_HANDLE,                      // Current ranges description
    RANGES_CCC_HANDLE,                       // Current ranges CCCD
+   TELEMETRY_CHAR_HANDLE,                   // Ranging telemetry characteristic
+   TELEMETRY_HANDLE,                        // Ranging telemetry
+   TELEMETRY_DESC_HANDLE,                   // Ranging telemetry description
+   TELEMETRY_CCC_HANDLE,                    // Ranging telemetry CCCD
    LIVE_STATS_MAX_HANDLE                    // Maximum live statistics handle
 };
 
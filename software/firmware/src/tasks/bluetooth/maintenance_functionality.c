@@ -6,6 +6,7 @@
 #include "logging.h"
 #include "maintenance_functionality.h"
 #include "maintenance_service.h"
+#include "ranging.h"
 #include "storage.h"
 
 
@@ -38,6 +39,21 @@ uint8_t handleDeviceMaintenanceWrite(dmConnId_t connId, uint16_t handle, uint8_t
             storage_store_experiment_details(&empty_details);
             break;
          }
+         case BLE_MAINTENANCE_LOAD_CALIBRATION:
+         {
+            // Only accept complete calibration records, and only apply them to the radio once they have been stored so
+            //   that the radio never runs with a calibration that would be lost on reboot, reporting any failure to the host
+            if (len != (1 + sizeof(calibration_details_t)))
+               return ATT_ERR_LENGTH;
+            const calibration_details_t* new_calibration = (const calibration_details_t*)(pValue + 1);
+            if (!storage_store_calibration_details(new_calibration))
+            {
+               print("ERROR: Unable to store the new calibration details\n");
+               return ATT_ERR_UNLIKELY;
+            }
+            ranging_radio_load_calibration(new_calibration);
+            break;
+         }
          case BLE_MAINTENANCE_DOWNLOAD_LOG:
             continueSendingLogData(connId, 0);
             break;
@@ -9,6 +9,8 @@
 
 // TotTag Maintenance Services and Characteristics ---------------------------------------------------------------------
 
+_Static_assert(sizeof(calibration_details_t) <= sizeof(experiment_details_t), "Calibration details do not fit into a maintenance command");
+
 static const uint8_t maintenanceService[] = { BLE_MAINTENANCE_SERVICE_ID };
 static const uint16_t maintenanceServiceLen = sizeof(maintenanceService);
 static const uint8_t experimentDetailsChUuid[] = { BLE_MAINTENANCE_EXPERIMENT_CHAR };
@@ -0,0 +1,223 @@
+// Header Inclusions ---------------------------------------------------------------------------------------------------
+
+#include "broadcast_phase.h"
+#include "computation_phase.h"
+#include "logging.h"
+#include "status_phase.h"
+#include "telemetry.h"
+#include "timing.h"
+
+
+// Static Global Variables ---------------------------------------------------------------------------------------------
+
+static scheduler_phase_t current_phase;
+static broadcast_packet_t broadcast_packet;
+static uint8_t scheduled_slot, total_num_slots, antenna_index;
+static uint16_t current_broadcast, total_num_broadcasts;
+static uint32_t tx_timestamps[RANGING_BROADCAST_NUM_CYCLES], rx_timestamps[RANGING_BROADCAST_NUM_CYCLES][MAX_NUM_RANGING_DEVICES];
+static uint32_t peer_tx_timestamps[MAX_NUM_RANGING_DEVICES], peer_rx_timestamps[MAX_NUM_RANGING_DEVICES];
+static uint64_t phase_start_timestamp;
+static int16_t master_clock_offset;
+
+
+// Private Helper Functions --------------------------------------------------------------------------------------------
+
+static uint32_t phase_time_to_delayed_time(uint32_t phase_time_us)
+{
+   // Convert a time relative to the start of the Ranging Phase on the master's clock into an absolute DW3000 delayed TX/RX time
+   return (uint32_t)((phase_start_timestamp + SYNCHRONIZED_US_TO_DW_TICKS(phase_time_us, master_clock_offset)) >> 8);
+}
+
+static void store_ranging_times(uint8_t peer_slot, const broadcast_packet_t *packet)
+{
+   // Gather the DS-TWR timestamps with the lower slot as initiator, using its first-cycle broadcast as the poll,
+   //   the first-cycle broadcast of the higher slot as the response, and its second-cycle broadcast as the final
+   uint32_t poll_tx, poll_rx, response_tx, response_rx, final_tx, final_rx;
+   if (scheduled_slot < peer_slot)
+   {
+      poll_tx = tx_timestamps[0];
+      poll_rx = peer_rx_timestamps[peer_slot];
+      response_tx = peer_tx_timestamps[peer_slot];
+      response_rx = rx_timestamps[0][peer_slot];
+      final_tx = tx_timestamps[1];
+      final_rx = packet->rx_timestamps[scheduled_slot];
+   }
+   else
+   {
+      poll_tx = peer_tx_timestamps[peer_slot];
+      poll_rx = rx_timestamps[0][peer_slot];
+      response_tx = tx_timestamps[0];
+      response_rx = packet->rx_timestamps[scheduled_slot];
+      final_tx = packet->tx_timestamp;
+      final_rx = rx_timestamps[1][peer_slot];
+   }
+
+   // Only store the round-trip and reply times if every packet in the exchange was received
+   if (poll_rx && response_rx && final_rx && poll_tx && response_tx && final_tx)
+      add_ranging_times(DEVICE_ID(packet->header.sourceAddr), antenna_index, response_rx - poll_tx, response_tx - poll_rx, final_rx - response_tx, final_tx - response_rx);
+}
+
+static scheduler_phase_t begin_current_broadcast(void)
+{
+   // Skip any broadcast slots which cannot be serviced in time
+   for (; current_broadcast < total_num_broadcasts; ++current_broadcast)
+   {
+      // Switch antennas and clear all stored timestamps at the start of each antenna sequence
+      const uint16_t broadcasts_per_sequence = RANGING_BROADCAST_NUM_CYCLES * total_num_slots;
+      const uint8_t cycle = (current_broadcast / total_num_slots) % RANGING_BROADCAST_NUM_CYCLES, slot = current_broadcast % total_num_slots;
+      if ((current_broadcast % broadcasts_per_sequence) == 0)
+      {
+         if (antenna_index != (current_broadcast / broadcasts_per_sequence))
+            ranging_radio_choose_antenna(antenna_index = current_broadcast / broadcasts_per_sequence);
+         memset(tx_timestamps, 0, sizeof(tx_timestamps));
+         memset(rx_timestamps, 0, sizeof(rx_timestamps));
+         memset(peer_tx_timestamps, 0, sizeof(peer_tx_timestamps));
+         memset(peer_rx_timestamps, 0, sizeof(peer_rx_timestamps));
+      }
+
+      // Transmit during our own slot or listen for the device scheduled in the current slot
+      const uint32_t delayed_time = phase_time_to_delayed_time((uint32_t)current_broadcast * RANGING_BROADCAST_INTERVAL_US);
+      if (slot == scheduled_slot)
+      {
+         // Report the latest reception from every other device: earlier slots from this cycle and later slots from the previous cycle
+         for (uint8_t i = 0; i < total_num_slots; ++i)
+            broadcast_packet.rx_timestamps[i] = (i < slot) ? rx_timestamps[cycle][i] : (cycle ? rx_timestamps[cycle - 1][i] : 0);
+
+         // Delayed transmissions ignore the lowest bit of the delayed time, making the TX timestamp known in advance
+         const uint16_t packet_size = sizeof(broadcast_packet_t) - sizeof(broadcast_packet.rx_timestamps) + ((uint16_t)total_num_slots * sizeof(broadcast_packet.rx_timestamps[0]));
+         broadcast_packet.header.seqNum = (uint8_t)(current_broadcast % broadcasts_per_sequence);
+#if RANGE_STATUS_PIGGYBACK
+         memcpy(broadcast_packet.device_statuses, status_phase_get_device_statuses(), sizeof(broadcast_packet.device_statuses));
+#endif
+         broadcast_packet.tx_timestamp = tx_timestamps[cycle] = (uint32_t)((uint64_t)(delayed_time & 0xFFFFFFFE) << 8);
+         dwt_writetxfctrl(packet_size, 0, 1);
+         dwt_writetxdata(packet_size, (uint8_t*)&broadcast_packet, 0);
+         dwt_setdelayedtrxtime(delayed_time);
+         if (dwt_starttx(DWT_START_TX_DELAYED) == DWT_SUCCESS)
+            return RANGING_PHASE;
+         telemetry_record_tx_failure();
+         print("ERROR: Failed to transmit RANGING BROADCAST packet in slot %u\n", (uint32_t)current_broadcast);
+      }
+      else
+      {
+         dwt_setdelayedtrxtime(delayed_time - US_TO_DW_DELAY(RECEIVE_EARLY_START_US));
+         if (ranging_radio_rxenable(DWT_START_RX_DELAYED))
+            return RANGING_PHASE;
+         print("ERROR: Unable to start listening for RANGING BROADCAST packet in slot %u\n", (uint32_t)current_broadcast);
+      }
+   }
+
+   // Move to the Status Phase once all broadcast slots have been handled
+   current_phase = RANGE_STATUS_PHASE;
+   return status_phase_begin(scheduled_slot, total_num_slots, (phase_start_timestamp + SYNCHRONIZED_US_TO_DW_TICKS(broadcast_phase_get_duration_us(), master_clock_offset)) & DW_TIMESTAMP_MASK, master_clock_offset);
+}
+
+
+// Public functions ----------------------------------------------------------------------------------------------------
+
+void broadcast_phase_initialize(const uint8_t *uid)
+{
+   // Initialize all Broadcast Ranging Phase parameters
+   broadcast_packet = (broadcast_packet_t){ .header = { .frameCtrl = { 0x41, 0x98 }, .seqNum = 0,
+         .panID = { MODULE_PANID & 0xFF, MODULE_PANID >> 8 }, .destAddr = { 0xFF, 0xFF }, .sourceAddr = { 0 } },
+      .message_type = RANGING_BROADCAST_PACKET, .tx_timestamp = 0, .rx_timestamps = { 0 }, .footer = { { 0 } } };
+   memcpy(broadcast_packet.header.sourceAddr, uid, sizeof(broadcast_packet.header.sourceAddr));
+   scheduled_slot = 0xFF;
+   total_num_broadcasts = 0;
+}
+
+scheduler_phase_t broadcast_phase_begin(uint8_t ranging_slot, uint8_t num_slots, uint64_t reference_timestamp, uint32_t start_delay_us, int16_t clock_offset)
+{
+   // Ensure there are at least two devices to begin ranging
+   reset_computation_phase();
+   total_num_broadcasts = 0;
+   if (num_slots < 2)
+      return RANGE_COMPUTATION_PHASE;
+
+   // Reset the necessary Broadcast Ranging Phase parameters
+   current_phase = RANGING_PHASE;
+   scheduled_slot = ranging_slot;
+   total_num_slots = num_slots;
+   current_broadcast = 0;
+   total_num_broadcasts = (uint16_t)(broadcast_phase_get_required_duration_us(num_slots) / RANGING_BROADCAST_INTERVAL_US);
+   master_clock_offset = clock_offset;
+   phase_start_timestamp = (reference_timestamp + SYNCHRONIZED_US_TO_DW_TICKS(start_delay_us, master_clock_offset)) & DW_TIMESTAMP_MASK;
+   telemetry_record_scheduled_peers(num_slots - 1);
+
+   // Set up the correct initial antenna, RX timeout duration, and network PAN
+   ranging_radio_choose_antenna(antenna_index = 0);
+   ranging_radio_set_packet_pan_id(&broadcast_packet.header);
+   dwt_setrxtimeout(US_TO_DW_TIMEOUT(RANGING_TIMEOUT_US));
+   return begin_current_broadcast();
+}
+
+scheduler_phase_t broadcast_phase_tx_complete(void)
+{
+   // Forward this request to the next phase if not currently in the Ranging Phase
+   if (current_phase != RANGING_PHASE)
+      return status_phase_tx_complete();
+
+   // Move on to the next broadcast slot
+   ++current_broadcast;
+   return begin_current_broadcast();
+}
+
+scheduler_phase_t broadcast_phase_rx_complete(broadcast_packet_t* packet, uint64_t rx_timestamp, float signal_level, float nlos_indicator_db)
+{
+   // Forward this request to the next phase if not currently in the Ranging Phase
+   if (current_phase != RANGING_PHASE)
+      return status_phase_rx_complete((status_success_packet_t*)packet);
+   else if (packet->message_type != RANGING_BROADCAST_PACKET)
+   {
+      print("ERROR: Received an unexpected message type during RANGING phase...possible network collision\n");
+      return MESSAGE_COLLISION;
+   }
+   else if (packet->header.seqNum != (current_broadcast % (RANGING_BROADCAST_NUM_CYCLES * total_num_slots)))
+      return broadcast_phase_rx_error();
+
+#if RANGE_STATUS_PIGGYBACK
+   // Record all devices which have been heard by the transmitting device
+   status_phase_merge_device_statuses(packet->device_statuses);
+#endif
+
+   // Store the reception time and the timestamps reported by the transmitting device
+   const uint8_t cycle = (current_broadcast / total_num_slots) % RANGING_BROADCAST_NUM_CYCLES, slot = current_broadcast % total_num_slots;
+   const uint64_t range_bias_correction = ranging_radio_compute_correction_for_signal_level(signal_level);
+   rx_timestamps[cycle][slot] = (uint32_t)(rx_timestamp - range_bias_correction);
+   if (cycle == 0)
+   {
+      peer_tx_timestamps[slot] = packet->tx_timestamp;
+      peer_rx_timestamps[slot] = packet->rx_timestamps[scheduled_slot];
+   }
+   else
+   {
+      add_signal_level(DEVICE_ID(packet->header.sourceAddr), signal_level);
+      add_nlos_indicator(DEVICE_ID(packet->header.sourceAddr), antenna_index, nlos_indicator_db);
+      store_ranging_times(slot, packet);
+   }
+
+   // Move on to the next broadcast slot
+   ++current_broadcast;
+   return begin_current_broadcast();
+}
+
+scheduler_phase_t broadcast_phase_rx_error(void)
+{
+   // Forward this request to the next phase if not currently in the Ranging Phase
+   if (current_phase != RANGING_PHASE)
+      return status_phase_rx_error();
+
+   // Move on to the next broadcast slot
+   ++current_broadcast;
+   return begin_current_broadcast();
+}
+
+uint32_t broadcast_phase_get_duration_us(void)
+{
+   return (uint32_t)total_num_broadcasts * RANGING_BROADCAST_INTERVAL_US;
+}
+
+uint32_t broadcast_phase_get_required_duration_us(uint8_t num_slots)
+{
+   return BROADCAST_RANGING_DURATION_US((uint32_t)num_slots);
+}
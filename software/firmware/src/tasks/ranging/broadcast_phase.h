@@ -0,0 +1,34 @@
+#ifndef __BROADCAST_PHASE_HEADER_H__
+#define __BROADCAST_PHASE_HEADER_H__
+
+// Header Inclusions ---------------------------------------------------------------------------------------------------
+
+#include "scheduler.h"
+
+
+// Data Structures -----------------------------------------------------------------------------------------------------
+
+typedef struct __attribute__ ((__packed__))
+{
+   ieee154_header_t header;
+   uint8_t message_type;
+   uint32_t tx_timestamp;
+#if RANGE_STATUS_PIGGYBACK
+   uint8_t device_statuses[RANGE_STATUS_BITMAP_LENGTH];
+#endif
+   uint32_t rx_timestamps[MAX_NUM_RANGING_DEVICES];
+   ieee154_footer_t footer;
+} broadcast_packet_t;
+
+
+// Public API ----------------------------------------------------------------------------------------------------------
+
+void broadcast_phase_initialize(const uint8_t *uid);
+scheduler_phase_t broadcast_phase_begin(uint8_t ranging_slot, uint8_t num_slots, uint64_t reference_timestamp, uint32_t start_delay_us, int16_t clock_offset);
+scheduler_phase_t broadcast_phase_tx_complete(void);
+scheduler_phase_t broadcast_phase_rx_complete(broadcast_packet_t* packet, uint64_t rx_timestamp, float signal_level, float nlos_indicator_db);
+scheduler_phase_t broadcast_phase_rx_error(void);
+uint32_t broadcast_phase_get_duration_us(void);
+uint32_t broadcast_phase_get_required_duration_us(uint8_t num_slots);
+
+#endif  // #ifndef __BROADCAST_PHASE_HEADER_H__
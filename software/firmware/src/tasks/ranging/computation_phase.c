@@ -2,12 +2,22 @@
 
 #include "logging.h"
 #include "computation_phase.h"
+#include "telemetry.h"
+#include "timing.h"
+
+
+// Data Structures -----------------------------------------------------------------------------------------------------
+
+typedef struct { uint16_t device_id; int32_t range_mm, reported_range_mm; uint32_t variance_mm2, elapsed_ms; uint8_t num_rejections; bool tracking, reported; } range_filter_t;
 
 
 // Static Global Variables ---------------------------------------------------------------------------------------------
 
 static ranging_state_t state;
-static int distances_millimeters[RANGING_NUM_SEQUENCES];
+static range_filter_t range_filters[MAX_NUM_RANGING_DEVICES];
+static uint8_t next_replaced_filter;
+static int distances_millimeters[RANGING_NUM_SEQUENCES], nlos_distances_millimeters[RANGING_NUM_SEQUENCES];
+static const int64_t millimeters_per_time_unit = (int64_t)((SPEED_OF_LIGHT * DWT_TIME_UNITS * 1000.0 * (1ULL << MILLIMETERS_FRACTION_BITS)) + 0.5);
 
 
 // Private Helper Functions --------------------------------------------------------------------------------------------
@@ -29,6 +39,74 @@ void insert_sorted(int arr[], int new, unsigned end)
       }
 }
 
+static int32_t time_of_flight_to_millimeters(int64_t time_of_flight)
+{
+   // Remove the fixed radio delays and scale by the fixed-point number of millimeters per DW3000 time unit
+   const int64_t propagation_time = time_of_flight - ((int64_t)RADIO_TX_PLUS_RX_DELAY << TIME_OF_FLIGHT_FRACTION_BITS);
+   if ((propagation_time > (INT64_MAX / millimeters_per_time_unit)) || (propagation_time < -(INT64_MAX / millimeters_per_time_unit)))
+      return (propagation_time < 0) ? INT32_MIN : INT32_MAX;
+   const int64_t millimeters = (propagation_time * millimeters_per_time_unit) / (1LL << (TIME_OF_FLIGHT_FRACTION_BITS + MILLIMETERS_FRACTION_BITS));
+   return (millimeters > INT32_MAX) ? INT32_MAX : (millimeters < INT32_MIN) ? INT32_MIN : (int32_t)millimeters;
+}
+
+static ranging_device_state_t* get_device_state(uint16_t device_id)
+{
+   // Search for an existing entry for the specified device ID or create a new one
+   for (uint8_t i = 0; i < state.num_responses; ++i)
+      if (state.responses[i].device_id == device_id)
+         return &state.responses[i];
+   state.responses[state.num_responses].device_id = device_id;
+   return &state.responses[state.num_responses++];
+}
+
+static range_filter_t* get_range_filter(uint16_t device_id)
+{
+   // Look up the range filter of a peer device, replacing that of the least recently added peer for a new device
+   for (uint8_t i = 0; i < MAX_NUM_RANGING_DEVICES; ++i)
+      if (range_filters[i].tracking && (range_filters[i].device_id == device_id))
+         return &range_filters[i];
+   range_filter_t *filter = &range_filters[next_replaced_filter];
+   next_replaced_filter = (next_replaced_filter + 1) % MAX_NUM_RANGING_DEVICES;
+   *filter = (range_filter_t){ .device_id = device_id, .range_mm = 0, .reported_range_mm = 0, .variance_mm2 = 0, .elapsed_ms = 0, .num_rejections = 0, .tracking = false, .reported = false };
+   return filter;
+}
+
+static uint32_t measurement_variance_mm2(int8_t signal_level_dbm)
+{
+   // Trust weak signals less by doubling the measurement noise for every few dB below a strong signal level
+   uint32_t variance_mm2 = RANGE_FILTER_MEASUREMENT_NOISE_MM2;
+   for (int16_t level = RANGE_FILTER_STRONG_SIGNAL_DBM; (signal_level_dbm < level) && (variance_mm2 < (UINT32_MAX / 4)); level -= RANGE_FILTER_NOISE_DOUBLING_DB)
+      variance_mm2 *= 2;
+   return variance_mm2;
+}
+
+static void filter_range(range_filter_t *filter, int32_t measured_mm, uint64_t measurement_variance)
+{
+   // Predict how far the peer may have moved since the previous accepted measurement
+   const uint64_t predicted_variance = filter->variance_mm2 + (((uint64_t)RANGE_FILTER_PROCESS_NOISE_MM2_PER_S * filter->elapsed_ms) / 1000);
+   const int64_t innovation = (int64_t)measured_mm - filter->range_mm;
+   const uint64_t innovation_variance = predicted_variance + measurement_variance;
+
+   // Reject measurements which lie too many standard deviations from the prediction as likely multipath or NLOS
+   //   outliers, but start over from the latest measurement once several consecutive ones disagree with the estimate
+   if (filter->tracking && ((uint64_t)(innovation * innovation) > ((uint64_t)RANGE_FILTER_GATE_SIGMAS * RANGE_FILTER_GATE_SIGMAS * innovation_variance)) &&
+         (++filter->num_rejections < RANGE_FILTER_MAX_REJECTIONS))
+      return;
+   if (!filter->tracking || filter->num_rejections)
+   {
+      filter->range_mm = measured_mm;
+      filter->variance_mm2 = (uint32_t)measurement_variance;
+   }
+   else
+   {
+      // Blend the measurement into the estimate weighted by their relative uncertainties
+      filter->range_mm += (int32_t)((innovation * (int64_t)predicted_variance) / (int64_t)innovation_variance);
+      filter->variance_mm2 = (uint32_t)((predicted_variance * measurement_variance) / innovation_variance);
+   }
+   filter->elapsed_ms = filter->num_rejections = 0;
+   filter->tracking = true;
+}
+
 
 // Public API Functions ------------------------------------------------------------------------------------------------
 
@@ -37,87 +115,167 @@ void reset_computation_phase(void)
    memset(&state, 0, sizeof(state));
 }
 
-void add_roundtrip1_time(uint8_t eui, uint8_t sequence_number, uint32_t roundtrip_time)
+void reset_range_filters(void)
 {
-   bool response_found = false;
-   for (uint8_t i = 0; i < state.num_responses; ++i)
-      if (state.responses[i].device_eui == eui)
-      {
-         state.responses[i].round_trip1_times[sequence_number] = roundtrip_time;
-         response_found = true;
-         break;
-      }
-   if (!response_found)
-   {
-      state.responses[state.num_responses].device_eui = eui;
-      state.responses[state.num_responses].round_trip1_times[sequence_number] = roundtrip_time;
-      ++state.num_responses;
-   }
+   memset(range_filters, 0, sizeof(range_filters));
+   next_replaced_filter = 0;
 }
 
-void add_roundtrip2_time(uint8_t eui, uint8_t sequence_number, uint32_t roundtrip_time)
+void add_roundtrip1_time(uint16_t device_id, uint8_t sequence_number, uint32_t roundtrip_time)
 {
-   bool response_found = false;
-   for (uint8_t i = 0; i < state.num_responses; ++i)
-      if (state.responses[i].device_eui == eui)
-      {
-         state.responses[i].round_trip2_times[sequence_number] = roundtrip_time;
-         response_found = true;
-         break;
-      }
-   if (!response_found)
-   {
-      state.responses[state.num_responses].device_eui = eui;
-      state.responses[state.num_responses].round_trip2_times[sequence_number] = roundtrip_time;
-      ++state.num_responses;
-   }
+   get_device_state(device_id)->round_trip1_times[sequence_number] = roundtrip_time;
+}
+
+void add_roundtrip2_time(uint16_t device_id, uint8_t sequence_number, uint32_t roundtrip_time)
+{
+   get_device_state(device_id)->round_trip2_times[sequence_number] = roundtrip_time;
+}
+
+void add_ranging_times(uint16_t device_id, uint8_t sequence_number, uint32_t roundtrip1_time, uint32_t reply1_time, uint32_t roundtrip2_time, uint32_t reply2_time)
+{
+   ranging_device_state_t *device_state = get_device_state(device_id);
+   device_state->round_trip1_times[sequence_number] = roundtrip1_time;
+   device_state->reply1_times[sequence_number] = reply1_time;
+   device_state->round_trip2_times[sequence_number] = roundtrip2_time;
+   device_state->reply2_times[sequence_number] = reply2_time;
+}
+
+void add_single_sided_times(uint16_t device_id, uint8_t sequence_number, uint32_t roundtrip_time, uint32_t reply_time)
+{
+   // A single-sided exchange is equivalent to a double-sided one whose two halves are identical, for which the DS-TWR
+   //   computation reduces to (round trip - reply) / 2
+   add_ranging_times(device_id, sequence_number, roundtrip_time, reply_time, roundtrip_time, reply_time);
+}
+
+void add_signal_level(uint16_t device_id, float signal_level_dbm)
+{
+   // Keep the weakest signal level received from each device this round
+   ranging_device_state_t *device_state = get_device_state(device_id);
+   const int8_t level = (signal_level_dbm < INT8_MIN) ? INT8_MIN : (signal_level_dbm > -1.0f) ? -1 : (int8_t)signal_level_dbm;
+   if (!device_state->signal_level_dbm || (level < device_state->signal_level_dbm))
+      device_state->signal_level_dbm = level;
+}
+
+void add_nlos_indicator(uint16_t device_id, uint8_t sequence_number, float nlos_indicator_db)
+{
+   // Keep the worst NLOS indicator of the packets received from each device during each ranging sequence
+   ranging_device_state_t *device_state = get_device_state(device_id);
+   const uint8_t indicator = (nlos_indicator_db <= 0.0f) ? 0 : (nlos_indicator_db >= (float)UINT8_MAX) ? UINT8_MAX : (uint8_t)(nlos_indicator_db + 0.5f);
+   if (indicator > device_state->nlos_indicators_db[sequence_number])
+      device_state->nlos_indicators_db[sequence_number] = indicator;
 }
 
-void compute_ranges(uint8_t *ranging_results)
+uint8_t compute_ranges(uint8_t *ranging_results, uint32_t elapsed_us)
 {
-   // Iterate through all responses to calculate the range from this to that device
+   // Age every range filter by the time since the previous round
+   for (uint8_t i = 0; i < MAX_NUM_RANGING_DEVICES; ++i)
+      if (range_filters[i].tracking)
+         range_filters[i].elapsed_ms += elapsed_us / 1000;
+
+   // Iterate through all responses to calculate the range from this to that device, counting every device ranged even
+   //   if its range is not reported
    ranging_results[0] = 0;
-   uint8_t output_buffer_index = 1;
+   uint8_t output_buffer_index = 1, num_ranged_devices = 0;
    for (uint8_t dev_index = 0; dev_index < state.num_responses; ++dev_index)
    {
-      // Calculate the device distances using symmetric two-way TOFs
-      uint8_t num_valid_distances = 0;
+      // Calculate the device distances using symmetric two-way TOFs, separating sequences whose first path was likely
+      //   obstructed from those which were likely received in line of sight
+      uint8_t num_valid_distances = 0, num_nlos_distances = 0, best_indicator_db = UINT8_MAX, best_nlos_indicator_db = UINT8_MAX;
       memset(distances_millimeters, 0, sizeof(distances_millimeters));
+      memset(nlos_distances_millimeters, 0, sizeof(nlos_distances_millimeters));
       for (uint8_t i = 0; i < RANGING_NUM_SEQUENCES; ++i)
          if (state.responses[dev_index].round_trip1_times[i] && state.responses[dev_index].round_trip2_times[i])
          {
-            // Compute the device range from the two-way round-trip times
-            const double broadcast_interval_dwt = APP_US_TO_DEVICETIMEU64(RANGING_BROADCAST_INTERVAL_US);
-            const double TOF = (((double)state.responses[dev_index].round_trip1_times[i] * state.responses[dev_index].round_trip2_times[i]) - (broadcast_interval_dwt * broadcast_interval_dwt)) /
-                  ((double)state.responses[dev_index].round_trip1_times[i] + state.responses[dev_index].round_trip2_times[i] + broadcast_interval_dwt + broadcast_interval_dwt);
-            const int distance_millimeters = ranging_radio_time_to_millimeters(TOF);
+            // Compute the device range from the two-way round-trip and reply times
+            const int32_t distance_millimeters = compute_distance_millimeters(state.responses[dev_index].round_trip1_times[i], state.responses[dev_index].reply1_times[i],
+                  state.responses[dev_index].round_trip2_times[i], state.responses[dev_index].reply2_times[i]);
 
             // Check that the distance we have at this point is at all reasonable
-            if ((distance_millimeters >= MIN_VALID_RANGE_MM) && (distance_millimeters <= MAX_VALID_RANGE_MM))
+            const uint8_t nlos_indicator_db = state.responses[dev_index].nlos_indicators_db[i];
+            if ((distance_millimeters < MIN_VALID_RANGE_MM) || (distance_millimeters > MAX_VALID_RANGE_MM))
+               print("WARNING: Disregarding range to device 0x%04X for subsequence #%u: %d\n", (uint32_t)state.responses[dev_index].device_id, i, (int)distance_millimeters);
+            else if (nlos_indicator_db < RANGE_NLOS_INDICATOR_THRESHOLD_DB)
+            {
                insert_sorted(distances_millimeters, distance_millimeters, num_valid_distances++);
+               if (nlos_indicator_db < best_indicator_db)
+                  best_indicator_db = nlos_indicator_db;
+            }
             else
-               print("WARNING: Disregarding range to EUI %u for subsequence #%u: %d\n", (uint32_t)state.responses[dev_index].device_eui, i, distance_millimeters);
+            {
+               insert_sorted(nlos_distances_millimeters, distance_millimeters, num_nlos_distances++);
+               if (nlos_indicator_db < best_nlos_indicator_db)
+                  best_nlos_indicator_db = nlos_indicator_db;
+            }
          }
 
+      // Keep track of the number of antennas on which this device was successfully ranged
+      telemetry_record_ranged_peer(num_valid_distances + num_nlos_distances);
+
+      // Only fall back on likely NLOS sequences, which overestimate the range, when no line-of-sight sequence succeeded,
+      //   and trust their median less when filtering
+      uint32_t variance_mm2 = measurement_variance_mm2(state.responses[dev_index].signal_level_dbm);
+      if (!num_valid_distances && num_nlos_distances)
+      {
+         memcpy(distances_millimeters, nlos_distances_millimeters, sizeof(distances_millimeters));
+         num_valid_distances = num_nlos_distances;
+         best_indicator_db = best_nlos_indicator_db;
+         variance_mm2 = (variance_mm2 > (UINT32_MAX / RANGE_NLOS_VARIANCE_FACTOR)) ? UINT32_MAX : (variance_mm2 * RANGE_NLOS_VARIANCE_FACTOR);
+      }
+
       // Skip this device if too few ranging packets were received
       int16_t range_millimeters = INT16_MAX;
       if (num_valid_distances >= 1)
       {
-         // Take the median range as the final range estimate
+         // Take the median range as this round's measurement and filter it using the measurements from previous rounds
          uint8_t top = (num_valid_distances / 2), bot = (num_valid_distances % 2) ? (num_valid_distances / 2) : ((num_valid_distances / 2) - 1);
-         range_millimeters = (int16_t)((distances_millimeters[bot] + distances_millimeters[top]) / 2);
+         ++num_ranged_devices;
+         range_filter_t *filter = get_range_filter(state.responses[dev_index].device_id);
+         filter_range(filter, (distances_millimeters[bot] + distances_millimeters[top]) / 2, variance_mm2);
+         range_millimeters = (int16_t)filter->range_mm;
          if (range_millimeters < 0)
             range_millimeters = 0;
+
+#if RANGE_OUTPUT_CHANGES_ONLY
+         // Only report ranges which have changed noticeably since they were last reported
+         if (filter->reported && (abs(filter->range_mm - filter->reported_range_mm) < RANGE_OUTPUT_CHANGE_THRESHOLD_MM))
+            continue;
+         filter->reported_range_mm = filter->range_mm;
+         filter->reported = true;
+#endif
          if (range_millimeters < MAX_VALID_RANGE_MM)
          {
             // Copy valid ranges into the ID/range output buffer
-            ranging_results[output_buffer_index++] = state.responses[dev_index].device_eui;
+            ranging_results[output_buffer_index++] = (uint8_t)(state.responses[dev_index].device_id & 0xFF);
+            ranging_results[output_buffer_index++] = (uint8_t)(state.responses[dev_index].device_id >> 8);
             *((int16_t*)&ranging_results[output_buffer_index]) = range_millimeters;
             output_buffer_index += sizeof(range_millimeters);
+#if RANGE_OUTPUT_QUALITY
+            // Append the number of line-of-sight sequences used (saturating at 3) and the best NLOS indicator in dB
+            const uint8_t num_los_distances = (best_indicator_db < RANGE_NLOS_INDICATOR_THRESHOLD_DB) ? num_valid_distances : 0;
+            const uint8_t num_los_sequences = (num_los_distances > 3) ? 3 : num_los_distances;
+            ranging_results[output_buffer_index++] = (uint8_t)(num_los_sequences << 6) | ((best_indicator_db > 0x3F) ? 0x3F : best_indicator_db);
+#endif
             ++ranging_results[0];
          }
       }
    }
+   return num_ranged_devices;
+}
+
+int32_t compute_distance_millimeters(uint32_t roundtrip1_time, uint32_t reply1_time, uint32_t roundtrip2_time, uint32_t reply2_time)
+{
+   // Compute the symmetric two-way TOF = (Ra*Rb - Da*Db) / (Ra+Rb+Da+Db) using 64-bit integer arithmetic, where unspecified reply times are fixed to the broadcast interval
+   const uint32_t broadcast_interval_dwt = (uint32_t)US_TO_DW_TICKS(RANGING_BROADCAST_INTERVAL_US);
+   const uint32_t reply1_dwt = reply1_time ? reply1_time : broadcast_interval_dwt, reply2_dwt = reply2_time ? reply2_time : broadcast_interval_dwt;
+   const uint64_t round_trip_product = (uint64_t)roundtrip1_time * roundtrip2_time, reply_product = (uint64_t)reply1_dwt * reply2_dwt;
+   const uint64_t numerator = (round_trip_product >= reply_product) ? (round_trip_product - reply_product) : (reply_product - round_trip_product);
+   const uint64_t denominator = (uint64_t)roundtrip1_time + roundtrip2_time + reply1_dwt + reply2_dwt;
+
+   // Keep fractional DW3000 time units in the TOF, rejecting timestamp sets too inconsistent to represent
+   if (!denominator || (numerator > ((uint64_t)INT64_MAX >> TIME_OF_FLIGHT_FRACTION_BITS)))
+      return INT32_MAX;
+   const int64_t time_of_flight = (int64_t)((numerator << TIME_OF_FLIGHT_FRACTION_BITS) / denominator);
+   return time_of_flight_to_millimeters((round_trip_product >= reply_product) ? time_of_flight : -time_of_flight);
 }
 
 bool responses_received(void)
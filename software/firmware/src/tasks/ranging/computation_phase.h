@@ -6,13 +6,23 @@
 #include "scheduler.h"
 
 
+// Fixed-Point Definitions ---------------------------------------------------------------------------------------------
+
+#define TIME_OF_FLIGHT_FRACTION_BITS                        12
+#define MILLIMETERS_FRACTION_BITS                           28
+
+
 // Data Structures -----------------------------------------------------------------------------------------------------
 
 typedef struct
 {
-   uint8_t device_eui;
+   uint16_t device_id;
+   int8_t signal_level_dbm;
+   uint8_t nlos_indicators_db[RANGING_NUM_SEQUENCES];
    uint32_t round_trip1_times[RANGING_NUM_SEQUENCES];
    uint32_t round_trip2_times[RANGING_NUM_SEQUENCES];
+   uint32_t reply1_times[RANGING_NUM_SEQUENCES];
+   uint32_t reply2_times[RANGING_NUM_SEQUENCES];
 } ranging_device_state_t;
 
 typedef struct
@@ -25,9 +35,15 @@ typedef struct
 // Public API ----------------------------------------------------------------------------------------------------------
 
 void reset_computation_phase(void);
-void add_roundtrip1_time(uint8_t eui, uint8_t sequence_number, uint32_t roundtrip_time);
-void add_roundtrip2_time(uint8_t eui, uint8_t sequence_number, uint32_t roundtrip_time);
-void compute_ranges(uint8_t *ranging_results);
+void reset_range_filters(void);
+void add_roundtrip1_time(uint16_t device_id, uint8_t sequence_number, uint32_t roundtrip_time);
+void add_roundtrip2_time(uint16_t device_id, uint8_t sequence_number, uint32_t roundtrip_time);
+void add_ranging_times(uint16_t device_id, uint8_t sequence_number, uint32_t roundtrip1_time, uint32_t reply1_time, uint32_t roundtrip2_time, uint32_t reply2_time);
+void add_single_sided_times(uint16_t device_id, uint8_t sequence_number, uint32_t roundtrip_time, uint32_t reply_time);
+void add_signal_level(uint16_t device_id, float signal_level_dbm);
+void add_nlos_indicator(uint16_t device_id, uint8_t sequence_number, float nlos_indicator_db);
+uint8_t compute_ranges(uint8_t *ranging_results, uint32_t elapsed_us);
+int32_t compute_distance_millimeters(uint32_t roundtrip1_time, uint32_t reply1_time, uint32_t roundtrip2_time, uint32_t reply2_time);
 bool responses_received(void);
 
 #endif  // #ifndef __COMPUTATION_PHASE_HEADER_H__
@@ -4,162 +4,415 @@
 #include "computation_phase.h"
 #include "ranging_phase.h"
 #include "status_phase.h"
+#include "telemetry.h"
+#include "timing.h"
+
+
+// Data Structures -----------------------------------------------------------------------------------------------------
+
+typedef struct { uint16_t sub_slot; uint8_t peer_statistics; bool is_initiator; } assigned_slot_t;
+typedef struct { uint16_t device_id; uint8_t success_rate[NUM_ANTENNAS]; int8_t signal_level[NUM_ANTENNAS]; uint8_t plan; } antenna_statistics_t;
 
 
 // Static Global Variables ---------------------------------------------------------------------------------------------
 
 static scheduler_phase_t current_phase;
 static ranging_packet_t ranging_packet;
-static uint8_t responder_slot_index, scheduled_slot, total_num_slots, antenna_index;
-static int32_t responder_slots[MAX_NUM_RANGING_DEVICES], current_slot;
-static int32_t initiator_slot_first, initiator_slot_last;
-static uint32_t num_sub_slots, last_rx_delay_time_us;
-static bool last_rx_relative_to_transmit;
+static assigned_slot_t assigned_slots[MAX_NUM_RANGING_DEVICES - 1];
+static antenna_statistics_t antenna_statistics[MAX_NUM_RANGING_DEVICES];
+static uint8_t next_replaced_statistics, scheduled_slot, total_num_slots, antenna_index, current_sequence_num;
+static uint8_t num_assigned_slots, assigned_slot_index, num_packets_per_sub_slot, num_packets_per_sequence;
+static uint8_t proposed_plan, received_plan, successful_sequences;
+static bool peer_heard, plan_acknowledged, single_sided;
+static uint32_t num_sub_slots, sleep_duration_us, min_sleep_duration_us, reply_times[RANGING_NUM_SEQUENCES];
+static int32_t sleep_start_time_us;
+static int16_t master_clock_offset;
+static uint64_t phase_start_timestamp, last_tx_timestamp, last_rx_timestamp;
 
 
-// Public functions ----------------------------------------------------------------------------------------------------
+// Private Helper Functions --------------------------------------------------------------------------------------------
 
-void ranging_phase_initialize(const uint8_t *uid)
+static uint8_t default_antenna_plan(void)
 {
-   // Initialize all Ranging Phase parameters
-   ranging_packet = (ranging_packet_t){ .header = { .frameCtrl = { 0x41, 0x98 }, .seqNum = 0,
-         .panID = { MODULE_PANID & 0xFF, MODULE_PANID >> 8 }, .destAddr = { 0xFF, 0xFF }, .sourceAddr = { 0 } },
-      .message_type = RANGING_PACKET, .round_trip_time = 0, .footer = { { 0 } } };
-   memcpy(ranging_packet.header.sourceAddr, uid, sizeof(ranging_packet.header.sourceAddr));
-   scheduled_slot = 0xFF;
+   // Antenna plans store the antenna to use for each ranging sequence in two bits per sequence
+   uint8_t plan = 0;
+   for (uint8_t i = 0; i < NUM_ANTENNAS; ++i)
+      plan |= i << (2 * i);
+   return plan;
 }
 
-scheduler_phase_t ranging_phase_begin(uint8_t ranging_slot, uint8_t num_slots, uint32_t start_delay_us, bool start_relative_to_transmit)
+static uint8_t get_antenna_statistics_index(uint16_t peer_id)
 {
-   // Ensure there are at least two devices to begin ranging
-   reset_computation_phase();
-   if (num_slots < 2)
-      return RANGE_COMPUTATION_PHASE;
+   // Look up the antenna statistics of a peer device, replacing those of the least recently added peer for a new device
+   for (uint8_t i = 0; i < MAX_NUM_RANGING_DEVICES; ++i)
+      if (antenna_statistics[i].device_id == peer_id)
+         return i;
+   const uint8_t index = next_replaced_statistics;
+   next_replaced_statistics = (next_replaced_statistics + 1) % MAX_NUM_RANGING_DEVICES;
+   antenna_statistics[index] = (antenna_statistics_t){ .device_id = peer_id, .success_rate = { 0 }, .signal_level = { 0 }, .plan = default_antenna_plan() };
+   return index;
+}
 
-   // Reset the necessary Ranging Phase parameters
-   current_phase = RANGING_PHASE;
-   responder_slot_index = antenna_index = 0;
-   num_sub_slots = (uint32_t)num_slots * (num_slots - 1) / 2;
-   scheduled_slot = ranging_slot;
-   total_num_slots = num_slots;
+static uint8_t antenna_for_sequence(uint8_t plan, uint8_t sequence_index)
+{
+   return (plan >> (2 * sequence_index)) & 0x03;
+}
+
+static bool antenna_plan_is_valid(uint8_t plan)
+{
+   // Ensure that the plan contains every antenna exactly once
+   uint8_t antennas_used = 0;
+   for (uint8_t i = 0; i < NUM_ANTENNAS; ++i)
+      antennas_used |= 1 << antenna_for_sequence(plan, i);
+   return (antennas_used == ((1 << NUM_ANTENNAS) - 1)) && !(plan >> (2 * NUM_ANTENNAS));
+}
 
-   // Compute the initiator time slots for the device
-   if ((ranging_slot + 1) < num_slots)
+static uint8_t rank_antennas(const antenna_statistics_t *statistics)
+{
+   // Order the antennas by success rate, breaking ties using the received signal level
+   uint8_t plan = 0, antennas_used = 0;
+   for (uint8_t i = 0; i < NUM_ANTENNAS; ++i)
    {
-      initiator_slot_first = 0;
-      for (uint8_t i = 1; i <= ranging_slot; ++i)
-         initiator_slot_first += (num_slots - i);
-      initiator_slot_last = initiator_slot_first + (num_slots - ranging_slot - 2);
+      uint8_t best = 0xFF;
+      for (uint8_t antenna = 0; antenna < NUM_ANTENNAS; ++antenna)
+         if (!(antennas_used & (1 << antenna)) && ((best == 0xFF) || (statistics->success_rate[antenna] > statistics->success_rate[best]) ||
+               ((statistics->success_rate[antenna] == statistics->success_rate[best]) && (statistics->signal_level[antenna] > statistics->signal_level[best]))))
+            best = antenna;
+      antennas_used |= 1 << best;
+      plan |= best << (2 * i);
    }
-   else
-      initiator_slot_first = initiator_slot_last = -1;
+   return plan;
+}
 
-   // Compute the responder time slots for the device
-   responder_slots[0] = (int32_t)ranging_slot - 1;
-   for (uint8_t i = 1; i < ranging_slot; ++i)
-      responder_slots[i] = responder_slots[i-1] + (num_slots - i - 1);
-   for (uint8_t i = ranging_slot; i < MAX_NUM_RANGING_DEVICES; ++i)
-      responder_slots[i] = -1;
+static uint32_t packet_time_us(uint8_t sequence_num)
+{
+   // Return the nominal time of a packet in the current sub-slot relative to the start of the Ranging Phase
+   return ((uint32_t)assigned_slots[assigned_slot_index].sub_slot * num_packets_per_sub_slot * RANGING_BROADCAST_INTERVAL_US) + ((uint32_t)sequence_num * RANGING_BROADCAST_INTERVAL_US);
+}
 
-   // Set up the correct initial antenna and RX timeout duration
-   ranging_radio_choose_antenna(0);
-   dwt_setrxtimeout(DW_TIMEOUT_FROM_US(RANGING_TIMEOUT_US));
+static uint32_t phase_time_to_delayed_time(uint32_t phase_time_us)
+{
+   // Convert a time relative to the start of the Ranging Phase on the master's clock into an absolute DW3000 delayed TX/RX time
+   return (uint32_t)((phase_start_timestamp + SYNCHRONIZED_US_TO_DW_TICKS(phase_time_us, master_clock_offset)) >> 8);
+}
+
+static int32_t current_phase_time_us(void)
+{
+   // Return the current DW3000 system time relative to the start of the Ranging Phase, which may not have started yet
+   const int32_t elapsed_time = (int32_t)(dwt_readsystimestamphi32() - (uint32_t)(phase_start_timestamp >> 8));
+   return (elapsed_time < 0) ? -(int32_t)DW_DELAY_TO_US(-elapsed_time) : (int32_t)DW_DELAY_TO_US(elapsed_time);
+}
+
+static void select_antenna_for_packet(uint8_t sequence_num)
+{
+   // Each antenna is used for all packets of one sequence in the order specified by the antenna plan for the current peer,
+   //   with the final single-sided report sent on the antenna of the last sequence
+   const uint8_t num_sequences = num_packets_per_sub_slot / num_packets_per_sequence, sequence_index = sequence_num / num_packets_per_sequence;
+   const uint8_t required_antenna = antenna_for_sequence(antenna_statistics[assigned_slots[assigned_slot_index].peer_statistics].plan, (sequence_index < num_sequences) ? sequence_index : (num_sequences - 1));
+   if (antenna_index != required_antenna)
+      ranging_radio_choose_antenna(antenna_index = required_antenna);
+}
+
+static void record_signal_level(float signal_level_dbm)
+{
+   // Keep a running average of the received signal level for the antenna currently in use with this peer
+   int8_t *average_level = &antenna_statistics[assigned_slots[assigned_slot_index].peer_statistics].signal_level[antenna_index];
+   const int8_t level = (signal_level_dbm < INT8_MIN) ? INT8_MIN : (signal_level_dbm > 0.0f) ? 0 : (int8_t)signal_level_dbm;
+   *average_level = *average_level ? (int8_t)(*average_level + ((level - *average_level) / 4)) : level;
+}
+
+static bool transmit_packet(uint8_t sequence_num, bool is_reply)
+{
+   // Only packets which follow a received packet within the same antenna sequence contain a round-trip time, while
+   //   single-sided responses contain their reply time and every later request reports the previous round-trip time
+   const bool contains_round_trip_time = single_sided ? (sequence_num > 0) : ((sequence_num % RANGING_NUM_PACKETS_PER_SEQUENCE) >= 2);
+   const uint16_t packet_size = sizeof(ranging_packet_t) - (contains_round_trip_time ? 0 : sizeof(ranging_packet.round_trip_time));
+   select_antenna_for_packet(sequence_num);
+
+   // Single-sided responses are scheduled at an absolute time so that their exact reply time, measured from the
+   //   signal-level-corrected arrival of the request, is known before transmission
+   const bool is_single_sided_response = single_sided && (sequence_num % 2);
+   uint32_t response_time = 0;
+   if (is_single_sided_response)
+   {
+      response_time = (uint32_t)(((last_rx_timestamp + US_TO_DW_TICKS(RANGING_BROADCAST_INTERVAL_US)) & DW_TIMESTAMP_MASK) >> 8);
+      ranging_packet.round_trip_time = reply_times[sequence_num / num_packets_per_sequence] = (uint32_t)((DW_DELAYED_TX_TICKS(response_time) - last_rx_timestamp) & DW_TIMESTAMP_MASK);
+   }
+   current_sequence_num = ranging_packet.header.seqNum = sequence_num;
+   ranging_packet.antenna_plan = assigned_slots[assigned_slot_index].is_initiator ? proposed_plan : received_plan;
+#if RANGE_STATUS_PIGGYBACK
+   memcpy(ranging_packet.device_statuses, status_phase_get_device_statuses(), sizeof(ranging_packet.device_statuses));
+#endif
+   dwt_writetxfctrl(packet_size, 0, 1);
+   dwt_writetxdata(packet_size, (uint8_t*)&ranging_packet, 0);
+
+   // Never report a single-sided round-trip time more than once, since it would be attributed to the wrong sequence if
+   //   the following response were lost
+   if (single_sided && !(sequence_num % 2))
+      ranging_packet.round_trip_time = 0;
 
-   // Begin transmission or reception depending on the scheduled time slot
-   if (ranging_slot == 0)
+   // Replies must follow the received packet by exactly one broadcast interval for the DS-TWR computation to hold,
+   //   single-sided responses must leave at the time from which their reply time was computed, and all other packets
+   //   are aligned to the start of the Ranging Phase so that timing errors cannot accumulate
+   if (is_single_sided_response)
    {
-      current_slot = 0;
-      ranging_packet.header.seqNum = 0;
-      dwt_writetxfctrl(sizeof(ranging_packet_t) - sizeof(ranging_packet.round_trip_time), 0, 1);
-      dwt_writetxdata(sizeof(ranging_packet_t) - sizeof(ranging_packet.round_trip_time), (uint8_t*)&ranging_packet, 0);
-      dwt_setdelayedtrxtime(DW_DELAY_FROM_US(start_delay_us));
-      if (dwt_starttx(start_relative_to_transmit ? DWT_START_TX_DLY_TS : DWT_START_TX_DLY_RS) != DWT_SUCCESS)
+      dwt_setdelayedtrxtime(response_time);
+      return dwt_starttx(DWT_START_TX_DELAYED) == DWT_SUCCESS;
+   }
+   else if (is_reply)
+   {
+      dwt_setdelayedtrxtime(US_TO_DW_DELAY(RANGING_BROADCAST_INTERVAL_US));
+      return dwt_starttx(DWT_START_TX_DLY_RS) == DWT_SUCCESS;
+   }
+   dwt_setdelayedtrxtime(phase_time_to_delayed_time(packet_time_us(sequence_num)));
+   return dwt_starttx(DWT_START_TX_DELAYED) == DWT_SUCCESS;
+}
+
+static bool receive_packet(uint8_t sequence_num)
+{
+   // Start listening slightly before the expected packet is scheduled to arrive
+   select_antenna_for_packet(sequence_num);
+   current_sequence_num = sequence_num;
+   dwt_setdelayedtrxtime(phase_time_to_delayed_time(packet_time_us(sequence_num)) - US_TO_DW_DELAY(RECEIVE_EARLY_START_US));
+   return ranging_radio_rxenable(DWT_START_RX_DELAYED);
+}
+
+static uint64_t double_sided_correction_for_signal_level(float signal_level)
+{
+   // Reply times are implicit during double-sided ranging, so the round trip also absorbs the deviation of the local
+   //   antenna delays from nominal on behalf of the local reply, which the peer cannot account for
+   return ranging_radio_compute_correction_for_signal_level(signal_level) + ranging_radio_get_antenna_delay() - RADIO_TX_PLUS_RX_DELAY;
+}
+
+static void record_single_sided_times(const ranging_packet_t *packet, uint64_t rx_timestamp, float signal_level, float nlos_indicator_db, int16_t clock_offset)
+{
+   // Keep the signal-level-corrected arrival time of every packet, from which the reply time of a response is measured
+   const uint16_t peer_id = DEVICE_ID(packet->header.sourceAddr);
+   const uint8_t sequence_index = packet->header.seqNum / RANGING_NUM_PACKETS_PER_SS_SEQUENCE;
+   const uint8_t num_sequences = num_packets_per_sub_slot / RANGING_NUM_PACKETS_PER_SS_SEQUENCE;
+   const uint64_t range_bias_correction = ranging_radio_compute_correction_for_signal_level(signal_level);
+   last_rx_timestamp = (rx_timestamp - range_bias_correction) & DW_TIMESTAMP_MASK;
+   if (sequence_index < num_sequences)
+   {
+      record_signal_level(signal_level);
+      add_signal_level(peer_id, signal_level);
+      add_nlos_indicator(peer_id, sequence_index, nlos_indicator_db);
+   }
+
+   // Initiators measure the round-trip time of every response and convert the reply time of the responder into
+   //   local time units using the clock offset measured on the response itself
+   if (packet->header.seqNum % 2)
+   {
+      ranging_packet.round_trip_time = (uint32_t)((last_rx_timestamp - last_tx_timestamp) & DW_TIMESTAMP_MASK);
+      add_single_sided_times(peer_id, sequence_index, ranging_packet.round_trip_time, (uint32_t)SYNCHRONIZED_DW_TICKS(packet->round_trip_time, clock_offset));
+      successful_sequences |= 1 << sequence_index;
+   }
+
+   // Responders learn the round-trip time of their previous response from the following request or the final report,
+   //   and convert it into local time units in the same way
+   else if (sequence_index && packet->round_trip_time && reply_times[sequence_index - 1])
+   {
+      add_single_sided_times(peer_id, sequence_index - 1, (uint32_t)SYNCHRONIZED_DW_TICKS(packet->round_trip_time, clock_offset), reply_times[sequence_index - 1]);
+      successful_sequences |= 1 << (sequence_index - 1);
+   }
+}
+
+static void finish_assigned_slot(void)
+{
+   // Update the per-antenna statistics for each sequence used with the current peer
+   antenna_statistics_t *statistics = &antenna_statistics[assigned_slots[assigned_slot_index].peer_statistics];
+   for (uint8_t i = 0; i < (num_packets_per_sub_slot / num_packets_per_sequence); ++i)
+   {
+      const uint8_t antenna = antenna_for_sequence(statistics->plan, i);
+      statistics->success_rate[antenna] = statistics->success_rate[antenna] - (statistics->success_rate[antenna] >> 2) + ((successful_sequences & (1 << i)) ? 63 : 0);
+   }
+
+   // Switch to the newly agreed antenna plan, or fall back to the default plan if the peer could not be heard at all
+   if (!peer_heard)
+      statistics->plan = default_antenna_plan();
+   else if (assigned_slots[assigned_slot_index].is_initiator && plan_acknowledged)
+      statistics->plan = proposed_plan;
+   else if (!assigned_slots[assigned_slot_index].is_initiator && antenna_plan_is_valid(received_plan))
+      statistics->plan = received_plan;
+}
+
+static scheduler_phase_t start_assigned_slot(void)
+{
+   // Move to the Status Phase once all assigned sub-slots have been handled
+   if (assigned_slot_index >= num_assigned_slots)
+   {
+      current_phase = RANGE_STATUS_PHASE;
+      return status_phase_begin(scheduled_slot, total_num_slots, (phase_start_timestamp + SYNCHRONIZED_US_TO_DW_TICKS(ranging_phase_get_duration_us(), master_clock_offset)) & DW_TIMESTAMP_MASK, master_clock_offset);
+   }
+
+   // Initiators propose an antenna ranking for the next exchange, which responders acknowledge by echoing it back
+   const antenna_statistics_t *statistics = &antenna_statistics[assigned_slots[assigned_slot_index].peer_statistics];
+   proposed_plan = rank_antennas(statistics);
+   received_plan = statistics->plan;
+   successful_sequences = 0;
+   ranging_packet.round_trip_time = 0;
+   memset(reply_times, 0, sizeof(reply_times));
+   peer_heard = plan_acknowledged = false;
+
+   // Initiate a ranging request or listen for one depending on the role of this device in the sub-slot
+   if (assigned_slots[assigned_slot_index].is_initiator)
+   {
+      if (!transmit_packet(0, false))
       {
+         telemetry_record_tx_failure();
          print("ERROR: Failed to transmit RANGING REQUEST packet\n");
          return RANGING_ERROR;
       }
    }
-   else
+   else if (!receive_packet(0))
    {
-      ranging_packet.header.seqNum = 11;
-      current_slot = (uint8_t)responder_slots[0];
-      last_rx_relative_to_transmit = start_relative_to_transmit;
-      last_rx_delay_time_us = start_delay_us + ((uint32_t)(responder_slots[0]) * RANGING_ITERATION_INTERVAL_US) - RECEIVE_EARLY_START_US;
-      dwt_setdelayedtrxtime(DW_DELAY_FROM_US(last_rx_delay_time_us));
-      if (!ranging_radio_rxenable(start_relative_to_transmit ? DWT_START_RX_DLY_TS : DWT_START_RX_DLY_RS))
-      {
-         print("ERROR: Unable to start listening for RANGING REQUEST packets\n");
-         return RANGING_ERROR;
-      }
+      print("ERROR: Unable to start listening for RANGING REQUEST packets\n");
+      return RANGING_ERROR;
    }
    return RANGING_PHASE;
 }
 
-scheduler_phase_t ranging_phase_tx_complete(void)
+static scheduler_phase_t begin_assigned_slot(void)
 {
-   // Forward this request to the next phase if not currently in the Ranging Phase
-   if (current_phase != RANGING_PHASE)
-      return status_phase_tx_complete();
+   // Put the radio to sleep if enough time remains before the next assigned sub-slot or the Status Phase
+   const int32_t next_activity_time_us = (int32_t)((assigned_slot_index < num_assigned_slots) ? packet_time_us(0) : ranging_phase_get_duration_us());
+   sleep_start_time_us = current_phase_time_us();
+   if ((next_activity_time_us - sleep_start_time_us) >= (int32_t)min_sleep_duration_us)
+   {
+      sleep_duration_us = (uint32_t)(next_activity_time_us - sleep_start_time_us);
+      return RADIO_SLEEP_PHASE;
+   }
+   return start_assigned_slot();
+}
 
-   // Switch to the next antenna when appropriate
-   if ((ranging_packet.header.seqNum == 3) || (ranging_packet.header.seqNum == 7))
-      ranging_radio_choose_antenna(++antenna_index);
+static scheduler_phase_t continue_with_sequence(uint8_t sequence_num, bool is_reply)
+{
+   // Move on to the next assigned sub-slot once the final antenna sequence has been exhausted
+   if (sequence_num >= num_packets_per_sub_slot)
+   {
+      finish_assigned_slot();
+      ++assigned_slot_index;
+      return begin_assigned_slot();
+   }
 
-   // Handle the ranging phase based on the sequence number of the packet that was just transmitted
-   if (ranging_packet.header.seqNum == 11)
+   // Initiators transmit even sequence numbers while responders transmit odd ones
+   if (assigned_slots[assigned_slot_index].is_initiator == ((sequence_num % 2) == 0))
    {
-      // Finished current ranging iteration...continue to next time slot
-      antenna_index = 0;
-      ++responder_slot_index;
-      ranging_radio_choose_antenna(0);
-      if ((++current_slot <= initiator_slot_first) && (initiator_slot_first < responder_slots[responder_slot_index]))
+      if (!transmit_packet(sequence_num, is_reply))
       {
-         ranging_packet.header.seqNum = 0;
-         dwt_writetxfctrl(sizeof(ranging_packet_t) - sizeof(ranging_packet.round_trip_time), 0, 1);
-         dwt_writetxdata(sizeof(ranging_packet_t) - sizeof(ranging_packet.round_trip_time), (uint8_t*)&ranging_packet, 0);
-         dwt_setdelayedtrxtime(DW_DELAY_FROM_US(RANGING_BROADCAST_INTERVAL_US + ((initiator_slot_first - current_slot) * RANGING_ITERATION_INTERVAL_US)));
-         current_slot = initiator_slot_first;
-         if (dwt_starttx(DWT_START_TX_DLY_TS) != DWT_SUCCESS)
-         {
-            print("ERROR: Failed to transmit initial RANGING REQUEST packet\n");
-            return RANGING_ERROR;
-         }
-         return RANGING_PHASE;
-      }
-      else if (current_slot <= responder_slots[responder_slot_index])
-      {
-         last_rx_relative_to_transmit = true;
-         last_rx_delay_time_us = RANGING_BROADCAST_INTERVAL_US + ((uint32_t)(responder_slots[responder_slot_index] - current_slot) * RANGING_ITERATION_INTERVAL_US) - RECEIVE_EARLY_START_US;
-         dwt_setdelayedtrxtime(DW_DELAY_FROM_US(last_rx_delay_time_us));
-         current_slot = (uint8_t)responder_slots[responder_slot_index];
-         if (!ranging_radio_rxenable(DWT_START_RX_DLY_TS))
-         {
-            print("ERROR: Unable to start listening for incoming RANGING REQUEST packets\n");
-            return RANGING_ERROR;
-         }
-         return RANGING_PHASE;
+         telemetry_record_tx_failure();
+         print("ERROR: Failed to transmit RANGING packet with sequence number %u\n", (uint32_t)sequence_num);
+         return RANGING_ERROR;
       }
    }
-   else
+   else if (!receive_packet(sequence_num))
    {
-      // Finished transmitting non-terminal packet...start listening for incoming responses
-      last_rx_relative_to_transmit = true;
-      last_rx_delay_time_us = RANGING_BROADCAST_INTERVAL_US - RECEIVE_EARLY_START_US;
-      dwt_setdelayedtrxtime(DW_DELAY_FROM_US(last_rx_delay_time_us));
-      if (!ranging_radio_rxenable(DWT_START_RX_DLY_TS))
+      print("ERROR: Unable to start listening for RANGING packet with sequence number %u\n", (uint32_t)sequence_num);
+      return RANGING_ERROR;
+   }
+   return RANGING_PHASE;
+}
+
+
+// Public functions ----------------------------------------------------------------------------------------------------
+
+void ranging_phase_initialize(const uint8_t *uid)
+{
+   // Initialize all Ranging Phase parameters
+   ranging_packet = (ranging_packet_t){ .header = { .frameCtrl = { 0x41, 0x98 }, .seqNum = 0,
+         .panID = { MODULE_PANID & 0xFF, MODULE_PANID >> 8 }, .destAddr = { 0xFF, 0xFF }, .sourceAddr = { 0 } },
+      .message_type = RANGING_PACKET, .antenna_plan = default_antenna_plan(), .round_trip_time = 0, .footer = { { 0 } } };
+   memcpy(ranging_packet.header.sourceAddr, uid, sizeof(ranging_packet.header.sourceAddr));
+   memset(antenna_statistics, 0, sizeof(antenna_statistics));
+   for (uint8_t i = 0; i < MAX_NUM_RANGING_DEVICES; ++i)
+      antenna_statistics[i].plan = default_antenna_plan();
+   next_replaced_statistics = 0;
+   scheduled_slot = 0xFF;
+   num_sub_slots = 0;
+   min_sleep_duration_us = RADIO_WAKEUP_SAFETY_DELAY_US + RADIO_MIN_SLEEP_TIME_US;
+}
+
+void ranging_phase_set_min_sleep_duration_us(uint32_t duration_us)
+{
+   // Only put the radio to sleep for gaps which outlast the current wakeup margin by a worthwhile amount of time
+   min_sleep_duration_us = duration_us;
+}
+
+scheduler_phase_t ranging_phase_begin(uint8_t ranging_slot, uint8_t num_slots, const uint16_t *schedule, uint16_t first_pair, uint16_t num_pairs, uint8_t num_antennas, bool single_sided_ranging, uint64_t reference_timestamp, uint32_t start_delay_us, int16_t clock_offset)
+{
+   // Ensure there are at least two devices to begin ranging
+   reset_computation_phase();
+   num_sub_slots = 0;
+   if (num_slots < 2)
+      return RANGE_COMPUTATION_PHASE;
+
+   // Reset the necessary Ranging Phase parameters
+   const uint16_t total_num_pairs = (uint16_t)num_slots * (num_slots - 1) / 2;
+   current_phase = RANGING_PHASE;
+   scheduled_slot = ranging_slot;
+   total_num_slots = num_slots;
+   num_sub_slots = (num_pairs < total_num_pairs) ? num_pairs : total_num_pairs;
+   single_sided = single_sided_ranging;
+   num_packets_per_sequence = single_sided ? RANGING_NUM_PACKETS_PER_SS_SEQUENCE : RANGING_NUM_PACKETS_PER_SEQUENCE;
+   num_packets_per_sub_slot = PAIRWISE_RANGING_SUB_SLOT_PACKETS(((num_antennas > 0) && (num_antennas <= NUM_ANTENNAS)) ? num_antennas : NUM_ANTENNAS, single_sided);
+   num_assigned_slots = assigned_slot_index = 0;
+   master_clock_offset = clock_offset;
+   phase_start_timestamp = (reference_timestamp + SYNCHRONIZED_US_TO_DW_TICKS(start_delay_us, master_clock_offset)) & DW_TIMESTAMP_MASK;
+   ranging_radio_set_packet_pan_id(&ranging_packet.header);
+
+   // Locate the first pair scheduled for this round, where pairs are ordered by initiator and then responder slot
+   uint16_t pair_index = first_pair % total_num_pairs;
+   uint8_t initiator = 0;
+   while (pair_index >= (num_slots - initiator - 1))
+      pair_index -= (num_slots - 1 - initiator++);
+   uint8_t responder = initiator + 1 + (uint8_t)pair_index;
+
+   // Determine the sub-slots in which this device acts as an initiator or a responder, each with a different peer
+   for (uint16_t sub_slot = 0; sub_slot < num_sub_slots; ++sub_slot)
+   {
+      if ((initiator == ranging_slot) || (responder == ranging_slot))
+         assigned_slots[num_assigned_slots++] = (assigned_slot_t){ .sub_slot = sub_slot,
+            .peer_statistics = get_antenna_statistics_index(schedule[(initiator == ranging_slot) ? responder : initiator]), .is_initiator = (initiator == ranging_slot) };
+      if (++responder == num_slots)
       {
-         print("ERROR: Unable to start listening for next RANGING REQUEST packets\n");
-         return RANGING_ERROR;
+         initiator = ((initiator + 2) < num_slots) ? (initiator + 1) : 0;
+         responder = initiator + 1;
       }
-      return RANGING_PHASE;
    }
+   telemetry_record_scheduled_peers(num_assigned_slots);
+
+   // Set up the correct initial antenna and RX timeout duration
+   antenna_index = 0xFF;
+   dwt_setrxtimeout(US_TO_DW_TIMEOUT(RANGING_TIMEOUT_US));
+   return begin_assigned_slot();
+}
+
+scheduler_phase_t ranging_phase_resume(uint32_t time_asleep_us)
+{
+   // The DW3000 system time restarts after sleeping, so re-anchor the start of the Ranging Phase using the elapsed MCU time
+   const int32_t phase_time_us = sleep_start_time_us + (int32_t)time_asleep_us;
+   phase_start_timestamp = ((uint64_t)dwt_readsystimestamphi32() << 8) & DW_TIMESTAMP_MASK;
+   phase_start_timestamp = ((phase_time_us < 0) ? (phase_start_timestamp + US_TO_DW_TICKS(-phase_time_us)) :
+         (phase_start_timestamp - US_TO_DW_TICKS(phase_time_us))) & DW_TIMESTAMP_MASK;
+
+   // Restore the radio settings which are lost during sleep and start the upcoming sub-slot
+   antenna_index = 0xFF;
+   dwt_setrxtimeout(US_TO_DW_TIMEOUT(RANGING_TIMEOUT_US));
+   return start_assigned_slot();
+}
+
+scheduler_phase_t ranging_phase_tx_complete(uint64_t tx_timestamp)
+{
+   // Forward this request to the next phase if not currently in the Ranging Phase
+   last_tx_timestamp = tx_timestamp;
+   if (current_phase != RANGING_PHASE)
+      return status_phase_tx_complete();
 
-   // Move to the Status Phase of the ranging protocol
-   current_phase = RANGE_STATUS_PHASE;
-   return status_phase_begin(scheduled_slot, total_num_slots, RANGING_BROADCAST_INTERVAL_US + ((num_sub_slots - current_slot) * RANGING_ITERATION_INTERVAL_US), true);
+   // Wait for the response to the packet that was just transmitted
+   return continue_with_sequence(current_sequence_num + 1, false);
 }
 
-scheduler_phase_t ranging_phase_rx_complete(ranging_packet_t* packet)
+scheduler_phase_t ranging_phase_rx_complete(ranging_packet_t* packet, uint64_t rx_timestamp, float signal_level, float nlos_indicator_db, int16_t clock_offset)
 {
    // Forward this request to the next phase if not currently in the Ranging Phase
    if (current_phase != RANGING_PHASE)
@@ -169,73 +422,61 @@ scheduler_phase_t ranging_phase_rx_complete(ranging_packet_t* packet)
       print("ERROR: Received an unexpected message type during RANGING phase...possible network collision\n");
       return MESSAGE_COLLISION;
    }
+   else if ((packet->header.seqNum >= num_packets_per_sub_slot) || (packet->header.seqNum < current_sequence_num) ||
+         (assigned_slots[assigned_slot_index].is_initiator == ((packet->header.seqNum % 2) == 0)))
+      return ranging_phase_rx_error();
 
-   // Switch to the next antenna when appropriate
-   if ((packet->header.seqNum == 3) || (packet->header.seqNum == 7))
-      ranging_radio_choose_antenna(++antenna_index);
+   // Keep track of the antenna plan being proposed or acknowledged by the peer, along with all devices it has heard
+   peer_heard = true;
+#if RANGE_STATUS_PIGGYBACK
+   status_phase_merge_device_statuses(packet->device_statuses);
+#endif
+   if (assigned_slots[assigned_slot_index].is_initiator)
+      plan_acknowledged = plan_acknowledged || (packet->antenna_plan == proposed_plan);
+   else
+      received_plan = packet->antenna_plan;
 
    // Compute the roundtrip transmission time when appropriate
-   if ((packet->header.seqNum == 1) || (packet->header.seqNum == 5) || (packet->header.seqNum == 9))
-   {
-      const uint64_t range_bias_correction = ranging_radio_compute_correction_for_signal_level(ranging_radio_received_signal_level());
-      ranging_packet.round_trip_time = (uint32_t)(ranging_radio_readrxtimestamp() - ranging_radio_readtxtimestamp() - range_bias_correction);
-      add_roundtrip1_time(packet->header.sourceAddr[0], (packet->header.seqNum - 1) / 4, ranging_packet.round_trip_time);
-   }
-   else if ((packet->header.seqNum == 2) || (packet->header.seqNum == 6) || (packet->header.seqNum == 10))
-   {
-      const uint64_t range_bias_correction = ranging_radio_compute_correction_for_signal_level(ranging_radio_received_signal_level());
-      ranging_packet.round_trip_time = (uint32_t)(ranging_radio_readrxtimestamp() - ranging_radio_readtxtimestamp() - range_bias_correction);
-      add_roundtrip1_time(packet->header.sourceAddr[0], (packet->header.seqNum - 2) / 4, packet->round_trip_time);
-      add_roundtrip2_time(packet->header.sourceAddr[0], (packet->header.seqNum - 2) / 4, ranging_packet.round_trip_time);
-   }
-   else if ((packet->header.seqNum == 3) || (packet->header.seqNum == 7) || (packet->header.seqNum == 11))
-      add_roundtrip2_time(packet->header.sourceAddr[0], (packet->header.seqNum - 3) / 4, packet->round_trip_time);
-
-   // Handle the ranging phase based on the sequence number of the packet that was just received
-   if (packet->header.seqNum == 11)
+   const uint8_t sequence_index = packet->header.seqNum / num_packets_per_sequence;
+   if (single_sided)
    {
-      // Finished current ranging iteration...continue to next time slot
-      ranging_radio_choose_antenna(0);
-      antenna_index = ranging_packet.header.seqNum = 0;
-      if (++current_slot <= initiator_slot_last)
-      {
-         dwt_writetxfctrl(sizeof(ranging_packet_t) - sizeof(ranging_packet.round_trip_time), 0, 1);
-         dwt_writetxdata(sizeof(ranging_packet_t) - sizeof(ranging_packet.round_trip_time), (uint8_t*)&ranging_packet, 0);
-         dwt_setdelayedtrxtime(DW_DELAY_FROM_US(RANGING_BROADCAST_INTERVAL_US));
-         if (dwt_starttx(DWT_START_TX_DLY_RS) != DWT_SUCCESS)
-         {
-            print("ERROR: Failed to transmit next RANGING REQUEST packet\n");
-            return RANGING_ERROR;
-         }
-         return RANGING_PHASE;
-      }
+      record_single_sided_times(packet, rx_timestamp, signal_level, nlos_indicator_db, clock_offset);
+      return continue_with_sequence(packet->header.seqNum + 1, true);
    }
-   else
+   switch (packet->header.seqNum % RANGING_NUM_PACKETS_PER_SEQUENCE)
    {
-      // Received non-terminal packet...send response
-      ranging_packet.header.seqNum = packet->header.seqNum + 1;
-      if ((packet->header.seqNum == 0) || (packet->header.seqNum == 4) || (packet->header.seqNum == 8) || (packet->header.seqNum == 3) || (packet->header.seqNum == 7))
-      {
-         dwt_writetxfctrl(sizeof(ranging_packet_t) - sizeof(ranging_packet.round_trip_time), 0, 1);
-         dwt_writetxdata(sizeof(ranging_packet_t) - sizeof(ranging_packet.round_trip_time), (uint8_t*)&ranging_packet, 0);
-      }
-      else
+      case 1:
       {
-         dwt_writetxfctrl(sizeof(ranging_packet_t), 0, 1);
-         dwt_writetxdata(sizeof(ranging_packet_t), (uint8_t*)&ranging_packet, 0);
+         const uint64_t range_bias_correction = double_sided_correction_for_signal_level(signal_level);
+         record_signal_level(signal_level);
+         add_signal_level(DEVICE_ID(packet->header.sourceAddr), signal_level);
+         add_nlos_indicator(DEVICE_ID(packet->header.sourceAddr), sequence_index, nlos_indicator_db);
+         ranging_packet.round_trip_time = (uint32_t)(rx_timestamp - last_tx_timestamp - range_bias_correction);
+         add_roundtrip1_time(DEVICE_ID(packet->header.sourceAddr), sequence_index, ranging_packet.round_trip_time);
+         break;
       }
-      dwt_setdelayedtrxtime(DW_DELAY_FROM_US(RANGING_BROADCAST_INTERVAL_US));
-      if (dwt_starttx(DWT_START_TX_DLY_RS) != DWT_SUCCESS)
+      case 2:
       {
-         print("ERROR: Failed to transmit RANGING RESPONSE packet with sequence number %u\n", (uint32_t)ranging_packet.header.seqNum);
-         return RANGING_ERROR;
+         const uint64_t range_bias_correction = double_sided_correction_for_signal_level(signal_level);
+         record_signal_level(signal_level);
+         add_signal_level(DEVICE_ID(packet->header.sourceAddr), signal_level);
+         add_nlos_indicator(DEVICE_ID(packet->header.sourceAddr), sequence_index, nlos_indicator_db);
+         ranging_packet.round_trip_time = (uint32_t)(rx_timestamp - last_tx_timestamp - range_bias_correction);
+         add_roundtrip1_time(DEVICE_ID(packet->header.sourceAddr), sequence_index, packet->round_trip_time);
+         add_roundtrip2_time(DEVICE_ID(packet->header.sourceAddr), sequence_index, ranging_packet.round_trip_time);
+         successful_sequences |= 1 << sequence_index;
+         break;
       }
-      return RANGING_PHASE;
+      case 3:
+         add_roundtrip2_time(DEVICE_ID(packet->header.sourceAddr), sequence_index, packet->round_trip_time);
+         successful_sequences |= 1 << sequence_index;
+         break;
+      default:
+         break;
    }
 
-   // Move to the Status Phase of the ranging protocol
-   current_phase = RANGE_STATUS_PHASE;
-   return status_phase_begin(scheduled_slot, total_num_slots, RANGING_BROADCAST_INTERVAL_US + ((num_sub_slots - current_slot) * RANGING_ITERATION_INTERVAL_US), false);
+   // Respond to the received packet or move on to the next sub-slot after the final packet
+   return continue_with_sequence(packet->header.seqNum + 1, true);
 }
 
 scheduler_phase_t ranging_phase_rx_error(void)
@@ -244,139 +485,23 @@ scheduler_phase_t ranging_phase_rx_error(void)
    if (current_phase != RANGING_PHASE)
       return status_phase_rx_error();
 
-   // Handle RX errors differently depending on which sequence number experienced the problem
-   if ((ranging_packet.header.seqNum == 8) || (ranging_packet.header.seqNum == 10))
-   {
-      // We are the initiator and did not receive a response on the final antenna...move to next time slot
-      antenna_index = 0;
-      ranging_radio_choose_antenna(0);
-      uint32_t delay_time_us = (uint32_t)(12 - ranging_packet.header.seqNum) * RANGING_BROADCAST_INTERVAL_US;
-      if (++current_slot <= initiator_slot_last)
-      {
-         ranging_packet.header.seqNum = 0;
-         dwt_writetxfctrl(sizeof(ranging_packet_t) - sizeof(ranging_packet.round_trip_time), 0, 1);
-         dwt_writetxdata(sizeof(ranging_packet_t) - sizeof(ranging_packet.round_trip_time), (uint8_t*)&ranging_packet, 0);
-         dwt_setdelayedtrxtime(DW_DELAY_FROM_US(delay_time_us));
-         if (dwt_starttx(DWT_START_TX_DLY_TS) != DWT_SUCCESS)
-         {
-            print("ERROR: Failed to transmit RANGING REQUEST packet after error\n");
-            return RANGING_ERROR;
-         }
-         return RANGING_PHASE;
-      }
-      else
-      {
-         // Move to the Range Status Phase of the ranging protocol
-         current_phase = RANGE_STATUS_PHASE;
-         return status_phase_begin(scheduled_slot, total_num_slots, delay_time_us + ((num_sub_slots - current_slot) * RANGING_ITERATION_INTERVAL_US), true);
-      }
-   }
-   else if ((ranging_packet.header.seqNum == 0) || (ranging_packet.header.seqNum == 2) || (ranging_packet.header.seqNum == 4) || (ranging_packet.header.seqNum == 6))
-   {
-      // We are the initiator and did not receive a response on the non-final antenna, skip to the next antenna
-      ranging_radio_choose_antenna(++antenna_index);
-      uint8_t next_sequence_num = 4 * ((4 + ranging_packet.header.seqNum) / 4);
-      uint32_t delay_time_us = (uint32_t)(next_sequence_num - ranging_packet.header.seqNum) * RANGING_BROADCAST_INTERVAL_US;
-      ranging_packet.header.seqNum = next_sequence_num;
-      dwt_writetxfctrl(sizeof(ranging_packet_t) - sizeof(ranging_packet.round_trip_time), 0, 1);
-      dwt_writetxdata(sizeof(ranging_packet_t) - sizeof(ranging_packet.round_trip_time), (uint8_t*)&ranging_packet, 0);
-      dwt_setdelayedtrxtime(DW_DELAY_FROM_US(delay_time_us));
-      if (dwt_starttx(DWT_START_TX_DLY_TS) != DWT_SUCCESS)
-      {
-         print("ERROR: Failed to transmit next RANGING REQUEST packet after error\n");
-         return RANGING_ERROR;
-      }
-      return RANGING_PHASE;
-   }
-   else if ((ranging_packet.header.seqNum == 7) || (ranging_packet.header.seqNum == 9))
-   {
-      // We are the responder and did not receive a response on the final antenna...move to next time slot
-      antenna_index = 0;
-      ++responder_slot_index;
-      ranging_radio_choose_antenna(0);
-      uint32_t delay_time_us = (uint32_t)(12 - ranging_packet.header.seqNum) * RANGING_BROADCAST_INTERVAL_US;
-      if ((++current_slot <= initiator_slot_first) && (initiator_slot_first < responder_slots[responder_slot_index]))
-      {
-         ranging_packet.header.seqNum = 0;
-         dwt_writetxfctrl(sizeof(ranging_packet_t) - sizeof(ranging_packet.round_trip_time), 0, 1);
-         dwt_writetxdata(sizeof(ranging_packet_t) - sizeof(ranging_packet.round_trip_time), (uint8_t*)&ranging_packet, 0);
-         dwt_setdelayedtrxtime(DW_DELAY_FROM_US(delay_time_us + ((initiator_slot_first - current_slot) * RANGING_ITERATION_INTERVAL_US)));
-         current_slot = initiator_slot_first;
-         if (dwt_starttx(DWT_START_TX_DLY_TS) != DWT_SUCCESS)
-         {
-            print("ERROR: Failed to transmit initial RANGING REQUEST packet after error\n");
-            return RANGING_ERROR;
-         }
-         return RANGING_PHASE;
-      }
-      else if (current_slot <= responder_slots[responder_slot_index])
-      {
-         last_rx_delay_time_us = delay_time_us + ((uint32_t)(responder_slots[responder_slot_index] - current_slot) * RANGING_ITERATION_INTERVAL_US) - RECEIVE_EARLY_START_US;
-         dwt_setdelayedtrxtime(DW_DELAY_FROM_US(last_rx_delay_time_us));
-         current_slot = (uint8_t)responder_slots[responder_slot_index];
-         if (!ranging_radio_rxenable(DWT_START_RX_DLY_TS))
-         {
-            print("ERROR: Unable to start listening for incoming RANGING REQUEST packets after error\n");
-            return RANGING_ERROR;
-         }
-         return RANGING_PHASE;
-      }
-   }
-   else if ((antenna_index + 1) == NUM_ANTENNAS)
-   {
-      // We are the responder and did not receive any responses...move to next time slot
-      antenna_index = 0;
-      ++responder_slot_index;
-      ranging_radio_choose_antenna(0);
-      last_rx_delay_time_us += (4 * RANGING_BROADCAST_INTERVAL_US);
-      if ((++current_slot <= initiator_slot_first) && (initiator_slot_first < responder_slots[responder_slot_index]))
-      {
-         ranging_packet.header.seqNum = 0;
-         dwt_writetxfctrl(sizeof(ranging_packet_t) - sizeof(ranging_packet.round_trip_time), 0, 1);
-         dwt_writetxdata(sizeof(ranging_packet_t) - sizeof(ranging_packet.round_trip_time), (uint8_t*)&ranging_packet, 0);
-         dwt_setdelayedtrxtime(DW_DELAY_FROM_US(last_rx_delay_time_us + RECEIVE_EARLY_START_US + ((initiator_slot_first - current_slot) * RANGING_ITERATION_INTERVAL_US)));
-         current_slot = initiator_slot_first;
-         if (dwt_starttx(last_rx_relative_to_transmit ? DWT_START_TX_DLY_TS : DWT_START_TX_DLY_RS) != DWT_SUCCESS)
-         {
-            print("ERROR: Failed to transmit RANGING REQUEST packet after error\n");
-            return RANGING_ERROR;
-         }
-         return RANGING_PHASE;
-      }
-      else if (current_slot <= responder_slots[responder_slot_index])
-      {
-         last_rx_delay_time_us += (uint32_t)(responder_slots[responder_slot_index] - current_slot) * RANGING_ITERATION_INTERVAL_US;
-         dwt_setdelayedtrxtime(DW_DELAY_FROM_US(last_rx_delay_time_us));
-         current_slot = (uint8_t)responder_slots[responder_slot_index];
-         if (!ranging_radio_rxenable(last_rx_relative_to_transmit ? DWT_START_RX_DLY_TS : DWT_START_RX_DLY_RS))
-         {
-            print("ERROR: Unable to start listening for new RANGING REQUEST packets after error\n");
-            return RANGING_ERROR;
-         }
-         return RANGING_PHASE;
-      }
-   }
-   else
-   {
-      // We are the responder and did not receive a response on the non-final antenna, skip to the next antenna
-      ranging_radio_choose_antenna(++antenna_index);
-      last_rx_delay_time_us += (((ranging_packet.header.seqNum == 11) || (ranging_packet.header.seqNum == 3)) ? 4 : 2) * RANGING_BROADCAST_INTERVAL_US;
-      dwt_setdelayedtrxtime(DW_DELAY_FROM_US(last_rx_delay_time_us));
-      ranging_packet.header.seqNum = 11;
-      if (!ranging_radio_rxenable(last_rx_relative_to_transmit ? DWT_START_RX_DLY_TS : DWT_START_RX_DLY_RS))
-      {
-         print("ERROR: Failed to start listening for next RANGING packet after error\n");
-         return RANGING_ERROR;
-      }
-      return RANGING_PHASE;
-   }
+   // Skip to the first packet on the next antenna, or to the next sub-slot after the final antenna
+   return continue_with_sequence(num_packets_per_sequence * ((current_sequence_num / num_packets_per_sequence) + 1), false);
+}
 
-   // Move to the Range Status Phase of the ranging protocol
-   current_phase = RANGE_STATUS_PHASE;
-   return status_phase_begin(scheduled_slot, total_num_slots, last_rx_delay_time_us + RECEIVE_EARLY_START_US + ((num_sub_slots - current_slot) * RANGING_ITERATION_INTERVAL_US), last_rx_relative_to_transmit);
+uint32_t ranging_phase_get_sleep_duration_us(void)
+{
+   return sleep_duration_us;
+}
+
+uint32_t ranging_phase_get_duration_us(void)
+{
+   return num_sub_slots * num_packets_per_sub_slot * RANGING_BROADCAST_INTERVAL_US;
 }
 
-uint32_t ranging_phase_get_time_slices(void)
+uint16_t ranging_phase_get_max_pairs_per_round(uint8_t num_slots, uint8_t num_antennas, bool single_sided_ranging, uint32_t scheduling_interval_us)
 {
-   return num_sub_slots;
+   // Determine how many ranging iterations fit into a scheduling interval alongside the Schedule and Status Phases
+   const int32_t available_time_us = (int32_t)scheduling_interval_us - (int32_t)ROUND_OVERHEAD_US((uint32_t)num_slots);
+   return (available_time_us > 0) ? (uint16_t)(available_time_us / (int32_t)PAIRWISE_RANGING_SUB_SLOT_US((uint32_t)num_antennas, single_sided_ranging)) : 0;
 }
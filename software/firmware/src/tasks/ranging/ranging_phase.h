@@ -11,8 +11,11 @@
 typedef struct __attribute__ ((__packed__))
 {
    ieee154_header_t header;
-   uint8_t message_type;
-   uint32_t round_trip_time;
+   uint8_t message_type, antenna_plan;
+#if RANGE_STATUS_PIGGYBACK
+   uint8_t device_statuses[RANGE_STATUS_BITMAP_LENGTH];
+#endif
+   uint32_t round_trip_time;                                                           // Reply time in single-sided responses
    ieee154_footer_t footer;
 } ranging_packet_t;
 
@@ -20,10 +23,14 @@ typedef struct __attribute__ ((__packed__))
 // Public API ----------------------------------------------------------------------------------------------------------
 
 void ranging_phase_initialize(const uint8_t *uid);
-scheduler_phase_t ranging_phase_begin(uint8_t ranging_slot, uint8_t num_slots, uint32_t start_delay_us, bool start_relative_to_transmit);
-scheduler_phase_t ranging_phase_tx_complete(void);
-scheduler_phase_t ranging_phase_rx_complete(ranging_packet_t* packet);
+void ranging_phase_set_min_sleep_duration_us(uint32_t duration_us);
+scheduler_phase_t ranging_phase_begin(uint8_t ranging_slot, uint8_t num_slots, const uint16_t *schedule, uint16_t first_pair, uint16_t num_pairs, uint8_t num_antennas, bool single_sided, uint64_t reference_timestamp, uint32_t start_delay_us, int16_t clock_offset);
+scheduler_phase_t ranging_phase_resume(uint32_t time_asleep_us);
+scheduler_phase_t ranging_phase_tx_complete(uint64_t tx_timestamp);
+scheduler_phase_t ranging_phase_rx_complete(ranging_packet_t* packet, uint64_t rx_timestamp, float signal_level, float nlos_indicator_db, int16_t clock_offset);
 scheduler_phase_t ranging_phase_rx_error(void);
-uint32_t ranging_phase_get_time_slices(void);
+uint32_t ranging_phase_get_sleep_duration_us(void);
+uint32_t ranging_phase_get_duration_us(void);
+uint16_t ranging_phase_get_max_pairs_per_round(uint8_t num_slots, uint8_t num_antennas, bool single_sided, uint32_t scheduling_interval_us);
 
 #endif  // #ifndef __RANGING_PHASE_HEADER_H__
@@ -1,16 +1,29 @@
 // Header Inclusions ---------------------------------------------------------------------------------------------------
 
+#include "broadcast_phase.h"
 #include "logging.h"
 #include "ranging_phase.h"
 #include "schedule_phase.h"
+#include "status_phase.h"
+#include "telemetry.h"
+#include "timing.h"
 
 
 // Static Global Variables ---------------------------------------------------------------------------------------------
 
-static uint8_t scheduled_slot, device_timeouts[MAX_NUM_RANGING_DEVICES];
-static schedule_packet_t schedule_packet;
-static scheduler_phase_t current_phase;
-static bool is_master_scheduler;
+static uint8_t scheduled_slot, relay_sequence_number, device_motion_statuses[MAX_NUM_RANGING_DEVICES];
+static uint8_t num_searched_networks, search_windows_since_scan;
+static uint16_t device_id, scheduled_device_ids[MAX_NUM_RANGING_DEVICES], searched_network_masters[NETWORK_SEARCH_MAX_NETWORKS];
+static uint32_t searched_round_start_times[NETWORK_SEARCH_MAX_NETWORKS], searched_scheduling_intervals_us[NETWORK_SEARCH_MAX_NETWORKS];
+static uint16_t next_ranging_pair;
+static int16_t clock_offset;
+static uint32_t device_timeouts_ms[MAX_NUM_RANGING_DEVICES];
+static uint32_t merge_contention_state, last_contended_round_start, round_start_time;
+static uint64_t last_tx_timestamp;
+static schedule_packet_t schedule_packet, foreign_schedule, merge_packet;
+static scheduler_phase_t current_phase, phase_after_merge_request;
+static bool is_master_scheduler, foreign_schedule_pending, foreign_schedule_heard, schedule_slots_changed, relayed_statuses_valid;
+static bool search_scan_complete, search_window_pending, search_all_channels, round_start_time_pending;
 
 
 // Private Helper Functions --------------------------------------------------------------------------------------------
@@ -18,31 +31,301 @@ static bool is_master_scheduler;
 static void deschedule_device(uint8_t device_index)
 {
    // Search for the specified EUI and move all subsequent devices up in the schedule
-   print("INFO: Descheduling device 0x%02X due to inactivity\n", schedule_packet.schedule[device_index]);
+   print("INFO: Descheduling device 0x%04X due to inactivity\n", (uint32_t)scheduled_device_ids[device_index]);
    for (int i = device_index + 1; i < MAX_NUM_RANGING_DEVICES; ++i)
    {
-      schedule_packet.schedule[i-1] = schedule_packet.schedule[i];
-      device_timeouts[i-1] = device_timeouts[i];
+      scheduled_device_ids[i-1] = scheduled_device_ids[i];
+      device_timeouts_ms[i-1] = device_timeouts_ms[i];
+      device_motion_statuses[i-1] = device_motion_statuses[i];
    }
-   schedule_packet.schedule[MAX_NUM_RANGING_DEVICES-1] = device_timeouts[MAX_NUM_RANGING_DEVICES-1] = 0;
+   scheduled_device_ids[MAX_NUM_RANGING_DEVICES-1] = device_motion_statuses[MAX_NUM_RANGING_DEVICES-1] = 0;
+   device_timeouts_ms[MAX_NUM_RANGING_DEVICES-1] = 0;
    --schedule_packet.num_devices;
+   schedule_slots_changed = true;
+}
+
+static uint16_t schedule_packet_size(const schedule_packet_t *schedule)
+{
+   // Return the over-the-air length of a schedule containing the specified number of devices and device ID exceptions
+   return sizeof(schedule_packet_t) - sizeof(schedule->schedule) + schedule->num_devices + (2 * schedule->num_id_exceptions);
+}
+
+static uint16_t get_scheduled_device_id(const schedule_packet_t *schedule, uint8_t slot)
+{
+   // Device IDs share the high byte of the schedule unless listed as an exception following the low bytes of all devices
+   const uint8_t *id_exceptions = schedule->schedule + schedule->num_devices;
+   for (uint8_t i = 0; i < schedule->num_id_exceptions; ++i)
+      if (id_exceptions[2*i] == slot)
+         return (uint16_t)(((uint16_t)id_exceptions[(2*i)+1] << 8) | schedule->schedule[slot]);
+   return (uint16_t)(((uint16_t)schedule->id_high_byte << 8) | schedule->schedule[slot]);
+}
+
+static uint8_t count_id_exceptions(uint16_t new_device_id)
+{
+   // Count the scheduled devices, including an optional new one, whose ID high byte differs from that of the master
+   uint8_t num_id_exceptions = new_device_id && ((new_device_id >> 8) != (scheduled_device_ids[0] >> 8));
+   for (uint8_t i = 1; i < schedule_packet.num_devices; ++i)
+      num_id_exceptions += ((scheduled_device_ids[i] >> 8) != (scheduled_device_ids[0] >> 8));
+   return num_id_exceptions;
+}
+
+static void encode_scheduled_device_ids(void)
+{
+   // Transmit the low byte of every scheduled device ID followed by the slot and high byte of any ID whose high byte
+   //   differs from that of the master, which keeps schedules as short as single-byte IDs for most deployments
+   uint8_t *id_exceptions = schedule_packet.schedule + schedule_packet.num_devices;
+   schedule_packet.id_high_byte = (uint8_t)(scheduled_device_ids[0] >> 8);
+   schedule_packet.num_id_exceptions = 0;
+   for (uint8_t i = 0; i < schedule_packet.num_devices; ++i)
+   {
+      schedule_packet.schedule[i] = (uint8_t)(scheduled_device_ids[i] & 0xFF);
+      if ((uint8_t)(scheduled_device_ids[i] >> 8) != schedule_packet.id_high_byte)
+      {
+         id_exceptions[2*schedule_packet.num_id_exceptions] = i;
+         id_exceptions[(2*schedule_packet.num_id_exceptions++)+1] = (uint8_t)(scheduled_device_ids[i] >> 8);
+      }
+   }
+}
+
+static uint8_t get_num_schedule_broadcasts(uint8_t num_devices)
+{
+   // The master's own broadcasts are followed by retransmissions from the participants in the first few schedule slots,
+   //   whereas flooded retransmissions after the master's broadcasts only occur when some devices missed all of them
+   if (SCHEDULE_FLOOD)
+      return SCHEDULE_NUM_MASTER_BROADCASTS;
+   return ((num_devices + SCHEDULE_NUM_MASTER_BROADCASTS - 1) < SCHEDULE_NUM_TOTAL_BROADCASTS) ?
+         (num_devices + SCHEDULE_NUM_MASTER_BROADCASTS - 1) : SCHEDULE_NUM_TOTAL_BROADCASTS;
+}
+
+static bool is_valid_device_list(const schedule_packet_t *schedule)
+{
+   // Ensure that a received schedule or merge request contains a usable device list
+   return schedule->num_devices && (schedule->num_devices <= MAX_NUM_RANGING_DEVICES);
+}
+
+static bool is_network_member(void)
+{
+   // Only masters and devices which have received a schedule from their master belong to a network
+   return is_master_scheduler || (scheduled_device_ids[0] != device_id);
+}
+
+static bool is_foreign_schedule(const schedule_packet_t *schedule)
+{
+   // Determine whether a packet is a schedule broadcast by the master of a different network
+   return (schedule->message_type == SCHEDULE_PACKET) && is_valid_device_list(schedule) && is_network_member() &&
+         (schedule->header.seqNum < SCHEDULE_NUM_TOTAL_BROADCASTS) && (get_scheduled_device_id(schedule, 0) != scheduled_device_ids[0]);
+}
+
+static uint32_t get_merge_slot_delay_after_transmit_us(void)
+{
+   // Return the delay from the most recently transmitted schedule until the merge request slot
+   return ((uint32_t)(SCHEDULE_NUM_TOTAL_BROADCASTS - schedule_packet.header.seqNum + 1)) * SCHEDULE_RESEND_INTERVAL_US;
+}
+
+static uint32_t get_round_start_time(uint8_t sequence_number, uint64_t timestamp)
+{
+   // Determine the DW3000 time at which the first schedule of a round was sent based on the last packet timestamp
+   return (uint32_t)(timestamp >> 8) - US_TO_DW_DELAY((uint32_t)sequence_number * SCHEDULE_RESEND_INTERVAL_US);
+}
+
+static bool wins_merge_contention(uint32_t round_start_time)
+{
+   // Contend only once for each merge request slot, even if multiple copies of the same schedule were received
+   const int32_t offset_from_last_round = (int32_t)(round_start_time - last_contended_round_start);
+   if ((offset_from_last_round > -(int32_t)US_TO_DW_DELAY(SCHEDULE_RESEND_INTERVAL_US)) && (offset_from_last_round < (int32_t)US_TO_DW_DELAY(SCHEDULE_RESEND_INTERVAL_US)))
+      return false;
+   last_contended_round_start = round_start_time;
+
+   // Randomly allow roughly one device per network to use the slot, seeding with the noisy packet timestamp
+   merge_contention_state = (merge_contention_state * 1103515245) + 12345 + round_start_time;
+   return !((merge_contention_state >> 16) % schedule_packet.num_devices);
+}
+
+static void set_search_sniff_mode(bool enable)
+{
+   // Duty-cycle the receiver while searching for a network, powering it only long enough to detect each preamble
+   dwt_setsniffmode(enable, NETWORK_SEARCH_SNIFF_ON_PACS, (uint8_t)US_TO_DW_SNIFF_OFF(NETWORK_SEARCH_SNIFF_OFF_US));
+}
+
+static void reset_network_search(void)
+{
+   // Forget all networks heard while searching so that the next search starts with a full scan
+   num_searched_networks = search_windows_since_scan = 0;
+   search_scan_complete = search_window_pending = false;
+}
+
+static void forget_searched_network(uint8_t index)
+{
+   // Replace the specified network heard while searching with the most recently added one
+   --num_searched_networks;
+   searched_network_masters[index] = searched_network_masters[num_searched_networks];
+   searched_round_start_times[index] = searched_round_start_times[num_searched_networks];
+   searched_scheduling_intervals_us[index] = searched_scheduling_intervals_us[num_searched_networks];
+}
+
+static void record_searched_network(const schedule_packet_t *schedule, uint64_t rx_timestamp)
+{
+   // Look up the network of a schedule which did not include this device, adding it if it has not been heard before
+   uint8_t index = 0;
+   const uint16_t master_id = get_scheduled_device_id(schedule, 0);
+   while ((index < num_searched_networks) && (searched_network_masters[index] != master_id))
+      ++index;
+   if (index == NETWORK_SEARCH_MAX_NETWORKS)
+      return;
+
+   // A full scan is complete once any network has been heard again in a later round, since all other networks with
+   //   similar round lengths must have been heard in between
+   const uint32_t round_start_time = get_round_start_time(schedule->header.seqNum, rx_timestamp);
+   if (index == num_searched_networks)
+      ++num_searched_networks;
+   else
+   {
+      const int32_t offset_from_last_round = (int32_t)(round_start_time - searched_round_start_times[index]);
+      if ((offset_from_last_round >= (int32_t)US_TO_DW_DELAY(SCHEDULE_RESEND_INTERVAL_US)) || (offset_from_last_round <= -(int32_t)US_TO_DW_DELAY(SCHEDULE_RESEND_INTERVAL_US)))
+         search_scan_complete = true;
+   }
+   searched_network_masters[index] = master_id;
+   searched_round_start_times[index] = round_start_time;
+   searched_scheduling_intervals_us[index] = (uint32_t)schedule->scheduling_interval_ms * 1000;
+}
+
+static scheduler_phase_t resume_schedule_reception(void)
+{
+   // Immediately restart listening for schedule packets
+   current_phase = SCHEDULE_PHASE;
+   if (!ranging_radio_rxenable(DWT_START_RX_IMMEDIATE))
+   {
+      print("ERROR: Unable to restart listening for schedule packets\n");
+      return RANGING_ERROR;
+   }
+   return SCHEDULE_PHASE;
+}
+
+static scheduler_phase_t begin_ranging_phase(uint64_t reference_timestamp, uint32_t start_delay_us)
+{
+   // Move to the Ranging Phase of the ranging protocol, with participants starting a new record of the devices heard
+   //   this round only after relaying the record from the previous round in their schedule retransmissions
+   current_phase = RANGING_PHASE;
+   if (!is_master_scheduler)
+      status_phase_reset_device_statuses(scheduled_slot, scheduled_device_ids);
+   if (schedule_packet.ranging_mode == RANGING_MODE_BROADCAST)
+      return broadcast_phase_begin(scheduled_slot, schedule_packet.num_devices, reference_timestamp, start_delay_us, clock_offset);
+   return ranging_phase_begin(scheduled_slot, schedule_packet.num_devices, scheduled_device_ids, schedule_packet.first_ranging_pair, schedule_packet.num_ranging_pairs, schedule_packet.num_ranging_antennas,
+         schedule_packet.ranging_mode == RANGING_MODE_SINGLE_SIDED, reference_timestamp, start_delay_us, clock_offset);
+}
+
+static scheduler_phase_t listen_for_merge_requests(void)
+{
+   // Listen for merge requests from other networks in the slot following all schedule broadcasts
+   current_phase = NETWORK_MERGE_PHASE;
+   dwt_setrxtimeout(US_TO_DW_TIMEOUT(SCHEDULE_MERGE_TIMEOUT_US));
+   dwt_setdelayedtrxtime(US_TO_DW_DELAY(get_merge_slot_delay_after_transmit_us() - RECEIVE_EARLY_START_US));
+   if (ranging_radio_rxenable(DWT_START_RX_DLY_TS))
+      return NETWORK_MERGE_PHASE;
+   print("ERROR: Unable to start listening for network merge requests\n");
+   return begin_ranging_phase(last_tx_timestamp, get_merge_slot_delay_after_transmit_us() + SCHEDULE_MERGE_SLOT_US);
+}
+
+static scheduler_phase_t listen_for_relayed_statuses(uint8_t sequence_number)
+{
+   // Listen to each participant retransmitting the schedule, which carries the device statuses it heard last round
+   relay_sequence_number = sequence_number;
+   if (sequence_number >= get_num_schedule_broadcasts(schedule_packet.num_devices))
+      return listen_for_merge_requests();
+   dwt_setrxtimeout(US_TO_DW_TIMEOUT(SCHEDULE_MERGE_TIMEOUT_US));
+   dwt_setdelayedtrxtime(US_TO_DW_DELAY(((uint32_t)(sequence_number - schedule_packet.header.seqNum + 1) * SCHEDULE_RESEND_INTERVAL_US) - RECEIVE_EARLY_START_US));
+   if (ranging_radio_rxenable(DWT_START_RX_DLY_TS))
+      return SCHEDULE_PHASE;
+   print("ERROR: Unable to start listening for relayed device statuses\n");
+   return listen_for_merge_requests();
+}
+
+static bool transmit_merge_request(const schedule_packet_t *device_list, uint32_t delay_us, bool delay_relative_to_transmit, scheduler_phase_t next_phase)
+{
+   // Send the specified network device list in a merge request slot and continue with the specified phase afterward
+   merge_packet = *device_list;
+   merge_packet.message_type = NETWORK_MERGE_PACKET;
+   memcpy(merge_packet.header.sourceAddr, schedule_packet.header.sourceAddr, sizeof(merge_packet.header.sourceAddr));
+   const uint16_t packet_size = schedule_packet_size(&merge_packet);
+   dwt_writetxfctrl(packet_size, 0, 0);
+   dwt_setdelayedtrxtime(US_TO_DW_DELAY(delay_us));
+   if ((dwt_writetxdata(packet_size, (uint8_t*)&merge_packet, 0) != DWT_SUCCESS) || (dwt_starttx(delay_relative_to_transmit ? DWT_START_TX_DLY_TS : DWT_START_TX_DLY_RS) != DWT_SUCCESS))
+   {
+      telemetry_record_tx_failure();
+      print("ERROR: Failed to transmit network merge request\n");
+      return false;
+   }
+   current_phase = NETWORK_MERGE_PHASE;
+   phase_after_merge_request = next_phase;
+   return true;
+}
+
+static bool handle_foreign_schedule(const schedule_packet_t *schedule, uint64_t rx_timestamp, scheduler_phase_t next_phase)
+{
+   // Remember the foreign network so that our master can merge with it
+   if (!foreign_schedule_pending || (get_scheduled_device_id(&foreign_schedule, 0) != get_scheduled_device_id(schedule, 0)))
+      print("INFO: Detected a foreign network with master 0x%04X\n", (uint32_t)get_scheduled_device_id(schedule, 0));
+   foreign_schedule = *schedule;
+   foreign_schedule_pending = foreign_schedule_heard = true;
+
+   // Ask the foreign master to merge with our network in its merge request slot
+   return wins_merge_contention(get_round_start_time(schedule->header.seqNum, rx_timestamp)) && transmit_merge_request(&schedule_packet,
+         ((uint32_t)(SCHEDULE_NUM_TOTAL_BROADCASTS - schedule->header.seqNum)) * SCHEDULE_RESEND_INTERVAL_US, false, next_phase);
+}
+
+static bool round_fits_all_pairs(uint32_t scheduling_interval_us)
+{
+   // Determine whether every device pair can be ranged within a single round of the specified length
+   const uint16_t total_num_pairs = (uint16_t)schedule_packet.num_devices * (schedule_packet.num_devices - 1) / 2;
+   if (schedule_packet.ranging_mode == RANGING_MODE_BROADCAST)
+      return scheduling_interval_us >= (ROUND_OVERHEAD_US((uint32_t)schedule_packet.num_devices) + broadcast_phase_get_required_duration_us(schedule_packet.num_devices));
+   return ranging_phase_get_max_pairs_per_round(schedule_packet.num_devices, schedule_packet.num_ranging_antennas, schedule_packet.ranging_mode == RANGING_MODE_SINGLE_SIDED, scheduling_interval_us) >= total_num_pairs;
+}
+
+static uint32_t select_scheduling_interval_us(void)
+{
+   // Use long rounds once every device reports stillness, and the nominal round length unless some device is moving
+   bool all_devices_still = true, any_device_moving = false;
+   for (uint8_t i = 0; i < schedule_packet.num_devices; ++i)
+   {
+      all_devices_still = all_devices_still && (device_motion_statuses[i] == MOTION_STATUS_STILL);
+      any_device_moving = any_device_moving || (device_motion_statuses[i] == MOTION_STATUS_MOVING);
+   }
+   if (all_devices_still)
+      return SCHEDULING_INTERVAL_STILL_US;
+   else if (!any_device_moving)
+      return SCHEDULING_INTERVAL_US;
+
+   // Shorten rounds while moving only as far as every device pair can still be ranged in each round
+   for (uint32_t scheduling_interval_us = SCHEDULING_INTERVAL_MOVING_US; scheduling_interval_us < SCHEDULING_INTERVAL_US; scheduling_interval_us += SCHEDULING_INTERVAL_RESOLUTION_US)
+      if (round_fits_all_pairs(scheduling_interval_us))
+         return scheduling_interval_us;
+   return SCHEDULING_INTERVAL_US;
 }
 
 
 // Public API Functions ------------------------------------------------------------------------------------------------
 
-void schedule_phase_initialize(const uint8_t *uid, bool is_master, uint32_t epoch_timestamp)
+void schedule_phase_initialize(const uint8_t *uid, bool is_master, bool search_channels, uint32_t epoch_timestamp)
 {
-   // Initialize all Schedule Phase parameters
+   // Initialize all Schedule Phase parameters, sending schedules to the broadcast PAN so that they are heard by devices
+   //   searching for a network and by co-channel networks which may need to merge
    schedule_packet = (schedule_packet_t){ .header = { .frameCtrl = { 0x41, 0x98 }, .seqNum = 0,
-         .panID = { MODULE_PANID & 0xFF, MODULE_PANID >> 8 }, .destAddr = { 0xFF, 0xFF }, .sourceAddr = { 0 } },
-      .message_type = SCHEDULE_PACKET, .epoch_time_unix = epoch_timestamp, .num_devices = 1,
-      .schedule = { 0 }, .footer = { { 0 } } };
-   memset(device_timeouts, 0, sizeof(device_timeouts));
+         .panID = { BROADCAST_PANID & 0xFF, BROADCAST_PANID >> 8 }, .destAddr = { 0xFF, 0xFF }, .sourceAddr = { 0 } },
+      .message_type = SCHEDULE_PACKET, .epoch_time_unix = epoch_timestamp, .epoch_time_ms = 0, .scheduling_interval_ms = SCHEDULING_INTERVAL_US / 1000, .round_number = 0, .clock_offset = 0, .num_devices = 1,
+      .ranging_mode = RANGING_MODE, .num_ranging_antennas = NUM_ANTENNAS, .num_id_exceptions = 0, .first_ranging_pair = 0, .num_ranging_pairs = 0,
+      .id_high_byte = 0, .schedule = { 0 }, .footer = { { 0 } } };
+   memset(device_timeouts_ms, 0, sizeof(device_timeouts_ms));
+   memset(device_motion_statuses, MOTION_STATUS_UNKNOWN, sizeof(device_motion_statuses));
    memcpy(schedule_packet.header.sourceAddr, uid, sizeof(schedule_packet.header.sourceAddr));
-   schedule_packet.schedule[0] = uid[0];
+   memset(scheduled_device_ids, 0, sizeof(scheduled_device_ids));
+   device_id = scheduled_device_ids[0] = DEVICE_ID(uid);
    is_master_scheduler = is_master;
+   search_all_channels = search_channels;
+   foreign_schedule_pending = foreign_schedule_heard = round_start_time_pending = false;
    scheduled_slot = 0;
+   reset_network_search();
+   next_ranging_pair = clock_offset = 0;
 }
 
 bool schedule_phase_begin(void)
@@ -57,24 +340,59 @@ bool schedule_phase_begin(void)
    // Begin transmission or reception depending on the current role
    if (is_master_scheduler)
    {
-      // Increment the epoch timestamp and increment all device timeouts
-      ++schedule_packet.epoch_time_unix;
+      // Advance the epoch timestamp and all device timeouts by the length of the previous round
+      schedule_packet.epoch_time_ms += schedule_packet.scheduling_interval_ms;
+      schedule_packet.epoch_time_unix += schedule_packet.epoch_time_ms / 1000;
+      schedule_packet.epoch_time_ms %= 1000;
       for (uint8_t i = 1; i < schedule_packet.num_devices; ++i)
-         ++device_timeouts[i];
+         device_timeouts_ms[i] += schedule_packet.scheduling_interval_ms;
+
+      // Range on only the best antennas for each pair, periodically re-probing all antennas to keep their statistics current
+      //   once every fixed number of rounds regardless of how long each round lasts
+      ++schedule_packet.round_number;
+      schedule_packet.num_ranging_antennas = (schedule_packet.round_number % RANGING_ANTENNA_REPROBE_INTERVAL_ROUNDS) ? RANGING_NUM_ADAPTIVE_ANTENNAS : NUM_ANTENNAS;
+
+      // Choose the length of this round based on the reported motion of all devices
+      const uint32_t scheduling_interval_us = select_scheduling_interval_us();
+      schedule_packet.scheduling_interval_ms = (uint16_t)(scheduling_interval_us / 1000);
+
+      // Select the next round-robin window of device pairs which fits into this round, noting that all pairs are ranged
+      //   simultaneously in every round when using broadcast ranging and that long rounds do not range more pairs than nominal ones
+      const uint16_t total_num_pairs = (uint16_t)schedule_packet.num_devices * (schedule_packet.num_devices - 1) / 2;
+      const uint16_t max_num_pairs = (schedule_packet.ranging_mode == RANGING_MODE_BROADCAST) ? total_num_pairs :
+            ranging_phase_get_max_pairs_per_round(schedule_packet.num_devices, schedule_packet.num_ranging_antennas, schedule_packet.ranging_mode == RANGING_MODE_SINGLE_SIDED, (scheduling_interval_us < SCHEDULING_INTERVAL_US) ? scheduling_interval_us : SCHEDULING_INTERVAL_US);
+      schedule_packet.num_ranging_pairs = (total_num_pairs < max_num_pairs) ? total_num_pairs : max_num_pairs;
+      schedule_packet.first_ranging_pair = total_num_pairs ? (next_ranging_pair % total_num_pairs) : 0;
+      next_ranging_pair = schedule_packet.first_ranging_pair + schedule_packet.num_ranging_pairs;
+
+      // Start a new record of the devices heard this round, ignoring relayed records from the previous round if the
+      //   schedule slots that they refer to have since shifted
+      status_phase_reset_device_statuses(0, scheduled_device_ids);
+      relayed_statuses_valid = !schedule_slots_changed;
+      schedule_slots_changed = false;
 
       // Schedule packet transmission
-      const uint16_t packet_size = sizeof(schedule_packet_t) - MAX_NUM_RANGING_DEVICES + schedule_packet.num_devices;
+      encode_scheduled_device_ids();
+      const uint16_t packet_size = schedule_packet_size(&schedule_packet);
       dwt_writetxfctrl(packet_size, 0, 0);
       if ((dwt_writetxdata(packet_size, (uint8_t*)&schedule_packet, 0) != DWT_SUCCESS) || (dwt_starttx(DWT_START_TX_IMMEDIATE) != DWT_SUCCESS))
       {
+         telemetry_record_tx_failure();
          print("ERROR: Failed to transmit schedule with length %u\n", (uint32_t)packet_size);
          return false;
       }
    }
    else
    {
-      // Set up packet reception with a timeout
-      dwt_setrxtimeout(DW_TIMEOUT_FROM_US(1000000.0));
+      // Alternate between channels while scanning for a network whose channel is unknown until some network is heard
+      if (search_all_channels && !is_network_member() && !search_window_pending && !num_searched_networks)
+         ranging_radio_choose_channel((ranging_radio_get_channel() == 5) ? 9 : 5);
+
+      // Scan for networks in sniff mode unless waking up for a round whose timing is already known, in which case
+      //   only listen within a short window around its expected start
+      set_search_sniff_mode(!is_network_member() && !search_window_pending);
+      dwt_setrxtimeout(US_TO_DW_TIMEOUT(search_window_pending ? NETWORK_SEARCH_WINDOW_US : 1000000));
+      search_window_pending = false;
       if (!ranging_radio_rxenable(DWT_START_RX_IMMEDIATE))
       {
          print("ERROR: Unable to start listening for schedule packets\n");
@@ -84,54 +402,100 @@ bool schedule_phase_begin(void)
    return true;
 }
 
-scheduler_phase_t schedule_phase_tx_complete(void)
+scheduler_phase_t schedule_phase_tx_complete(uint64_t tx_timestamp)
 {
+   // Continue with the appropriate phase after transmitting a network merge request
+   last_tx_timestamp = tx_timestamp;
+   if (current_phase == NETWORK_MERGE_PHASE)
+      switch (phase_after_merge_request)
+      {
+         case RANGING_PHASE:
+            return begin_ranging_phase(tx_timestamp, SCHEDULE_MERGE_SLOT_US);
+         case SCHEDULE_PHASE:
+            return resume_schedule_reception();
+         default:
+            return phase_after_merge_request;
+      }
+
    // Forward this request to the next phase if not currently in the Schedule Phase
    if (current_phase != SCHEDULE_PHASE)
-      return ranging_phase_tx_complete();
+      return (schedule_packet.ranging_mode == RANGING_MODE_BROADCAST) ? broadcast_phase_tx_complete() : ranging_phase_tx_complete(tx_timestamp);
 
    // Retransmit the schedule up to the specified number of times
    if ((++schedule_packet.header.seqNum < SCHEDULE_NUM_MASTER_BROADCASTS) && is_master_scheduler)
    {
-      dwt_setdelayedtrxtime(DW_DELAY_FROM_US(SCHEDULE_RESEND_INTERVAL_US));
+      dwt_setdelayedtrxtime(US_TO_DW_DELAY(SCHEDULE_RESEND_INTERVAL_US));
       if ((dwt_writetxdata(sizeof(schedule_packet.header.seqNum), &schedule_packet.header.seqNum, offsetof(ieee154_header_t, seqNum)) != DWT_SUCCESS) || (dwt_starttx(DWT_START_TX_DLY_TS) != DWT_SUCCESS))
       {
+         telemetry_record_tx_failure();
          print("ERROR: Failed to retransmit schedule\n");
          return RANGING_ERROR;
       }
       return SCHEDULE_PHASE;
    }
 
+   // Collect any device statuses relayed by participants, then listen for merge requests from other networks
+   const uint32_t merge_slot_delay_us = get_merge_slot_delay_after_transmit_us();
+   if (is_master_scheduler)
+      return RANGE_STATUS_PIGGYBACK ? listen_for_relayed_statuses(schedule_packet.header.seqNum) : listen_for_merge_requests();
+
+   // Forward any detected foreign network to our master in the merge request slot
+   if (foreign_schedule_pending && wins_merge_contention(get_round_start_time(schedule_packet.header.seqNum - 1, tx_timestamp)))
+   {
+      foreign_schedule_pending = false;
+      if (transmit_merge_request(&foreign_schedule, merge_slot_delay_us, true, RANGING_PHASE))
+         return NETWORK_MERGE_PHASE;
+   }
+
    // Move to the Ranging Phase of the ranging protocol
-   current_phase = RANGING_PHASE;
-   return ranging_phase_begin(scheduled_slot, schedule_packet.num_devices, ((uint32_t)(SCHEDULE_NUM_TOTAL_BROADCASTS - schedule_packet.header.seqNum + 1)) * SCHEDULE_RESEND_INTERVAL_US, true);
+   return begin_ranging_phase(tx_timestamp, merge_slot_delay_us + SCHEDULE_MERGE_SLOT_US);
 }
 
-scheduler_phase_t schedule_phase_rx_complete(schedule_packet_t* schedule)
+scheduler_phase_t schedule_phase_rx_complete(schedule_packet_t* schedule, uint64_t rx_timestamp, float signal_level, float nlos_indicator_db, int16_t received_clock_offset)
 {
+   // Record the device statuses relayed in a schedule retransmission and listen for the next one
+   if (is_master_scheduler && (current_phase == SCHEDULE_PHASE))
+   {
+#if RANGE_STATUS_PIGGYBACK
+      if (relayed_statuses_valid && (schedule->message_type == SCHEDULE_PACKET) && (get_scheduled_device_id(schedule, 0) == scheduled_device_ids[0]))
+         status_phase_merge_device_statuses(schedule->device_statuses);
+#endif
+      return listen_for_relayed_statuses(relay_sequence_number + 1);
+   }
+
+   // Record any merge request received in the merge request slot and move on to the Ranging Phase
+   if (current_phase == NETWORK_MERGE_PHASE)
+   {
+      if ((schedule->message_type == NETWORK_MERGE_PACKET) && is_valid_device_list(schedule) && (get_scheduled_device_id(schedule, 0) != scheduled_device_ids[0]))
+      {
+         foreign_schedule = *schedule;
+         foreign_schedule_pending = true;
+      }
+      return begin_ranging_phase(last_tx_timestamp, get_merge_slot_delay_after_transmit_us() + SCHEDULE_MERGE_SLOT_US);
+   }
+
    // Forward this request to the next phase if not currently in the Schedule Phase
    if (current_phase != SCHEDULE_PHASE)
    {
-      // Determine if a colliding network is present
+      // Request a merge with any foreign network whose schedule was received
+      if (is_foreign_schedule(schedule))
+         return handle_foreign_schedule(schedule, rx_timestamp, RANGE_COMPUTATION_PHASE) ? NETWORK_MERGE_PHASE : schedule_phase_rx_error(false);
+
+      // Ignore all other packets from devices outside of our network
       bool device_found = false;
       for (uint8_t i = 0; i < schedule_packet.num_devices; ++i)
-         if (schedule_packet.schedule[i] == schedule->header.sourceAddr[0])
+         if (scheduled_device_ids[i] == DEVICE_ID(schedule->header.sourceAddr))
          {
             device_found = true;
             break;
          }
-      return device_found ? ranging_phase_rx_complete((ranging_packet_t*)schedule) : MESSAGE_COLLISION;
+      if (!device_found)
+         return schedule_phase_rx_error(false);
+      return (schedule_packet.ranging_mode == RANGING_MODE_BROADCAST) ? broadcast_phase_rx_complete((broadcast_packet_t*)schedule, rx_timestamp, signal_level, nlos_indicator_db) :
+            ranging_phase_rx_complete((ranging_packet_t*)schedule, rx_timestamp, signal_level, nlos_indicator_db, received_clock_offset);
    }
    else if (schedule->message_type != SCHEDULE_PACKET)
-   {
-      // Immediately restart listening for schedule packets
-      if (!ranging_radio_rxenable(DWT_START_RX_IMMEDIATE))
-      {
-         print("ERROR: Unable to restart listening for schedule packets\n");
-         return RANGING_ERROR;
-      }
-      return SCHEDULE_PHASE;
-   }
+      return resume_schedule_reception();
 
    // Ensure that the received schedule length is valid
    if (schedule->num_devices > MAX_NUM_RANGING_DEVICES)
@@ -140,49 +504,118 @@ scheduler_phase_t schedule_phase_rx_complete(schedule_packet_t* schedule)
       return RANGING_ERROR;
    }
 
-   // Unpack the received schedule
-   scheduled_slot = 0;
-   schedule_packet.epoch_time_unix = schedule->epoch_time_unix;
-   schedule_packet.num_devices = schedule->num_devices;
-   for (uint8_t i = 0; i < schedule->num_devices; ++i)
+   // Ensure that the schedule included a slot for this device, otherwise asking a foreign master to merge with our network
+   uint8_t received_slot = 0;
+   for (uint8_t i = 1; i < schedule->num_devices; ++i)
+      if (get_scheduled_device_id(schedule, i) == device_id)
+         received_slot = i;
+   if (!received_slot)
    {
-      schedule_packet.schedule[i] = schedule->schedule[i];
-      if (schedule->schedule[i] == schedule_packet.header.sourceAddr[0])
-         scheduled_slot = i;
+      // Remember the round timing of every network heard while searching so that its next round can be awaited asleep
+      if (!is_network_member())
+         record_searched_network(schedule, rx_timestamp);
+
+      // Only report a failed search once per round, after the final broadcast of the received schedule
+      const scheduler_phase_t next_phase = ((schedule->header.seqNum + 1) >= get_num_schedule_broadcasts(schedule->num_devices)) ? RANGING_ERROR : SCHEDULE_PHASE;
+      if (is_foreign_schedule(schedule) && handle_foreign_schedule(schedule, rx_timestamp, next_phase))
+         return NETWORK_MERGE_PHASE;
+      return (next_phase == SCHEDULE_PHASE) ? resume_schedule_reception() : RANGING_ERROR;
    }
-   for (uint8_t i = schedule->num_devices; i < MAX_NUM_RANGING_DEVICES; ++i)
-      schedule_packet.schedule[i] = 0;
 
-   // Ensure that the schedule included a slot for this device
-   if (!scheduled_slot)
-      return RANGING_ERROR;
+   // Unpack the received schedule, stop searching for networks, and only accept packets addressed to this network
+   set_search_sniff_mode(false);
+   reset_network_search();
+   ranging_radio_choose_pan_id(NETWORK_PANID(get_scheduled_device_id(schedule, 0)));
+   scheduled_slot = received_slot;
+   schedule_packet.epoch_time_unix = schedule->epoch_time_unix;
+   schedule_packet.epoch_time_ms = schedule->epoch_time_ms;
+   schedule_packet.scheduling_interval_ms = schedule->scheduling_interval_ms;
+   schedule_packet.round_number = schedule->round_number;
+   schedule_packet.num_devices = schedule->num_devices;
+   schedule_packet.ranging_mode = schedule->ranging_mode;
+   schedule_packet.num_ranging_antennas = schedule->num_ranging_antennas;
+   schedule_packet.num_id_exceptions = schedule->num_id_exceptions;
+   schedule_packet.first_ranging_pair = schedule->first_ranging_pair;
+   schedule_packet.num_ranging_pairs = schedule->num_ranging_pairs;
+   schedule_packet.id_high_byte = schedule->id_high_byte;
+   memcpy(schedule_packet.schedule, schedule->schedule, schedule->num_devices + (2 * schedule->num_id_exceptions));
+   for (uint8_t i = 0; i < MAX_NUM_RANGING_DEVICES; ++i)
+      scheduled_device_ids[i] = (i < schedule->num_devices) ? get_scheduled_device_id(schedule, i) : 0;
+
+   // Synchronize to the master's clock, adding the offset which a relaying device measured against the master to our
+   //   own offset from the sender, and remember when the master started this round
+#if SCHEDULE_FLOOD
+   // Flooded relays cannot insert their own offset into the identical packets, so only the master's first broadcast,
+   //   which no device relays, measures the master's clock directly; otherwise keep the last direct measurement
+   if (!schedule->header.seqNum)
+      clock_offset = received_clock_offset;
+#else
+   clock_offset = received_clock_offset + schedule->clock_offset;
+#endif
+   schedule_packet.clock_offset = clock_offset;
+   round_start_time = get_round_start_time(schedule->header.seqNum, rx_timestamp);
+   round_start_time_pending = true;
 
    // Retransmit the schedule at the specified time slot
+#if SCHEDULE_FLOOD
+   // Relay the received schedule unchanged apart from its sequence number in the very next slot, so that every device
+   //   which received it in the same slot transmits an identical packet at the same time and the schedule floods the
+   //   network one hop per slot
+   const schedule_packet_t *relayed_schedule = schedule;
+   schedule_packet.header.seqNum = schedule->header.seqNum + 1;
+#else
+   const schedule_packet_t *relayed_schedule = &schedule_packet;
    schedule_packet.header.seqNum = scheduled_slot + SCHEDULE_NUM_MASTER_BROADCASTS - 1;
+#endif
    if ((schedule->header.seqNum < schedule_packet.header.seqNum) && (schedule_packet.header.seqNum < SCHEDULE_NUM_TOTAL_BROADCASTS))
    {
-      const uint16_t packet_size = sizeof(schedule_packet_t) - MAX_NUM_RANGING_DEVICES + schedule_packet.num_devices;
+#if RANGE_STATUS_PIGGYBACK
+      memcpy(schedule_packet.device_statuses, status_phase_get_device_statuses(), sizeof(schedule_packet.device_statuses));
+#endif
+      const uint16_t packet_size = schedule_packet_size(&schedule_packet);
       dwt_writetxfctrl(packet_size, 0, 0);
-      dwt_setdelayedtrxtime(DW_DELAY_FROM_US((uint32_t)(schedule_packet.header.seqNum - schedule->header.seqNum) * SCHEDULE_RESEND_INTERVAL_US));
-      if ((dwt_writetxdata(packet_size, (uint8_t*)&schedule_packet, 0) != DWT_SUCCESS) || (dwt_starttx(DWT_START_TX_DLY_RS) != DWT_SUCCESS))
+      // Remove the antenna delays contained in the reception timestamp to align the retransmission with the master's slots
+      dwt_setdelayedtrxtime(US_TO_DW_DELAY((uint32_t)(schedule_packet.header.seqNum - schedule->header.seqNum) * SCHEDULE_RESEND_INTERVAL_US) - (ranging_radio_get_antenna_delay() >> 8));
+      if ((dwt_writetxdata(packet_size, (uint8_t*)relayed_schedule, 0) != DWT_SUCCESS) ||
+            (dwt_writetxdata(sizeof(schedule_packet.header.seqNum), &schedule_packet.header.seqNum, offsetof(ieee154_header_t, seqNum)) != DWT_SUCCESS) ||
+            (dwt_starttx(DWT_START_TX_DLY_RS) != DWT_SUCCESS))
       {
+         telemetry_record_tx_failure();
          print("ERROR: Failed to retransmit received schedule\n");
          return RANGING_ERROR;
       }
       return SCHEDULE_PHASE;
    }
 
+   // Forward any detected foreign network to our master in the merge request slot
+   const uint32_t merge_slot_delay_us = ((uint32_t)(SCHEDULE_NUM_TOTAL_BROADCASTS - schedule->header.seqNum)) * SCHEDULE_RESEND_INTERVAL_US;
+   if (foreign_schedule_pending && wins_merge_contention(get_round_start_time(schedule->header.seqNum, rx_timestamp)))
+   {
+      foreign_schedule_pending = false;
+      if (transmit_merge_request(&foreign_schedule, merge_slot_delay_us, false, RANGING_PHASE))
+         return NETWORK_MERGE_PHASE;
+   }
+
    // Move to the Ranging Phase of the ranging protocol
-   current_phase = RANGING_PHASE;
-   return ranging_phase_begin(scheduled_slot, schedule_packet.num_devices, ((uint32_t)(SCHEDULE_NUM_TOTAL_BROADCASTS - schedule->header.seqNum)) * SCHEDULE_RESEND_INTERVAL_US, false);
+   return begin_ranging_phase(rx_timestamp, merge_slot_delay_us + SCHEDULE_MERGE_SLOT_US);
 }
 
-scheduler_phase_t schedule_phase_rx_error(void)
+scheduler_phase_t schedule_phase_rx_error(bool timed_out)
 {
+   // Keep listening for relayed device statuses if a schedule retransmission was missed
+   if (is_master_scheduler && (current_phase == SCHEDULE_PHASE))
+      return listen_for_relayed_statuses(relay_sequence_number + 1);
+
+   // Move on to the Ranging Phase if no merge requests were received in the merge request slot
+   if (current_phase == NETWORK_MERGE_PHASE)
+      return begin_ranging_phase(last_tx_timestamp, get_merge_slot_delay_after_transmit_us() + SCHEDULE_MERGE_SLOT_US);
+
    // Forward this request to the next phase if not currently in the Schedule Phase
    if (current_phase != SCHEDULE_PHASE)
-      return ranging_phase_rx_error();
-   return RANGING_ERROR;
+      return (schedule_packet.ranging_mode == RANGING_MODE_BROADCAST) ? broadcast_phase_rx_error() : ranging_phase_rx_error();
+
+   // Keep searching for a schedule after receiving a corrupted packet, which is common on a busy channel
+   return timed_out ? RANGING_ERROR : resume_schedule_reception();
 }
 
 uint32_t schedule_phase_get_num_devices(void)
@@ -197,34 +630,117 @@ uint32_t schedule_phase_get_timestamp(void)
    return schedule_packet.epoch_time_unix;
 }
 
-void schedule_phase_add_device(uint8_t eui)
+uint16_t schedule_phase_get_timestamp_ms(void)
+{
+   // Return the sub-second part of the current epoch timestamp from the schedule
+   return schedule_packet.epoch_time_ms;
+}
+
+int16_t schedule_phase_get_clock_offset(void)
+{
+   // Return the offset of the local clock from the master's clock in units of 1/16 ppm
+   return clock_offset;
+}
+
+bool schedule_phase_get_round_start_time(uint32_t *start_time)
+{
+   // Report the DW3000 time at which the master started the current round only once after each received schedule
+   const bool round_start_time_valid = round_start_time_pending;
+   *start_time = round_start_time;
+   round_start_time_pending = false;
+   return round_start_time_valid;
+}
+
+bool schedule_phase_foreign_network_heard(void)
+{
+   // Report whether a foreign network schedule was heard since the previous call
+   const bool heard = foreign_schedule_heard;
+   foreign_schedule_heard = false;
+   return heard;
+}
+
+uint32_t schedule_phase_get_ranging_duration_us(void)
+{
+   // Return the duration of the Ranging Phase for the ranging mode used in the current round
+   if (schedule_packet.ranging_mode == RANGING_MODE_BROADCAST)
+      return broadcast_phase_get_duration_us();
+   return ranging_phase_get_duration_us();
+}
+
+uint32_t schedule_phase_get_scheduling_interval_us(void)
+{
+   // Return the length of the current round
+   return (uint32_t)schedule_packet.scheduling_interval_ms * 1000;
+}
+
+uint32_t schedule_phase_get_search_sleep_us(void)
+{
+   // Keep scanning until every nearby network has been heard, periodically rescanning to discover new networks
+   if (search_scan_complete && (++search_windows_since_scan > NETWORK_SEARCH_WINDOWS_PER_SCAN))
+      reset_network_search();
+   if (!search_scan_complete)
+      return 0;
+
+   // Find the next round of any searched network, forgetting networks whose most recent round was missed
+   const uint32_t current_time = dwt_readsystimestamphi32();
+   uint32_t time_until_next_round_us = 0xFFFFFFFF;
+   for (uint8_t i = 0; i < num_searched_networks; ++i)
+   {
+      const uint32_t elapsed_us = DW_DELAY_TO_US(current_time - searched_round_start_times[i]);
+      if (elapsed_us >= searched_scheduling_intervals_us[i])
+         forget_searched_network(i--);
+      else if ((searched_scheduling_intervals_us[i] - elapsed_us) < time_until_next_round_us)
+         time_until_next_round_us = searched_scheduling_intervals_us[i] - elapsed_us;
+   }
+   if (!num_searched_networks)
+   {
+      reset_network_search();
+      return 0;
+   }
+
+   // Sleep until shortly before that round, or listen for it right away if it starts too soon for the radio to sleep
+   search_window_pending = true;
+   if (time_until_next_round_us < (RADIO_WAKEUP_SAFETY_DELAY_US + RADIO_MIN_SLEEP_TIME_US))
+      return 0;
+   return time_until_next_round_us - RADIO_WAKEUP_SAFETY_DELAY_US;
+}
+
+void schedule_phase_add_device(uint16_t new_device_id)
 {
    // Search for the first empty schedule slot
    for (int i = 1; i < MAX_NUM_RANGING_DEVICES; ++i)
    {
       // Ensure that the device has not already been scheduled
-      if (schedule_packet.schedule[i] == eui)
+      if (scheduled_device_ids[i] == new_device_id)
       {
-         device_timeouts[i] = 0;
+         device_timeouts_ms[i] = 0;
          break;
       }
-      else if (schedule_packet.schedule[i] == 0)
+      else if (scheduled_device_ids[i] == 0)
       {
-         device_timeouts[i] = 0;
-         schedule_packet.schedule[i] = eui;
+         // Ensure that the device ID can be encoded into the schedule packet
+         if (count_id_exceptions(new_device_id) > SCHEDULE_MAX_ID_EXCEPTIONS)
+         {
+            print("ERROR: Unable to schedule device 0x%04X with too many different ID high bytes already scheduled\n", (uint32_t)new_device_id);
+            break;
+         }
+         device_timeouts_ms[i] = 0;
+         device_motion_statuses[i] = MOTION_STATUS_UNKNOWN;
+         scheduled_device_ids[i] = new_device_id;
          ++schedule_packet.num_devices;
          break;
       }
    }
 }
 
-void schedule_phase_update_device_presence(uint8_t eui)
+void schedule_phase_update_device_presence(uint16_t present_device_id, uint8_t motion_status)
 {
-   // Reset the device timeout for the corresponding EUI
-   for (uint8_t i = 1; i < schedule_packet.num_devices; ++i)
-      if (schedule_packet.schedule[i] == eui)
+   // Reset the device timeout and store the reported motion status for the corresponding device ID
+   for (uint8_t i = 0; i < schedule_packet.num_devices; ++i)
+      if (scheduled_device_ids[i] == present_device_id)
       {
-         device_timeouts[i] = 0;
+         device_timeouts_ms[i] = 0;
+         device_motion_statuses[i] = motion_status;
          break;
       }
 }
@@ -233,6 +749,32 @@ void schedule_phase_handle_device_timeouts(void)
 {
    // Deschedule any devices that have been absent for a long time
    for (uint8_t i = 1; i < schedule_packet.num_devices; ++i)
-      if (device_timeouts[i] > DEVICE_TIMEOUT_SECONDS)
+      if (device_timeouts_ms[i] > (DEVICE_TIMEOUT_SECONDS * 1000))
          deschedule_device(i--);
 }
+
+bool schedule_phase_handle_network_merge(void)
+{
+   // Only masters act upon foreign networks detected during the previous round
+   if (!is_master_scheduler || !foreign_schedule_pending)
+      return false;
+   foreign_schedule_pending = false;
+
+   // Yield to the foreign master if it has the higher ID
+   const uint16_t foreign_master_id = get_scheduled_device_id(&foreign_schedule, 0);
+   if (foreign_master_id > scheduled_device_ids[0])
+   {
+      print("INFO: Merging into the network with master 0x%04X\n", (uint32_t)foreign_master_id);
+      return true;
+   }
+
+   // Otherwise, fold all devices from the foreign network into our own schedule
+   print("INFO: Merging the network with master 0x%04X into our own\n", (uint32_t)foreign_master_id);
+   for (uint8_t i = 0; i < foreign_schedule.num_devices; ++i)
+   {
+      const uint16_t foreign_device_id = get_scheduled_device_id(&foreign_schedule, i);
+      if (foreign_device_id && (foreign_device_id != scheduled_device_ids[0]))
+         schedule_phase_add_device(foreign_device_id);
+   }
+   return false;
+}
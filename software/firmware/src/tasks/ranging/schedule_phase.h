@@ -13,23 +13,44 @@ typedef struct __attribute__ ((__packed__))
    ieee154_header_t header;
    uint8_t message_type;
    uint32_t epoch_time_unix;
+   uint16_t epoch_time_ms;                                                             // Sub-second part of the round start time
+   uint16_t scheduling_interval_ms;
+   uint16_t round_number;                                                              // Incremented by the master every round
+   int16_t clock_offset;                                                               // Offset of the sender's clock from the master's
    uint8_t num_devices;
-   uint8_t schedule[MAX_NUM_RANGING_DEVICES];
+   uint16_t ranging_mode : 2, num_ranging_antennas : 2, num_id_exceptions : 5;
+   uint16_t first_ranging_pair, num_ranging_pairs;
+#if RANGE_STATUS_PIGGYBACK
+   uint8_t device_statuses[RANGE_STATUS_BITMAP_LENGTH];
+#endif
+   uint8_t id_high_byte;                                                               // Shared high byte of all device IDs
+   uint8_t schedule[MAX_NUM_RANGING_DEVICES + (2 * SCHEDULE_MAX_ID_EXCEPTIONS)];      // ID low bytes, then (slot, high byte) exceptions
    ieee154_footer_t footer;
 } schedule_packet_t;
 
+_Static_assert(NUM_ANTENNAS < (1 << 2), "NUM_ANTENNAS does not fit into the schedule packet");
+_Static_assert(SCHEDULE_MAX_ID_EXCEPTIONS < (1 << 5), "SCHEDULE_MAX_ID_EXCEPTIONS does not fit into the schedule packet");
+
 
 // Public API ----------------------------------------------------------------------------------------------------------
 
-void schedule_phase_initialize(const uint8_t *uid, bool is_master, uint32_t epoch_timestamp);
+void schedule_phase_initialize(const uint8_t *uid, bool is_master, bool search_channels, uint32_t epoch_timestamp);
 bool schedule_phase_begin(void);
-scheduler_phase_t schedule_phase_tx_complete(void);
-scheduler_phase_t schedule_phase_rx_complete(schedule_packet_t* schedule);
-scheduler_phase_t schedule_phase_rx_error(void);
+scheduler_phase_t schedule_phase_tx_complete(uint64_t tx_timestamp);
+scheduler_phase_t schedule_phase_rx_complete(schedule_packet_t* schedule, uint64_t rx_timestamp, float signal_level, float nlos_indicator_db, int16_t clock_offset);
+scheduler_phase_t schedule_phase_rx_error(bool timed_out);
 uint32_t schedule_phase_get_num_devices(void);
 uint32_t schedule_phase_get_timestamp(void);
-void schedule_phase_add_device(uint8_t eui);
-void schedule_phase_update_device_presence(uint8_t eui);
+uint16_t schedule_phase_get_timestamp_ms(void);
+int16_t schedule_phase_get_clock_offset(void);
+bool schedule_phase_get_round_start_time(uint32_t *round_start_time);
+bool schedule_phase_foreign_network_heard(void);
+uint32_t schedule_phase_get_ranging_duration_us(void);
+uint32_t schedule_phase_get_scheduling_interval_us(void);
+uint32_t schedule_phase_get_search_sleep_us(void);
+void schedule_phase_add_device(uint16_t device_id);
+void schedule_phase_update_device_presence(uint16_t device_id, uint8_t motion_status);
 void schedule_phase_handle_device_timeouts(void);
+bool schedule_phase_handle_network_merge(void);
 
 #endif  // #ifndef __SCHEDULE_PHASE_HEADER_H__
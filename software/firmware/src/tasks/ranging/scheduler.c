@@ -1,6 +1,7 @@
 // Header Inclusions ---------------------------------------------------------------------------------------------------
 
 #include "bluetooth.h"
+#include "broadcast_phase.h"
 #include "computation_phase.h"
 #include "deca_interface.h"
 #include "logging.h"
@@ -9,28 +10,212 @@
 #include "scheduler.h"
 #include "status_phase.h"
 #include "system.h"
+#include "telemetry.h"
+#include "timing.h"
+
+
+// Data Structures -----------------------------------------------------------------------------------------------------
+
+typedef struct
+{
+   ranging_interrupt_reason_t type;
+   float signal_level, nlos_indicator_db;
+   int16_t clock_offset;
+   uint8_t timer_rearm_count;
+   volatile bool is_complete;
+   uint32_t timer_ticks;
+   uint64_t timestamp;
+   union { schedule_packet_t schedule; ranging_packet_t ranging; broadcast_packet_t broadcast; status_success_packet_t status; } packet;
+} ranging_event_t;
+
+_Static_assert((RANGING_EVENT_QUEUE_LENGTH & (RANGING_EVENT_QUEUE_LENGTH - 1)) == 0, "RANGING_EVENT_QUEUE_LENGTH must be a power of two");
+_Static_assert(RANGING_EVENT_QUEUE_LENGTH <= 128, "RANGING_EVENT_QUEUE_LENGTH must be representable by the 8-bit queue indices");
 
 
 // Static Global Variables ---------------------------------------------------------------------------------------------
 
+static ranging_event_t event_queue[RANGING_EVENT_QUEUE_LENGTH];
+static volatile uint8_t event_queue_head, event_queue_tail, event_queue_reserved;
 static scheduler_phase_t ranging_phase;
+static schedule_role_t scheduler_role;
 static TaskHandle_t notification_handle;
 static am_hal_timer_config_t wakeup_timer_config;
 static uint8_t ranging_results[MAX_COMPRESSED_RANGE_DATA_LENGTH];
-static uint8_t read_buffer[768], device_eui, schedule_reception_timeout;
+static uint8_t network_channel, schedule_reception_timeout;
 static uint8_t empty_round_timeout, eui[EUI_LEN];
+static uint16_t device_id;
+static uint8_t round_start_tenths, scheduler_alarm_repeat_interval;
+static volatile uint8_t motion_status = MOTION_STATUS_UNKNOWN;
+static volatile ranging_interrupt_reason_t wakeup_timer_reason;
+static volatile uint8_t wakeup_timer_rearm_count;
+static uint32_t radio_wakeup_timestamp, radio_wakeup_timer_ticks;
+static uint32_t radio_wakeup_latency_us, synchronization_error_us, synchronized_interval_us;
+static uint64_t calibration_timer_ticks, calibration_radio_time, elapsed_timer_ticks, round_start_timer_ticks;
+static int32_t timer_drift;
+static uint8_t num_synchronized_rounds, rounds_since_merge_scan;
+static bool round_start_known, radio_wakeup_latency_known;
+static volatile uint32_t rtc_ticks_per_round, rtc_tick_count;
 static volatile bool is_running, is_starting;
 
 
 // Private Helper Functions --------------------------------------------------------------------------------------------
 
+static uint64_t us_to_wakeup_timer_ticks(uint32_t duration_us)
+{
+   return ((uint64_t)RADIO_WAKEUP_TIMER_TICK_RATE_HZ * duration_us) / 1000000;
+}
+
+static uint64_t read_elapsed_timer_ticks(void)
+{
+   // Return the total number of wakeup timer ticks since the scheduler started, which are not lost when the timer is rearmed
+   return elapsed_timer_ticks + am_hal_timer_read(RADIO_WAKEUP_TIMER_NUMBER);
+}
+
+static void arm_wakeup_timer(uint32_t duration_us, ranging_interrupt_reason_t reason)
+{
+   // Set a timer to notify the main task after the specified duration
+   ++wakeup_timer_rearm_count;
+   elapsed_timer_ticks = read_elapsed_timer_ticks();
+   wakeup_timer_reason = reason;
+   wakeup_timer_config.ui32Compare0 = (uint32_t)us_to_wakeup_timer_ticks(duration_us);
+   am_hal_timer_config(RADIO_WAKEUP_TIMER_NUMBER, &wakeup_timer_config);
+   am_hal_timer_clear(RADIO_WAKEUP_TIMER_NUMBER);
+}
+
+static uint32_t wakeup_timer_ticks_to_us(uint32_t timer_ticks)
+{
+   // Convert wakeup timer ticks into DW3000 microseconds using the measured ratio between the two clocks once available
+   if (calibration_timer_ticks < (RADIO_WAKEUP_TIMER_TICK_RATE_HZ / 10))
+      return (uint32_t)(((uint64_t)timer_ticks * 1000000) / RADIO_WAKEUP_TIMER_TICK_RATE_HZ);
+   return DW_DELAY_TO_US(((uint64_t)timer_ticks * calibration_radio_time) / calibration_timer_ticks);
+}
+
+static void radio_wakeup(void)
+{
+   // Wake up the radio and keep track of when it became active
+   ranging_radio_wakeup();
+   radio_wakeup_timer_ticks = am_hal_timer_read(RADIO_WAKEUP_TIMER_NUMBER);
+   radio_wakeup_timestamp = dwt_readsystimestamphi32();
+}
+
+static void record_radio_activity(void)
+{
+   // Add the time that the radio has been active since it was last woken up to the telemetry of the current round
+   const uint32_t timer_ticks = am_hal_timer_read(RADIO_WAKEUP_TIMER_NUMBER), radio_time = dwt_readsystimestamphi32();
+   telemetry_record_radio_activity(DW_DELAY_TO_US(radio_time - radio_wakeup_timestamp));
+
+   // Measure the wakeup timer against the DW3000 clock, gradually forgetting old measurements to track temperature drift
+   calibration_timer_ticks += timer_ticks - radio_wakeup_timer_ticks;
+   calibration_radio_time += radio_time - radio_wakeup_timestamp;
+   if (calibration_timer_ticks >= (1UL << 30))
+   {
+      calibration_timer_ticks /= 2;
+      calibration_radio_time /= 2;
+   }
+}
+
+static uint32_t get_radio_wakeup_margin_us(void)
+{
+   // Keep the full safety margin until the radio wakeup latency has been measured, and afterward only wake early enough
+   //   to cover the worst recent latency plus a guard for the processing needed to resume radio activity
+   if (!radio_wakeup_latency_known)
+      return RADIO_WAKEUP_SAFETY_DELAY_US;
+   const uint32_t margin_us = radio_wakeup_latency_us + RADIO_WAKEUP_GUARD_US;
+   return (margin_us < RADIO_WAKEUP_SAFETY_DELAY_US) ? margin_us : RADIO_WAKEUP_SAFETY_DELAY_US;
+}
+
+static void record_wakeup_latency(void)
+{
+   // Track how long the radio takes to become usable after the wakeup timer fires, reacting immediately to any increase,
+   //   and only allow intra-round sleep which outlasts the resulting wakeup margin
+   const uint32_t latency_us = (radio_wakeup_timer_ticks > wakeup_timer_config.ui32Compare0) ? wakeup_timer_ticks_to_us(radio_wakeup_timer_ticks - wakeup_timer_config.ui32Compare0) : 0;
+   radio_wakeup_latency_us = (latency_us > radio_wakeup_latency_us) ? latency_us : (radio_wakeup_latency_us - ((radio_wakeup_latency_us - latency_us) / 8));
+   radio_wakeup_latency_known = true;
+   ranging_phase_set_min_sleep_duration_us(get_radio_wakeup_margin_us() + RADIO_MIN_SLEEP_TIME_US);
+}
+
+static uint64_t predict_next_round_start_ticks(void)
+{
+   // Predict when the round following the latest synchronized one starts, correcting its length for the timer drift
+   const int64_t interval_ticks = (int64_t)us_to_wakeup_timer_ticks(synchronized_interval_us);
+   return round_start_timer_ticks + (uint64_t)(interval_ticks + ((interval_ticks * timer_drift) / (1000000LL * CLOCK_OFFSET_UNITS_PER_PPM)));
+}
+
+static void synchronize_with_master(uint32_t round_start_time)
+{
+   // Determine when the master started the current round on the wakeup timer from the DW3000 time elapsed since then
+   const uint32_t timer_ticks = am_hal_timer_read(RADIO_WAKEUP_TIMER_NUMBER), radio_time = dwt_readsystimestamphi32();
+   const uint64_t round_start_ticks = elapsed_timer_ticks + timer_ticks - us_to_wakeup_timer_ticks(DW_DELAY_TO_US(radio_time - round_start_time));
+
+   // Refine the drift of the wakeup timer against the master's rounds using the error in predicting this round from the
+   //   previous one, and start over without forgetting the drift if the previous round was missed
+   if (round_start_known)
+   {
+      const int64_t error_ticks = (int64_t)(round_start_ticks - predict_next_round_start_ticks());
+      const uint32_t error_us = (uint32_t)(((error_ticks < 0) ? -error_ticks : error_ticks) * 1000000 / RADIO_WAKEUP_TIMER_TICK_RATE_HZ);
+      if (error_us < RADIO_WAKEUP_SAFETY_DELAY_US)
+      {
+         timer_drift += (int32_t)((error_ticks * 1000000LL * CLOCK_OFFSET_UNITS_PER_PPM) / (4 * (int64_t)us_to_wakeup_timer_ticks(synchronized_interval_us)));
+         synchronization_error_us = (error_us > synchronization_error_us) ? error_us : (((3 * synchronization_error_us) + error_us) / 4);
+         num_synchronized_rounds += (num_synchronized_rounds < SYNCHRONIZATION_MIN_ROUNDS);
+      }
+      else
+         num_synchronized_rounds = 0;
+   }
+   round_start_timer_ticks = round_start_ticks;
+   synchronized_interval_us = schedule_phase_get_scheduling_interval_us();
+   round_start_known = true;
+}
+
+static uint32_t get_time_until_next_round_us(void)
+{
+   // Estimate the start of the next round from the nominal length of the current one until synchronized with the master
+   if (!round_start_known)
+   {
+      const uint32_t scheduling_interval_us = schedule_phase_get_scheduling_interval_us();
+      const uint32_t round_time_us = RADIO_WAKEUP_SAFETY_DELAY_US + SCHEDULE_BROADCAST_PERIOD_US + schedule_phase_get_ranging_duration_us() + RANGE_STATUS_DURATION_US(schedule_phase_get_num_devices());
+      if (round_time_us >= scheduling_interval_us)
+         print("ERROR: Round duration of %u us leaves no time before the next round in %u us\n", round_time_us, scheduling_interval_us);
+      telemetry_record_wakeup_margin(RADIO_WAKEUP_SAFETY_DELAY_US);
+      return (round_time_us < scheduling_interval_us) ? (scheduling_interval_us - round_time_us) : 1;
+   }
+
+   // Keep the full safety margin until the drift estimate has settled, and afterward only wake early enough to cover the
+   //   radio wakeup latency, the usual receiver early start, and twice the recent synchronization error, except for
+   //   periodically listening as long as when searching so that schedules of nearby co-channel networks are overheard,
+   //   and continuing to do so every round while such a network is still being heard so that it can merge quickly
+   uint32_t wakeup_margin_us = RADIO_WAKEUP_SAFETY_DELAY_US;
+   if (schedule_phase_foreign_network_heard() || (++rounds_since_merge_scan >= NETWORK_MERGE_SCAN_INTERVAL_ROUNDS))
+   {
+      wakeup_margin_us = NETWORK_SEARCH_WINDOW_US;
+      rounds_since_merge_scan = 0;
+   }
+   else if (num_synchronized_rounds >= SYNCHRONIZATION_MIN_ROUNDS)
+   {
+      const uint32_t synchronized_margin_us = radio_wakeup_latency_us + RECEIVE_EARLY_START_US + (2 * synchronization_error_us);
+      wakeup_margin_us = (synchronized_margin_us < wakeup_margin_us) ? synchronized_margin_us : wakeup_margin_us;
+   }
+   telemetry_record_wakeup_margin(wakeup_margin_us);
+
+   // Wake up immediately if the predicted start of the next round leaves no time to sleep
+   const uint64_t wakeup_ticks = predict_next_round_start_ticks() - us_to_wakeup_timer_ticks(wakeup_margin_us), current_ticks = read_elapsed_timer_ticks();
+   if (wakeup_ticks <= current_ticks)
+   {
+      print("ERROR: Round ended after the predicted start of the next round\n");
+      return 1;
+   }
+   return (uint32_t)(((wakeup_ticks - current_ticks) * 1000000) / RADIO_WAKEUP_TIMER_TICK_RATE_HZ);
+}
+
 static bool fix_network_errors(uint8_t num_ranging_results)
 {
-   // Have the Scheduler Phase handle any new device timeouts
+   // Have the Scheduler Phase handle any new device timeouts and motion status changes
    uint8_t num_devices = 0;
-   const uint8_t *device_list = status_phase_get_detected_devices(&num_devices);
+   const uint8_t *motion_statuses = NULL;
+   const uint16_t *device_list = status_phase_get_detected_devices(&num_devices, &motion_statuses);
+   schedule_phase_update_device_presence(device_id, motion_status);
    for (uint8_t i = 0; i < num_devices; ++i)
-      schedule_phase_update_device_presence(device_list[i]);
+      schedule_phase_update_device_presence(device_list[i], motion_statuses[i]);
    schedule_phase_handle_device_timeouts();
 
    // Check if we are still synchronized with the network
@@ -48,30 +233,195 @@ static bool fix_network_errors(uint8_t num_ranging_results)
    return true;
 }
 
+static void schedule_next_master_round(uint32_t scheduling_interval_us)
+{
+   // Count whole-second RTC alarms when the next round starts on a second boundary, and tenth-second alarms otherwise
+   const uint8_t repeat_interval = (round_start_tenths || (scheduling_interval_us % 1000000)) ? AM_HAL_RTC_ALM_RPT_10TH : AM_HAL_RTC_ALM_RPT_SEC;
+   rtc_ticks_per_round = scheduling_interval_us / ((repeat_interval == AM_HAL_RTC_ALM_RPT_SEC) ? 1000000 : SCHEDULING_INTERVAL_RESOLUTION_US);
+   round_start_tenths = (uint8_t)((round_start_tenths + (scheduling_interval_us / SCHEDULING_INTERVAL_RESOLUTION_US)) % 10);
+   if (repeat_interval != scheduler_alarm_repeat_interval)
+   {
+      am_hal_rtc_time_t scheduler_interval = {
+         .ui32ReadError = 0, .ui32CenturyEnable = 0, .ui32Weekday = 0, .ui32Century = 0, .ui32Year = 0,
+         .ui32Month = 0, .ui32DayOfMonth = 0, .ui32Hour = 0, .ui32Minute = 0, .ui32Second = 0, .ui32Hundredths = 0 };
+      am_hal_rtc_alarm_set(&scheduler_interval, (am_hal_rtc_alarm_repeat_e)(scheduler_alarm_repeat_interval = repeat_interval));
+   }
+}
+
+static void handle_radio_sleep_phase(void)
+{
+   // Set a timer to wake the radio shortly before its next scheduled activity and put it into deep-sleep mode
+   const uint32_t wakeup_margin_us = get_radio_wakeup_margin_us();
+   record_radio_activity();
+   telemetry_record_wakeup_margin(wakeup_margin_us);
+   arm_wakeup_timer(ranging_phase_get_sleep_duration_us() - wakeup_margin_us, RANGING_RADIO_WAKEUP);
+   ranging_radio_sleep(true);
+}
+
+static void join_foreign_network(void)
+{
+   // Stop scheduling rounds and rejoin the winning network as a participant without leaving UWB
+   const am_hal_rtc_time_t scheduler_interval = {
+      .ui32ReadError = 0, .ui32CenturyEnable = 0, .ui32Weekday = 0, .ui32Century = 0, .ui32Year = 0,
+      .ui32Month = 0, .ui32DayOfMonth = 0, .ui32Hour = 0, .ui32Minute = 0, .ui32Second = 0, .ui32Hundredths = 0 };
+   am_hal_rtc_alarm_set((am_hal_rtc_time_t*)&scheduler_interval, AM_HAL_RTC_ALM_RPT_DIS);
+   am_hal_rtc_interrupt_disable(AM_HAL_RTC_INT_ALM);
+   scheduler_role = ROLE_PARTICIPANT;
+   bluetooth_set_current_ranging_role(ROLE_PARTICIPANT);
+
+   // Start listening for the schedule of the winning network, which uses the same channel but a different PAN
+   ranging_radio_choose_pan_id(BROADCAST_PANID);
+   schedule_phase_initialize(eui, false, false, schedule_phase_get_timestamp());
+   schedule_reception_timeout = empty_round_timeout = num_synchronized_rounds = 0;
+   round_start_known = false;
+   timer_drift = 0;
+   radio_wakeup();
+   ranging_phase = schedule_phase_begin() ? SCHEDULE_PHASE : RANGING_ERROR;
+}
+
 static void handle_range_computation_phase(bool is_master)
 {
    // Put the radio into deep-sleep mode and set a timer to wake it before the next round
+   record_radio_activity();
    ranging_radio_sleep(true);
    if (!is_master)
-   {
-      const uint32_t remaing_time_us = 1000000 - RADIO_WAKEUP_SAFETY_DELAY_US - SCHEDULE_BROADCAST_PERIOD_US - (ranging_phase_get_time_slices() * RANGING_ITERATION_INTERVAL_US) - (schedule_phase_get_num_devices() * RANGE_STATUS_BROADCAST_PERIOD_US);
-      wakeup_timer_config.ui32Compare0 = (uint32_t)((float)RADIO_WAKEUP_TIMER_TICK_RATE_HZ / (1000000.0f / remaing_time_us));
-      am_hal_timer_config(RADIO_WAKEUP_TIMER_NUMBER, &wakeup_timer_config);
-      am_hal_timer_clear(RADIO_WAKEUP_TIMER_NUMBER);
-   }
+      arm_wakeup_timer(get_time_until_next_round_us(), RANGING_NEW_ROUND_START);
 
-   // Carry out the ranging algorithm and fix any detected network errors
-   compute_ranges(ranging_results);
-   if (!is_master || fix_network_errors(ranging_results[0]))
+   // Carry out the ranging algorithm and fix any detected network errors, only storing and transmitting ranges which
+   //   have changed noticeably when reporting changes only
+   const uint8_t num_ranged_devices = compute_ranges(ranging_results, schedule_phase_get_scheduling_interval_us());
+   const ranging_telemetry_t *telemetry = telemetry_finish_round();
+   if ((!is_master || fix_network_errors(num_ranged_devices)) && (!RANGE_OUTPUT_CHANGES_ONLY || ranging_results[0]))
    {
       bluetooth_write_range_results(ranging_results, 1 + ((uint16_t)ranging_results[0] * COMPRESSED_RANGE_DATUM_LENGTH));
 #ifndef _TEST_RANGING_TASK
-      storage_write_ranging_data(schedule_phase_get_timestamp(), ranging_results, 1 + ((uint32_t)ranging_results[0] * COMPRESSED_RANGE_DATUM_LENGTH));
+      storage_write_ranging_data(schedule_phase_get_timestamp(), schedule_phase_get_timestamp_ms(), ranging_results, 1 + ((uint32_t)ranging_results[0] * COMPRESSED_RANGE_DATUM_LENGTH));
 #else
-      print_ranges(schedule_phase_get_timestamp(), ranging_results, 1 + ((uint32_t)ranging_results[0] * COMPRESSED_RANGE_DATUM_LENGTH));
+      print_ranges(schedule_phase_get_timestamp(), schedule_phase_get_timestamp_ms(), ranging_results, 1 + ((uint32_t)ranging_results[0] * COMPRESSED_RANGE_DATUM_LENGTH));
 #endif
    }
+
+   // Transmit the protocol telemetry after every round and periodically store a summary of it
+   bluetooth_write_telemetry((const uint8_t*)telemetry, sizeof(*telemetry));
+#ifndef _TEST_RANGING_TASK
+   if ((telemetry->num_rounds % TELEMETRY_STORAGE_INTERVAL_ROUNDS) == 0)
+      storage_write_telemetry(schedule_phase_get_timestamp(), (const uint8_t*)telemetry, sizeof(*telemetry));
+#endif
    ranging_phase = UNSCHEDULED_TIME_PHASE;
+
+   // Merge with any foreign network detected during this round
+   if (is_master && schedule_phase_handle_network_merge())
+      join_foreign_network();
+}
+
+static void handle_ranging_phase(void)
+{
+   // Carry out logic based on the current reported phase of the ranging protocol
+   switch (ranging_phase)
+   {
+      case RANGING_PHASE:
+         schedule_reception_timeout = 0;
+         if (!network_channel)
+         {
+            // Advertise the channel on which a network was found after searching all channels
+            network_channel = ranging_radio_get_channel();
+            bluetooth_set_current_ranging_channel(network_channel);
+         }
+         break;
+      case RADIO_SLEEP_PHASE:
+         handle_radio_sleep_phase();
+         break;
+      case RANGE_COMPUTATION_PHASE:
+         handle_range_computation_phase(scheduler_role == ROLE_MASTER);
+         break;
+      case RANGING_ERROR:
+         if (scheduler_role == ROLE_MASTER)
+            ranging_phase = UNSCHEDULED_TIME_PHASE;
+         else if (++schedule_reception_timeout >= (NETWORK_SEARCH_TIME_SECONDS + (SCHEDULING_INTERVAL_STILL_US / 1000000)))
+         {
+            // Stop the ranging task if no network was detected after a period of time
+            print("WARNING: Timed out searching for an existing network\n");
+#ifndef _TEST_RANGING_TASK
+            is_running = false;
+#else
+            schedule_phase_begin();
+            schedule_reception_timeout = 0;
+#endif
+         }
+         else
+         {
+            // Sleep until shortly before the next round of a network heard while searching instead of listening throughout
+            const uint32_t search_sleep_us = schedule_phase_get_search_sleep_us();
+            if (search_sleep_us)
+            {
+               record_radio_activity();
+               ranging_radio_sleep(true);
+               arm_wakeup_timer(search_sleep_us, RANGING_NEW_ROUND_START);
+               ranging_phase = UNSCHEDULED_TIME_PHASE;
+            }
+            else
+               schedule_phase_begin();
+         }
+         break;
+      case MESSAGE_COLLISION:
+         telemetry_record_collision();
+         print("WARNING: Ending the current round due to possible network collision\n");
+         handle_range_computation_phase(scheduler_role == ROLE_MASTER);
+         break;
+      default:
+         break;
+   }
+}
+
+static void handle_radio_events(void)
+{
+   // Dispatch each queued radio event to the current phase of the ranging protocol
+   while (is_running && (event_queue_tail != event_queue_head))
+   {
+      __DMB();
+      ranging_event_t *event = &event_queue[event_queue_tail & (RANGING_EVENT_QUEUE_LENGTH - 1)];
+
+      // Measure how long the event waited since its interrupt, unless the wakeup timer was restarted in between
+      const uint32_t timer_ticks = am_hal_timer_read(RADIO_WAKEUP_TIMER_NUMBER);
+      if ((event->timer_rearm_count == wakeup_timer_rearm_count) && (timer_ticks >= event->timer_ticks))
+         telemetry_record_event_latency(wakeup_timer_ticks_to_us(timer_ticks - event->timer_ticks));
+      switch (event->type)
+      {
+         case RANGING_TX_COMPLETE:
+            ranging_phase = schedule_phase_tx_complete(event->timestamp);
+            break;
+         case RANGING_RX_COMPLETE:
+         {
+            // Synchronize to the master whenever a schedule is received, while the radio is guaranteed to be awake
+            uint32_t round_start_time;
+            ranging_phase = schedule_phase_rx_complete(&event->packet.schedule, event->timestamp, event->signal_level, event->nlos_indicator_db, event->clock_offset);
+            if (schedule_phase_get_round_start_time(&round_start_time))
+               synchronize_with_master(round_start_time);
+            break;
+         }
+         case RANGING_RX_TIMEOUT:
+         {
+            // Count a missed schedule whenever a synchronized participant stops listening for one without success
+            const scheduler_phase_t timed_out_phase = ranging_phase;
+            telemetry_record_rx_timeout(((timed_out_phase == SCHEDULE_PHASE) || (timed_out_phase == NETWORK_MERGE_PHASE)) ? TELEMETRY_SCHEDULE_PHASE :
+                  ((timed_out_phase == RANGE_STATUS_PHASE) ? TELEMETRY_STATUS_PHASE : TELEMETRY_RANGING_PHASE));
+            ranging_phase = schedule_phase_rx_error(true);
+            if ((scheduler_role == ROLE_PARTICIPANT) && round_start_known && (timed_out_phase == SCHEDULE_PHASE) && (ranging_phase == RANGING_ERROR))
+               telemetry_record_schedule_miss();
+            break;
+         }
+         default:
+            // Corrupted packets are mostly caused by colliding transmissions
+            telemetry_record_collision();
+            ranging_phase = schedule_phase_rx_error(false);
+            break;
+      }
+
+      // Release the queue entry back to the radio interrupt handler before acting on the resulting phase
+      __DMB();
+      event_queue_tail = event_queue_tail + 1;
+      handle_ranging_phase();
+   }
 }
 
 
@@ -82,48 +432,113 @@ void am_timer02_isr(void)
    // Notify the main task to handle the interrupt
    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
    am_hal_timer_interrupt_clear(AM_HAL_TIMER_MASK(RADIO_WAKEUP_TIMER_NUMBER, AM_HAL_TIMER_COMPARE_BOTH));
-   xTaskNotifyFromISR(notification_handle, RANGING_NEW_ROUND_START, eSetBits, &xHigherPriorityTaskWoken);
+   xTaskNotifyFromISR(notification_handle, wakeup_timer_reason, eSetBits, &xHigherPriorityTaskWoken);
    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
 }
 
 void scheduler_rtc_isr(void)
 {
+   // Wait until enough RTC alarms have elapsed to start the next round
+   if (++rtc_tick_count < rtc_ticks_per_round)
+      return;
+   rtc_tick_count = 0;
+
    // Notify the main task to handle the interrupt
    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
    xTaskNotifyFromISR(notification_handle, RANGING_NEW_ROUND_START, eSetBits, &xHigherPriorityTaskWoken);
    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
 }
 
-static void tx_callback(const dwt_cb_data_t *txData)
+static void notify_radio_event(ranging_interrupt_reason_t type)
 {
    // Notify the main task to handle the interrupt
    BaseType_t xHigherPriorityTaskWoken = pdFALSE;
-   xTaskNotifyFromISR(notification_handle, RANGING_TX_COMPLETE, eSetBits, &xHigherPriorityTaskWoken);
+   xTaskNotifyFromISR(notification_handle, type, eSetBits, &xHigherPriorityTaskWoken);
    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
 }
 
-static void rx_callback(const dwt_cb_data_t *rxData)
+static void publish_radio_events(void)
 {
-   // Read packet data and ensure that no errors were encountered
-   if (rxData->datalength > sizeof(read_buffer))
+   // Publish every consecutive completed queue entry to the ranging task in order of arrival
+   uint8_t head = event_queue_head;
+   while ((head != event_queue_reserved) && event_queue[head & (RANGING_EVENT_QUEUE_LENGTH - 1)].is_complete)
+      ++head;
+   __DMB();
+   event_queue_head = head;
+}
+
+static void rx_data_read_complete(void *context, bool success)
+{
+   // Only schedule and ranging packets make use of the clock offset measured during reception
+   ranging_event_t *event = (ranging_event_t*)context;
+   if (!success)
+      event->packet.schedule.message_type = UNKNOWN_PACKET;
+   if ((event->packet.schedule.message_type != SCHEDULE_PACKET) && (event->packet.schedule.message_type != RANGING_PACKET))
+      event->clock_offset = 0;
+   event->is_complete = true;
+   publish_radio_events();
+   notify_radio_event(RANGING_RX_COMPLETE);
+}
+
+static void enqueue_radio_event(ranging_interrupt_reason_t type, const dwt_cb_data_t *cb_data)
+{
+   // Drop the event if the ranging task has not yet released any queue entries
+   const uint8_t slot = event_queue_reserved;
+   if ((uint8_t)(slot - event_queue_tail) >= RANGING_EVENT_QUEUE_LENGTH)
+      print("ERROR: Radio event queue is full, dropping event type %u\n", (uint32_t)type);
+   else
    {
-      read_buffer[sizeof(ieee154_header_t)] = UNKNOWN_PACKET;
-      print("ERROR: Received packet which exceeds maximal length (received %u bytes)!\n", rxData->datalength);
+      // Capture the interrupt time along with the timestamp and diagnostics before the radio can overwrite them
+      ranging_event_t *event = &event_queue[slot & (RANGING_EVENT_QUEUE_LENGTH - 1)];
+      event->type = type;
+      event->is_complete = false;
+      event->timer_ticks = am_hal_timer_read(RADIO_WAKEUP_TIMER_NUMBER);
+      event->timer_rearm_count = wakeup_timer_rearm_count;
+      event_queue_reserved = slot + 1;
+      if (type == RANGING_TX_COMPLETE)
+         event->timestamp = ranging_radio_readtxtimestamp();
+      else if (type == RANGING_RX_COMPLETE)
+      {
+         event->timestamp = ranging_radio_readrxdiagnostics(&event->signal_level, &event->nlos_indicator_db);
+         event->clock_offset = dwt_readclockoffset();
+         if (cb_data->datalength > sizeof(event->packet))
+         {
+            event->packet.schedule.message_type = UNKNOWN_PACKET;
+            print("ERROR: Received packet which exceeds maximal length (received %u bytes)!\n", cb_data->datalength);
+         }
+         else
+         {
+            // Stream long packets out of the radio in the background and publish the event once they arrive
+            ranging_radio_readrxdata_async((uint8_t*)&event->packet, cb_data->datalength, rx_data_read_complete, event);
+            return;
+         }
+      }
+
+      // Publish the completed queue entry to the ranging task
+      event->is_complete = true;
+      publish_radio_events();
    }
+   notify_radio_event(type);
+}
 
-   // Notify the main task to handle the interrupt
-   BaseType_t xHigherPriorityTaskWoken = pdFALSE;
-   dwt_readrxdata(read_buffer, rxData->datalength, 0);
-   xTaskNotifyFromISR(notification_handle, RANGING_RX_COMPLETE, eSetBits, &xHigherPriorityTaskWoken);
-   portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+static void tx_callback(const dwt_cb_data_t *txData)
+{
+   enqueue_radio_event(RANGING_TX_COMPLETE, txData);
+}
+
+static void rx_callback(const dwt_cb_data_t *rxData)
+{
+   enqueue_radio_event(RANGING_RX_COMPLETE, rxData);
 }
 
 static void rx_timeout_callback(const dwt_cb_data_t *rxData)
 {
-   // Notify the main task to handle the interrupt
-   BaseType_t xHigherPriorityTaskWoken = pdFALSE;
-   xTaskNotifyFromISR(notification_handle, RANGING_RX_TIMEOUT, eSetBits, &xHigherPriorityTaskWoken);
-   portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
+   enqueue_radio_event(RANGING_RX_TIMEOUT, rxData);
+}
+
+static void rx_error_callback(const dwt_cb_data_t *rxData)
+{
+   enqueue_radio_event(RANGING_RX_ERROR, rxData);
 }
 
 
@@ -135,10 +550,10 @@ void scheduler_init(uint8_t *uid)
    if (uid)
    {
       memcpy(eui, uid, EUI_LEN);
-      device_eui = eui[0];
+      device_id = DEVICE_ID(eui);
 
       // Set the DW3000 callback configuration
-      ranging_radio_register_callbacks(tx_callback, rx_callback, rx_timeout_callback, rx_timeout_callback);
+      ranging_radio_register_callbacks(tx_callback, rx_callback, rx_timeout_callback, rx_error_callback);
    }
    is_running = is_starting = false;
 }
@@ -148,32 +563,64 @@ void scheduler_prepare(void)
    is_starting = true;
 }
 
-void scheduler_run(schedule_role_t role, uint32_t timestamp)
+void scheduler_run(schedule_role_t role, uint8_t channel, uint32_t timestamp)
 {
-   // Wake up the DW3000 ranging radio and set it to the correct channel
-   ranging_radio_wakeup();
-   ranging_radio_choose_channel(RADIO_XMIT_CHANNEL);
+   // Keep track of the scheduling role, which may change if this network merges into another
+   scheduler_role = role;
+
+   // Start the radio wakeup timer as a free-running counter so that it can be used to measure time spent asleep
+   am_hal_timer_default_config_set(&wakeup_timer_config);
+   wakeup_timer_config.eFunction = AM_HAL_TIMER_FN_UPCOUNT;
+   am_hal_timer_config(RADIO_WAKEUP_TIMER_NUMBER, &wakeup_timer_config);
+   am_hal_timer_clear(RADIO_WAKEUP_TIMER_NUMBER);
+
+   // Discard any stale radio events, then wake up the DW3000 ranging radio and tune it to the network channel, with
+   //   masters using a PAN derived from their EUI and participants accepting only broadcast packets until scheduled
+   event_queue_tail = event_queue_head = event_queue_reserved;
+   wakeup_timer_reason = 0;
+   radio_wakeup_latency_us = synchronization_error_us = 0;
+   calibration_timer_ticks = calibration_radio_time = elapsed_timer_ticks = 0;
+   round_start_known = radio_wakeup_latency_known = false;
+   num_synchronized_rounds = rounds_since_merge_scan = 0;
+   timer_drift = 0;
+   network_channel = ((role == ROLE_MASTER) && !channel) ? RADIO_XMIT_CHANNEL : channel;
+   radio_wakeup();
+   ranging_radio_choose_channel(network_channel ? network_channel : RADIO_XMIT_CHANNEL);
+   ranging_radio_choose_pan_id((role == ROLE_MASTER) ? NETWORK_PANID(device_id) : BROADCAST_PANID);
+   bluetooth_set_current_ranging_channel(network_channel);
 
    // Initialize all static ranging variables
    notification_handle = xTaskGetCurrentTaskHandle();
    memset(ranging_results, 0, sizeof(ranging_results));
    schedule_reception_timeout = empty_round_timeout = 0;
+   telemetry_reset();
    ranging_phase = UNSCHEDULED_TIME_PHASE;
 
-   // Initialize the Schedule, Ranging, and Status phases
-   schedule_phase_initialize(eui, role == ROLE_MASTER, timestamp - 1);
+   // Initialize the Schedule, Ranging, Broadcast Ranging, and Status phases along with the per-peer range filters
+   schedule_phase_initialize(eui, scheduler_role == ROLE_MASTER, !network_channel, timestamp - 1);
    ranging_phase_initialize(eui);
+   broadcast_phase_initialize(eui);
    status_phase_initialize(eui);
+   status_phase_set_motion_status(motion_status);
+   reset_range_filters();
 
-   // Initialize the scheduler or wakeup timers based on the device role
+   // Enable the radio wakeup timer interrupt
    is_running = true;
    is_starting = false;
-   if (role == ROLE_MASTER)
+   am_hal_timer_interrupt_enable(AM_HAL_TIMER_MASK(RADIO_WAKEUP_TIMER_NUMBER, AM_HAL_TIMER_COMPARE0));
+   NVIC_SetPriority(TIMER0_IRQn + RADIO_WAKEUP_TIMER_NUMBER, NVIC_configMAX_SYSCALL_INTERRUPT_PRIORITY + 1);
+   NVIC_EnableIRQ(TIMER0_IRQn + RADIO_WAKEUP_TIMER_NUMBER);
+
+   // Initialize the scheduler timer or start searching for a network based on the device role
+   if (scheduler_role == ROLE_MASTER)
    {
-      // Initialize the scheduler timer
+      // Initialize the scheduler timer to start the first round on the next second boundary
       am_hal_rtc_time_t scheduler_interval = {
          .ui32ReadError = 0, .ui32CenturyEnable = 0, .ui32Weekday = 0, .ui32Century = 0, .ui32Year = 0,
          .ui32Month = 0, .ui32DayOfMonth = 0, .ui32Hour = 0, .ui32Minute = 0, .ui32Second = 1, .ui32Hundredths = 0 };
+      rtc_ticks_per_round = 1;
+      rtc_tick_count = round_start_tenths = 0;
+      scheduler_alarm_repeat_interval = AM_HAL_RTC_ALM_RPT_SEC;
       am_hal_rtc_alarm_set(&scheduler_interval, AM_HAL_RTC_ALM_RPT_SEC);
       am_hal_rtc_interrupt_enable(AM_HAL_RTC_INT_ALM);
       NVIC_SetPriority(RTC_IRQn, NVIC_configMAX_SYSCALL_INTERRUPT_PRIORITY + 1);
@@ -181,11 +628,6 @@ void scheduler_run(schedule_role_t role, uint32_t timestamp)
    }
    else
    {
-      // Initialize the radio wakeup timer
-      am_hal_timer_default_config_set(&wakeup_timer_config);
-      am_hal_timer_interrupt_enable(AM_HAL_TIMER_MASK(RADIO_WAKEUP_TIMER_NUMBER, AM_HAL_TIMER_COMPARE0));
-      NVIC_SetPriority(TIMER0_IRQn + RADIO_WAKEUP_TIMER_NUMBER, NVIC_configMAX_SYSCALL_INTERRUPT_PRIORITY + 1);
-      NVIC_EnableIRQ(TIMER0_IRQn + RADIO_WAKEUP_TIMER_NUMBER);
       print("INFO: Searching for an existing network\n");
       schedule_phase_begin();
    }
@@ -199,56 +641,27 @@ void scheduler_run(schedule_role_t role, uint32_t timestamp)
          if ((pending_actions & RANGING_NEW_ROUND_START) != 0)
          {
             // Wake up the radio and wait until all schedule updating tasks have completed
-            ranging_radio_wakeup();
+            radio_wakeup();
+            if (scheduler_role == ROLE_PARTICIPANT)
+               record_wakeup_latency();
             while (ranging_phase == UPDATING_SCHEDULE_PHASE)
                vTaskDelay(1);
             ranging_phase = schedule_phase_begin() ? SCHEDULE_PHASE : RANGING_ERROR;
+            if (scheduler_role == ROLE_MASTER)
+               schedule_next_master_round(schedule_phase_get_scheduling_interval_us());
+            handle_ranging_phase();
          }
-         if ((pending_actions & RANGING_TX_COMPLETE) != 0)
-            ranging_phase = schedule_phase_tx_complete();
-         if ((pending_actions & RANGING_RX_COMPLETE) != 0)
-            ranging_phase = schedule_phase_rx_complete((schedule_packet_t*)read_buffer);
-         if ((pending_actions & RANGING_RX_TIMEOUT) != 0)
-            ranging_phase = schedule_phase_rx_error();
-
-         // Carry out logic based on the current reported phase of the ranging protocol
-         switch (ranging_phase)
+         if (((pending_actions & RANGING_RADIO_WAKEUP) != 0) && (ranging_phase == RADIO_SLEEP_PHASE))
          {
-            case RANGING_PHASE:
-               schedule_reception_timeout = 0;
-               break;
-            case RANGE_COMPUTATION_PHASE:
-               handle_range_computation_phase(role == ROLE_MASTER);
-               break;
-            case RANGING_ERROR:
-               if (role == ROLE_MASTER)
-                  ranging_phase = UNSCHEDULED_TIME_PHASE;
-               else if (++schedule_reception_timeout >= NETWORK_SEARCH_TIME_SECONDS)
-               {
-                     // Stop the ranging task if no network was detected after a period of time
-                     print("WARNING: Timed out searching for an existing network\n");
-#ifndef _TEST_RANGING_TASK
-                     is_running = false;
-#else
-                     schedule_phase_begin();
-                     schedule_reception_timeout = 0;
-#endif
-               }
-               else
-                  schedule_phase_begin();
-               break;
-            case MESSAGE_COLLISION:
-               print("WARNING: Stopping ranging due to possible network collision\n");
-#ifndef _TEST_RANGING_TASK
-               is_running = false;
-#else
-               schedule_phase_begin();
-               schedule_reception_timeout = 0;
-#endif
-               break;
-            default:
-               break;
+            // Wake up the radio, measure how long that took, and resume the Ranging Phase based on the time spent asleep
+            radio_wakeup();
+            record_wakeup_latency();
+            ranging_phase = ranging_phase_resume(wakeup_timer_ticks_to_us(radio_wakeup_timer_ticks));
+            handle_ranging_phase();
          }
+
+         // Handle all radio events in the order in which they occurred
+         handle_radio_events();
       }
 
    // Disable all ranging timers and interrupts
@@ -265,7 +678,7 @@ void scheduler_run(schedule_role_t role, uint32_t timestamp)
    ranging_radio_sleep(true);
 }
 
-void scheduler_add_device(uint8_t eui)
+void scheduler_add_device(uint16_t new_device_id)
 {
    // Only schedule a device if currently running or about to start
    if (!is_running)
@@ -280,10 +693,17 @@ void scheduler_add_device(uint8_t eui)
    while (ranging_phase != UNSCHEDULED_TIME_PHASE)
       vTaskDelay(pdMS_TO_TICKS(2));
    ranging_phase = UPDATING_SCHEDULE_PHASE;
-   schedule_phase_add_device(eui);
+   schedule_phase_add_device(new_device_id);
    ranging_phase = UNSCHEDULED_TIME_PHASE;
 }
 
+void scheduler_set_motion_status(bool in_motion)
+{
+   // Report the new motion status to the network in all subsequent Status Phases
+   motion_status = in_motion ? MOTION_STATUS_MOVING : MOTION_STATUS_STILL;
+   status_phase_set_motion_status(motion_status);
+}
+
 void scheduler_stop(void)
 {
    // Notify the scheduling task that it is time to stop
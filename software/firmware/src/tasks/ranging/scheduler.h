@@ -14,7 +14,9 @@ typedef enum {
    RANGING_NEW_ROUND_START = 0b00000010,
    RANGING_TX_COMPLETE = 0b00000100,
    RANGING_RX_COMPLETE = 0b00001000,
-   RANGING_RX_TIMEOUT = 0b00010000
+   RANGING_RX_TIMEOUT = 0b00010000,
+   RANGING_RADIO_WAKEUP = 0b00100000,
+   RANGING_RX_ERROR = 0b01000000
 } ranging_interrupt_reason_t;
 
 typedef enum
@@ -23,6 +25,8 @@ typedef enum
    RANGING_PHASE,
    RANGE_STATUS_PHASE,
    RANGE_COMPUTATION_PHASE,
+   RADIO_SLEEP_PHASE,
+   NETWORK_MERGE_PHASE,
    UNSCHEDULED_TIME_PHASE,
    UPDATING_SCHEDULE_PHASE,
    RANGING_ERROR,
@@ -32,19 +36,36 @@ typedef enum
 typedef enum
 {
    RANGING_PACKET = 0x80,
+   RANGING_BROADCAST_PACKET = 0x81,
    SCHEDULE_PACKET = 0x83,
    STATUS_SUCCESS_PACKET = 0x85,
-   UNKNOWN_PACKET = 0x86
+   UNKNOWN_PACKET = 0x86,
+   NETWORK_MERGE_PACKET = 0x87
 } packet_t;
 
+typedef enum
+{
+   RANGING_MODE_PAIRWISE = 0,
+   RANGING_MODE_BROADCAST = 1,
+   RANGING_MODE_SINGLE_SIDED = 2
+} ranging_mode_t;
+
+typedef enum
+{
+   MOTION_STATUS_UNKNOWN = 0,
+   MOTION_STATUS_STILL = 1,
+   MOTION_STATUS_MOVING = 2
+} motion_status_t;
+
 
 // Public API ----------------------------------------------------------------------------------------------------------
 
 void scheduler_init(uint8_t *uid);
 void scheduler_prepare(void);
-void scheduler_run(schedule_role_t role, uint32_t timestamp);
-void scheduler_add_device(uint8_t eui);
+void scheduler_run(schedule_role_t role, uint8_t channel, uint32_t timestamp);
+void scheduler_add_device(uint16_t device_id);
 void scheduler_stop(void);
+void scheduler_set_motion_status(bool in_motion);
 void scheduler_rtc_isr(void);
 
 #endif  // #ifndef __SCHEDULER_HEADER_H__
@@ -4,15 +4,67 @@
 #include "logging.h"
 #include "ranging_phase.h"
 #include "status_phase.h"
+#include "telemetry.h"
+#include "timing.h"
 
 
 // Static Global Variables ---------------------------------------------------------------------------------------------
 
 static status_success_packet_t success_packet;
 static uint8_t current_slot, scheduled_slot, total_num_slots;
-static uint32_t transmitted_seq_num, last_rx_delay_time_us;
-static uint8_t present_devices[MAX_NUM_RANGING_DEVICES], num_present_devices;
-static bool last_rx_relative_to_transmit;
+static uint8_t present_motion_statuses[MAX_NUM_RANGING_DEVICES], num_present_devices;
+static uint8_t device_statuses[RANGE_STATUS_BITMAP_LENGTH];
+static uint16_t present_devices[MAX_NUM_RANGING_DEVICES];
+static const uint16_t *scheduled_devices;
+static uint64_t phase_start_timestamp;
+static int16_t master_clock_offset;
+
+
+// Private Helper Functions --------------------------------------------------------------------------------------------
+
+static uint32_t slot_time_to_delayed_time(uint8_t slot)
+{
+   // Convert the start time of a status slot on the master's clock into an absolute DW3000 delayed TX/RX time
+   return (uint32_t)((phase_start_timestamp + SYNCHRONIZED_US_TO_DW_TICKS((uint32_t)(slot - 1) * RANGE_STATUS_BROADCAST_PERIOD_US, master_clock_offset)) >> 8);
+}
+
+#if RANGE_STATUS_PIGGYBACK
+
+static uint8_t get_device_status(const uint8_t *statuses, uint8_t slot)
+{
+   // Device statuses are packed into two bits per schedule slot
+   return (statuses[slot / 4] >> (2 * (slot % 4))) & 0x03;
+}
+
+#endif
+
+static scheduler_phase_t begin_current_slot(void)
+{
+   // Transmit our own status or listen for the status of the device owning the current slot
+   if (current_slot == scheduled_slot)
+   {
+      dwt_writetxdata(sizeof(status_success_packet_t), (uint8_t*)&success_packet, 0);
+      dwt_setdelayedtrxtime(slot_time_to_delayed_time(current_slot));
+      if (dwt_starttx(DWT_START_TX_DELAYED) != DWT_SUCCESS)
+      {
+         telemetry_record_tx_failure();
+         print("ERROR: Failed to transmit STATUS packet\n");
+         return RANGE_COMPUTATION_PHASE;
+      }
+   }
+   else if (current_slot < total_num_slots)
+   {
+      dwt_setdelayedtrxtime(slot_time_to_delayed_time(current_slot) - US_TO_DW_DELAY(RECEIVE_EARLY_START_US));
+      if (!ranging_radio_rxenable(DWT_START_RX_DELAYED))
+      {
+         print("ERROR: Unable to start listening for STATUS packets\n");
+         return RANGE_COMPUTATION_PHASE;
+      }
+   }
+   else
+      return RANGE_COMPUTATION_PHASE;
+   return RANGE_STATUS_PHASE;
+}
 
 
 // Public API Functions ------------------------------------------------------------------------------------------------
@@ -22,84 +74,50 @@ void status_phase_initialize(const uint8_t *uid)
    // Initialize all Schedule Phase parameters
    success_packet = (status_success_packet_t){ .header = { .frameCtrl = { 0x41, 0x98 }, .seqNum = 0,
          .panID = { MODULE_PANID & 0xFF, MODULE_PANID >> 8 }, .destAddr = { 0xFF, 0xFF }, .sourceAddr = { 0 } },
-      .message_type = STATUS_SUCCESS_PACKET, .success = 0, .footer = { { 0 } } };
+      .message_type = STATUS_SUCCESS_PACKET, .success = 0, .motion_status = MOTION_STATUS_UNKNOWN, .footer = { { 0 } } };
    memcpy(success_packet.header.sourceAddr, uid, sizeof(success_packet.header.sourceAddr));
    scheduled_slot = 0xFF;
 }
 
-scheduler_phase_t status_phase_begin(uint8_t status_slot, uint8_t num_slots, uint32_t start_delay_us, bool start_relative_to_transmit)
+scheduler_phase_t status_phase_begin(uint8_t status_slot, uint8_t num_slots, uint64_t start_timestamp, int16_t clock_offset)
 {
    // Reset the necessary Schedule Phase parameters
    current_slot = 1;
    num_present_devices = 0;
    total_num_slots = num_slots;
    scheduled_slot = status_slot;
+   phase_start_timestamp = start_timestamp;
+   master_clock_offset = clock_offset;
    success_packet.header.seqNum = 0;
    success_packet.success = responses_received();
+   ranging_radio_set_packet_pan_id(&success_packet.header);
    memset(present_devices, 0, sizeof(present_devices));
-   dwt_writetxfctrl(sizeof(status_success_packet_t), 0, 0);
 
+#if RANGE_STATUS_PIGGYBACK
+   // Report every device whose status was piggybacked onto a ranging packet instead of running a separate Status Phase
+   for (uint8_t slot = 0; slot < num_slots; ++slot)
+      if ((slot != status_slot) && get_device_status(device_statuses, slot))
+      {
+         present_motion_statuses[num_present_devices] = get_device_status(device_statuses, slot) - 1;
+         present_devices[num_present_devices++] = scheduled_devices[slot];
+      }
+   return RANGE_COMPUTATION_PHASE;
+#else
    // Set up the correct initial antenna and RX timeout duration
+   dwt_writetxfctrl(sizeof(status_success_packet_t), 0, 0);
    ranging_radio_choose_antenna(RANGE_STATUS_XMIT_ANTENNA);
-   dwt_setrxtimeout(DW_TIMEOUT_FROM_US(RANGE_STATUS_TIMEOUT_US));
+   dwt_setrxtimeout(US_TO_DW_TIMEOUT(RANGE_STATUS_TIMEOUT_US));
 
    // Begin transmission or reception depending on the scheduled time slot
-   if (scheduled_slot == current_slot)
-   {
-      transmitted_seq_num = 0;
-      dwt_writetxdata(sizeof(status_success_packet_t), (uint8_t*)&success_packet, 0);
-      dwt_setdelayedtrxtime(DW_DELAY_FROM_US(start_delay_us));
-      if (dwt_starttx(start_relative_to_transmit ? DWT_START_TX_DLY_TS : DWT_START_TX_DLY_RS) != DWT_SUCCESS)
-      {
-         print("ERROR: Failed to transmit STATUS packet\n");
-         return RANGE_COMPUTATION_PHASE;
-      }
-   }
-   else
-   {
-      last_rx_relative_to_transmit = start_relative_to_transmit;
-      last_rx_delay_time_us = start_delay_us - RECEIVE_EARLY_START_US;
-      dwt_setdelayedtrxtime(DW_DELAY_FROM_US(last_rx_delay_time_us));
-      if (!ranging_radio_rxenable(start_relative_to_transmit ? DWT_START_RX_DLY_TS : DWT_START_RX_DLY_RS))
-      {
-         print("ERROR: Unable to start listening for STATUS packets\n");
-         return RANGE_COMPUTATION_PHASE;
-      }
-   }
-   return RANGE_STATUS_PHASE;
+   return begin_current_slot();
+#endif
 }
 
 scheduler_phase_t status_phase_tx_complete(void)
 {
-   if (++current_slot == scheduled_slot)
-   {
-      dwt_writetxdata(sizeof(status_success_packet_t), (uint8_t*)&success_packet, 0);
-      dwt_setdelayedtrxtime(DW_DELAY_FROM_US(RANGE_STATUS_BROADCAST_PERIOD_US - (transmitted_seq_num * RANGE_STATUS_RESEND_INTERVAL_US)));
-      transmitted_seq_num = 0;
-      if (dwt_starttx(DWT_START_TX_DLY_TS) != DWT_SUCCESS)
-      {
-         print("ERROR: Failed to transmit STATUS packet after prior transmission\n");
-         return RANGE_COMPUTATION_PHASE;
-      }
-      return RANGE_STATUS_PHASE;
-   }
-   else if (current_slot < total_num_slots)
-   {
-      // Move back into listening mode for additional status responses
-      last_rx_relative_to_transmit = true;
-      last_rx_delay_time_us = RANGE_STATUS_BROADCAST_PERIOD_US - (transmitted_seq_num * RANGE_STATUS_RESEND_INTERVAL_US) - RECEIVE_EARLY_START_US;
-      dwt_setdelayedtrxtime(DW_DELAY_FROM_US(last_rx_delay_time_us));
-      transmitted_seq_num = 0;
-      if (!ranging_radio_rxenable(DWT_START_RX_DLY_TS))
-      {
-         print("ERROR: Unable to re-enable listening for STATUS packets\n");
-         return RANGE_COMPUTATION_PHASE;
-      }
-      return RANGE_STATUS_PHASE;
-   }
-
-   // Move to the Range Computation Phase of the ranging protocol
-   return RANGE_COMPUTATION_PHASE;
+   // Move on to the next status slot, which is aligned to the start of the Status Phase
+   ++current_slot;
+   return begin_current_slot();
 }
 
 scheduler_phase_t status_phase_rx_complete(status_success_packet_t* packet)
@@ -111,88 +129,71 @@ scheduler_phase_t status_phase_rx_complete(status_success_packet_t* packet)
       return MESSAGE_COLLISION;
    }
 
-   // Record the presence of the transmitting device
+   // Record the presence and motion status of the transmitting device
    if (!scheduled_slot)
-      present_devices[num_present_devices++] = packet->header.sourceAddr[0];
+   {
+      present_motion_statuses[num_present_devices] = packet->motion_status;
+      present_devices[num_present_devices++] = DEVICE_ID(packet->header.sourceAddr);
+   }
 
-   // Retransmit the status packet upon reception
+   // Retransmit the status packet upon reception if this device is one of the designated relays
    const uint32_t seqNum = packet->header.seqNum;
-   if (scheduled_slot && (scheduled_slot <= RANGE_STATUS_NUM_TOTAL_BROADCASTS) && (packet->header.seqNum < scheduled_slot))
+   if (scheduled_slot && (scheduled_slot <= RANGE_STATUS_NUM_TOTAL_BROADCASTS) && (seqNum < (uint32_t)(scheduled_slot - 1)))
    {
       packet->header.seqNum = scheduled_slot - 1;
-      transmitted_seq_num = packet->header.seqNum;
       dwt_writetxdata(sizeof(status_success_packet_t), (uint8_t*)packet, 0);
-      dwt_setdelayedtrxtime(DW_DELAY_FROM_US((transmitted_seq_num - seqNum) * RANGE_STATUS_RESEND_INTERVAL_US));
+      dwt_setdelayedtrxtime(US_TO_DW_DELAY((packet->header.seqNum - seqNum) * RANGE_STATUS_RESEND_INTERVAL_US));
       if (dwt_starttx(DWT_START_TX_DLY_RS) != DWT_SUCCESS)
       {
+         telemetry_record_tx_failure();
          print("ERROR: Failed to retransmit received STATUS packet\n");
          return RANGE_COMPUTATION_PHASE;
       }
       return RANGE_STATUS_PHASE;
    }
-   else if (++current_slot == scheduled_slot)
-   {
-      transmitted_seq_num = 0;
-      dwt_writetxdata(sizeof(status_success_packet_t), (uint8_t*)&success_packet, 0);
-      dwt_setdelayedtrxtime(DW_DELAY_FROM_US(RANGE_STATUS_BROADCAST_PERIOD_US - (seqNum * RANGE_STATUS_RESEND_INTERVAL_US)));
-      if (dwt_starttx(DWT_START_TX_DLY_RS) != DWT_SUCCESS)
-      {
-         print("ERROR: Failed to transmit STATUS packet\n");
-         return RANGE_COMPUTATION_PHASE;
-      }
-      return RANGE_STATUS_PHASE;
-   }
-   else if (current_slot < total_num_slots)
-   {
-      // Move back into listening mode for additional status responses
-      last_rx_relative_to_transmit = false;
-      last_rx_delay_time_us = RANGE_STATUS_BROADCAST_PERIOD_US - (seqNum * RANGE_STATUS_RESEND_INTERVAL_US) - RECEIVE_EARLY_START_US;
-      dwt_setdelayedtrxtime(DW_DELAY_FROM_US(last_rx_delay_time_us));
-      if (!ranging_radio_rxenable(DWT_START_RX_DLY_RS))
-      {
-         print("ERROR: Unable to re-enable listening for STATUS packets after reception\n");
-         return RANGE_COMPUTATION_PHASE;
-      }
-      return RANGE_STATUS_PHASE;
-   }
 
-   // Move to the Range Computation Phase of the ranging protocol
-   return RANGE_COMPUTATION_PHASE;
+   // Move on to the next status slot
+   ++current_slot;
+   return begin_current_slot();
 }
 
 scheduler_phase_t status_phase_rx_error(void)
 {
    // Move to the next expected status packet to receive
-   if (++current_slot == scheduled_slot)
-   {
-      transmitted_seq_num = 0;
-      dwt_writetxdata(sizeof(status_success_packet_t), (uint8_t*)&success_packet, 0);
-      dwt_setdelayedtrxtime(DW_DELAY_FROM_US(last_rx_delay_time_us + RECEIVE_EARLY_START_US + RANGE_STATUS_BROADCAST_PERIOD_US));
-      if (dwt_starttx(last_rx_relative_to_transmit ? DWT_START_TX_DLY_TS : DWT_START_TX_DLY_RS) != DWT_SUCCESS)
-      {
-         print("ERROR: Failed to transmit STATUS packet after error\n");
-         return RANGE_COMPUTATION_PHASE;
-      }
-      return RANGE_STATUS_PHASE;
-   }
-   else if (current_slot < total_num_slots)
-   {
-      last_rx_delay_time_us += RANGE_STATUS_BROADCAST_PERIOD_US;
-      dwt_setdelayedtrxtime(DW_DELAY_FROM_US(last_rx_delay_time_us));
-      if (!ranging_radio_rxenable(last_rx_relative_to_transmit ? DWT_START_RX_DLY_TS : DWT_START_RX_DLY_RS))
-      {
-         print("ERROR: Unable to re-enable listening for STATUS packets after error\n");
-         return RANGE_COMPUTATION_PHASE;
-      }
-      return RANGE_STATUS_PHASE;
-   }
+   ++current_slot;
+   return begin_current_slot();
+}
 
-   // Move to the Range Computation Phase of the ranging protocol
-   return RANGE_COMPUTATION_PHASE;
+void status_phase_reset_device_statuses(uint8_t status_slot, const uint16_t *schedule)
+{
+   // Start each round knowing only about this device, storing motion statuses offset by one so that zero means unheard
+   scheduled_devices = schedule;
+   memset(device_statuses, 0, sizeof(device_statuses));
+   device_statuses[status_slot / 4] = (uint8_t)((success_packet.motion_status + 1) << (2 * (status_slot % 4)));
+}
+
+void status_phase_merge_device_statuses(const uint8_t *statuses)
+{
+   // Add every device heard directly or indirectly by the sender of a ranging packet, keeping the first status seen
+   for (uint8_t i = 0; i < RANGE_STATUS_BITMAP_LENGTH; ++i)
+      for (uint8_t shift = 0; shift < 8; shift += 2)
+         if (!((device_statuses[i] >> shift) & 0x03))
+            device_statuses[i] |= (uint8_t)(statuses[i] & (0x03 << shift));
 }
 
-const uint8_t* status_phase_get_detected_devices(uint8_t *num_devices)
+const uint8_t* status_phase_get_device_statuses(void)
+{
+   return device_statuses;
+}
+
+const uint16_t* status_phase_get_detected_devices(uint8_t *num_devices, const uint8_t **motion_statuses)
 {
    *num_devices = num_present_devices;
+   *motion_statuses = present_motion_statuses;
    return present_devices;
 }
+
+void status_phase_set_motion_status(motion_status_t motion_status)
+{
+   success_packet.motion_status = motion_status;
+}
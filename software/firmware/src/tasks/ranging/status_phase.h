@@ -11,7 +11,7 @@
 typedef struct __attribute__ ((__packed__))
 {
    ieee154_header_t header;
-   uint8_t message_type, success;
+   uint8_t message_type, success, motion_status;
    ieee154_footer_t footer;
 } status_success_packet_t;
 
@@ -19,10 +19,14 @@ typedef struct __attribute__ ((__packed__))
 // Public API ----------------------------------------------------------------------------------------------------------
 
 void status_phase_initialize(const uint8_t *uid);
-scheduler_phase_t status_phase_begin(uint8_t status_slot, uint8_t num_slots, uint32_t start_delay_us, bool start_relative_to_transmit);
+scheduler_phase_t status_phase_begin(uint8_t status_slot, uint8_t num_slots, uint64_t start_timestamp, int16_t clock_offset);
 scheduler_phase_t status_phase_tx_complete(void);
 scheduler_phase_t status_phase_rx_complete(status_success_packet_t* packet);
 scheduler_phase_t status_phase_rx_error(void);
-const uint8_t* status_phase_get_detected_devices(uint8_t *num_devices);
+void status_phase_reset_device_statuses(uint8_t status_slot, const uint16_t *schedule);
+void status_phase_merge_device_statuses(const uint8_t *statuses);
+const uint8_t* status_phase_get_device_statuses(void);
+const uint16_t* status_phase_get_detected_devices(uint8_t *num_devices, const uint8_t **motion_statuses);
+void status_phase_set_motion_status(motion_status_t motion_status);
 
 #endif  // #ifndef __STATUS_PHASE_HEADER_H__
@@ -0,0 +1,124 @@
+// Header Inclusions ---------------------------------------------------------------------------------------------------
+
+#include "telemetry.h"
+
+
+// Static Global Variables ---------------------------------------------------------------------------------------------
+
+static ranging_telemetry_t telemetry;
+static telemetry_counters_t current_round;
+static uint64_t round_latency_sum_us, total_latency_sum_us, total_wakeup_margin_sum_us, total_radio_on_time_us;
+static uint32_t round_num_events, total_num_events;
+static uint8_t num_scheduled_peers;
+
+
+// Private Helper Functions --------------------------------------------------------------------------------------------
+
+static void accumulate_counters(telemetry_counters_t *total, const telemetry_counters_t *round)
+{
+   // Add the event counts of a single round to the running totals and keep the worst latency seen so far
+   for (uint8_t i = 0; i < TELEMETRY_NUM_PHASES; ++i)
+      total->rx_timeouts[i] += round->rx_timeouts[i];
+   total->tx_failures += round->tx_failures;
+   total->collisions += round->collisions;
+   total->schedule_misses += round->schedule_misses;
+   for (uint8_t i = 0; i <= NUM_ANTENNAS; ++i)
+      total->peers_ranged[i] += round->peers_ranged[i];
+   if (round->max_event_latency_us > total->max_event_latency_us)
+      total->max_event_latency_us = round->max_event_latency_us;
+}
+
+
+// Public API Functions ------------------------------------------------------------------------------------------------
+
+void telemetry_reset(void)
+{
+   // Clear all per-round and cumulative counters
+   memset(&telemetry, 0, sizeof(telemetry));
+   telemetry.version = TELEMETRY_FORMAT_VERSION;
+   memset(&current_round, 0, sizeof(current_round));
+   round_latency_sum_us = total_latency_sum_us = total_wakeup_margin_sum_us = total_radio_on_time_us = 0;
+   round_num_events = total_num_events = 0;
+   num_scheduled_peers = 0;
+}
+
+void telemetry_record_rx_timeout(telemetry_phase_t phase)
+{
+   ++current_round.rx_timeouts[phase];
+}
+
+void telemetry_record_tx_failure(void)
+{
+   ++current_round.tx_failures;
+}
+
+void telemetry_record_collision(void)
+{
+   ++current_round.collisions;
+}
+
+void telemetry_record_schedule_miss(void)
+{
+   ++current_round.schedule_misses;
+}
+
+void telemetry_record_scheduled_peers(uint8_t num_peers)
+{
+   num_scheduled_peers = num_peers;
+}
+
+void telemetry_record_ranged_peer(uint8_t num_antennas)
+{
+   // Count each peer heard during this round by the number of antennas on which a valid range was measured to it
+   ++current_round.peers_ranged[(num_antennas < NUM_ANTENNAS) ? num_antennas : NUM_ANTENNAS];
+}
+
+void telemetry_record_event_latency(uint32_t latency_us)
+{
+   round_latency_sum_us += latency_us;
+   ++round_num_events;
+   if (latency_us > current_round.max_event_latency_us)
+      current_round.max_event_latency_us = latency_us;
+}
+
+void telemetry_record_wakeup_margin(uint32_t margin_us)
+{
+   // Report the widest radio wakeup margin chosen during this round
+   if (margin_us > current_round.wakeup_margin_us)
+      current_round.wakeup_margin_us = margin_us;
+}
+
+void telemetry_record_radio_activity(uint32_t active_us)
+{
+   current_round.radio_on_time_us += active_us;
+}
+
+const ranging_telemetry_t* telemetry_finish_round(void)
+{
+   // Count every scheduled peer which was never heard as having been ranged on no antennas
+   uint32_t num_peers_heard = 0;
+   for (uint8_t i = 0; i <= NUM_ANTENNAS; ++i)
+      num_peers_heard += current_round.peers_ranged[i];
+   if (num_scheduled_peers > num_peers_heard)
+      current_round.peers_ranged[0] += num_scheduled_peers - num_peers_heard;
+   num_scheduled_peers = 0;
+
+   // Average the radio event latencies over this round and over all rounds, along with the chosen wakeup margins and
+   //   the time that the radio was active
+   total_latency_sum_us += round_latency_sum_us;
+   total_num_events += round_num_events;
+   current_round.mean_event_latency_us = round_num_events ? (uint32_t)(round_latency_sum_us / round_num_events) : 0;
+   round_latency_sum_us = round_num_events = 0;
+   total_wakeup_margin_sum_us += current_round.wakeup_margin_us;
+   total_radio_on_time_us += current_round.radio_on_time_us;
+
+   // Publish the counters of the finished round along with the updated totals, and start counting the next round
+   accumulate_counters(&telemetry.total, &current_round);
+   telemetry.total.mean_event_latency_us = total_num_events ? (uint32_t)(total_latency_sum_us / total_num_events) : 0;
+   telemetry.round = current_round;
+   ++telemetry.num_rounds;
+   telemetry.total.wakeup_margin_us = (uint32_t)(total_wakeup_margin_sum_us / telemetry.num_rounds);
+   telemetry.total.radio_on_time_us = (uint32_t)(total_radio_on_time_us / telemetry.num_rounds);
+   memset(&current_round, 0, sizeof(current_round));
+   return &telemetry;
+}
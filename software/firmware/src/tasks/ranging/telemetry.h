@@ -0,0 +1,59 @@
+#ifndef __TELEMETRY_HEADER_H__
+#define __TELEMETRY_HEADER_H__
+
+// Header Inclusions ---------------------------------------------------------------------------------------------------
+
+#include "app_config.h"
+
+
+// Telemetry Definitions ---------------------------------------------------------------------------------------------
+
+#define TELEMETRY_FORMAT_VERSION                    2           // Increment whenever ranging_telemetry_t changes
+
+
+// Data Structures -----------------------------------------------------------------------------------------------------
+
+typedef enum
+{
+   TELEMETRY_SCHEDULE_PHASE = 0,
+   TELEMETRY_RANGING_PHASE,
+   TELEMETRY_STATUS_PHASE,
+   TELEMETRY_NUM_PHASES
+} telemetry_phase_t;
+
+typedef struct __attribute__ ((__packed__))
+{
+   uint32_t rx_timeouts[TELEMETRY_NUM_PHASES];
+   uint32_t tx_failures, collisions, schedule_misses;
+   uint32_t peers_ranged[NUM_ANTENNAS + 1];
+   uint32_t max_event_latency_us, mean_event_latency_us;
+   uint32_t wakeup_margin_us;
+   uint32_t radio_on_time_us;
+} telemetry_counters_t;
+
+typedef struct __attribute__ ((__packed__))
+{
+   uint8_t version;
+   uint32_t num_rounds;
+   telemetry_counters_t round, total;
+} ranging_telemetry_t;
+
+_Static_assert(sizeof(ranging_telemetry_t) <= MAX_TELEMETRY_DATA_LENGTH, "MAX_TELEMETRY_DATA_LENGTH is too small to hold the ranging telemetry");
+_Static_assert(sizeof(ranging_telemetry_t) <= 128, "Ranging telemetry no longer fits into a 128-byte storage record");
+
+
+// Public API ----------------------------------------------------------------------------------------------------------
+
+void telemetry_reset(void);
+void telemetry_record_rx_timeout(telemetry_phase_t phase);
+void telemetry_record_tx_failure(void);
+void telemetry_record_collision(void);
+void telemetry_record_schedule_miss(void);
+void telemetry_record_scheduled_peers(uint8_t num_peers);
+void telemetry_record_ranged_peer(uint8_t num_antennas);
+void telemetry_record_event_latency(uint32_t latency_us);
+void telemetry_record_wakeup_margin(uint32_t margin_us);
+void telemetry_record_radio_activity(uint32_t active_us);
+const ranging_telemetry_t* telemetry_finish_round(void);
+
+#endif  // #ifndef __TELEMETRY_HEADER_H__
@@ -0,0 +1,74 @@
+#ifndef __TIMING_HEADER_H__
+#define __TIMING_HEADER_H__
+
+// Header Inclusions ---------------------------------------------------------------------------------------------------
+
+#include "scheduler.h"
+
+
+// Integer Time Conversions --------------------------------------------------------------------------------------------
+
+// One DW3000 time unit lasts 1 / (499.2 MHz * 128), so one microsecond equals exactly 63897.6 = 319488 / 5 time units,
+//   one delayed TX/RX unit (time units >> 8) equals 1248 / 5 microseconds, and one RX timeout unit (512 / 499.2 MHz)
+//   equals 40 / 39 microseconds
+#define DW_TICKS_PER_US_NUMERATOR                           319488ULL
+#define DW_TICKS_PER_US_DENOMINATOR                         5ULL
+#define DW_DELAY_UNITS_PER_US_NUMERATOR                     1248ULL
+#define DW_DELAY_UNITS_PER_US_DENOMINATOR                   5ULL
+#define DW_TIMEOUT_UNITS_PER_US_NUMERATOR                   39ULL
+#define DW_TIMEOUT_UNITS_PER_US_DENOMINATOR                 40ULL
+
+#define US_TO_DW_TICKS(_us)                                 ((((uint64_t)(_us)) * DW_TICKS_PER_US_NUMERATOR) / DW_TICKS_PER_US_DENOMINATOR)
+#define DW_TICKS_TO_US(_ticks)                              ((uint32_t)((((uint64_t)(_ticks)) * DW_TICKS_PER_US_DENOMINATOR) / DW_TICKS_PER_US_NUMERATOR))
+#define US_TO_DW_DELAY(_us)                                 ((uint32_t)((((uint64_t)(_us)) * DW_DELAY_UNITS_PER_US_NUMERATOR) / DW_DELAY_UNITS_PER_US_DENOMINATOR))
+#define DW_DELAY_TO_US(_dwt)                                ((uint32_t)((((uint64_t)(_dwt)) * DW_DELAY_UNITS_PER_US_DENOMINATOR) / DW_DELAY_UNITS_PER_US_NUMERATOR))
+#define US_TO_DW_TIMEOUT(_us)                               ((uint32_t)((((uint64_t)(_us)) * DW_TIMEOUT_UNITS_PER_US_NUMERATOR) / DW_TIMEOUT_UNITS_PER_US_DENOMINATOR))
+
+// Clock offsets are measured in units of 1/16 ppm, with positive values meaning that the local clock runs faster than the
+//   master's clock and therefore counts more DW3000 time units over any duration of the master's round
+#define CLOCK_OFFSET_UNITS_PER_PPM                          16LL
+#define SYNCHRONIZED_DW_TICKS(_ticks, _clock_offset)        ((uint64_t)((int64_t)(_ticks) + (((int64_t)(_ticks) * (_clock_offset)) / (1000000LL * CLOCK_OFFSET_UNITS_PER_PPM))))
+#define SYNCHRONIZED_US_TO_DW_TICKS(_us, _clock_offset)     SYNCHRONIZED_DW_TICKS(US_TO_DW_TICKS(_us), _clock_offset)
+
+// Delayed transmissions start on a multiple of 512 DW3000 time units, ignoring the low-order bits of the requested time
+#define DW_DELAYED_TX_TICKS(_delayed_time)                  ((((uint64_t)(_delayed_time)) << 8) & ~0x1FFULL)
+
+// One preamble symbol lasts 1017.63 ns, and the receiver off time in sniff mode is counted in units of 128 / 125 microseconds
+#define DW_PREAMBLE_SYMBOL_NS                               1018UL
+#define DW_PAC_SYMBOLS                                      8UL
+#define US_TO_DW_SNIFF_OFF(_us)                             ((((uint32_t)(_us)) * 125UL) / 128UL)
+
+
+// Protocol Phase Durations --------------------------------------------------------------------------------------------
+
+#define PAIRWISE_RANGING_SUB_SLOT_PACKETS(_num_antennas, _single_sided)  \
+      ((_single_sided) ? (((_num_antennas) * RANGING_NUM_PACKETS_PER_SS_SEQUENCE) + 1) : ((_num_antennas) * RANGING_NUM_PACKETS_PER_SEQUENCE))
+#define PAIRWISE_RANGING_SUB_SLOT_US(_num_antennas, _single_sided)  (PAIRWISE_RANGING_SUB_SLOT_PACKETS(_num_antennas, _single_sided) * RANGING_BROADCAST_INTERVAL_US)
+#define BROADCAST_RANGING_DURATION_US(_num_devices)         (RANGING_NUM_SEQUENCES * RANGING_BROADCAST_NUM_CYCLES * (_num_devices) * RANGING_BROADCAST_INTERVAL_US)
+#define RANGE_STATUS_DURATION_US(_num_devices)              (RANGE_STATUS_PIGGYBACK ? 0 : ((_num_devices) * RANGE_STATUS_BROADCAST_PERIOD_US))
+#define ROUND_OVERHEAD_US(_num_devices)                     ((2 * RADIO_WAKEUP_SAFETY_DELAY_US) + SCHEDULE_BROADCAST_PERIOD_US + RANGE_STATUS_DURATION_US(_num_devices))
+
+// A fully populated round must fit into the nominal scheduling interval, including the radio wakeup margin, with room for
+//   at least one pairwise ranging sub-slot or for all broadcast ranging slots
+#define MAX_ROUND_DURATION_US                               (ROUND_OVERHEAD_US(MAX_NUM_RANGING_DEVICES) + \
+      ((RANGING_MODE == RANGING_MODE_BROADCAST) ? BROADCAST_RANGING_DURATION_US(MAX_NUM_RANGING_DEVICES) : PAIRWISE_RANGING_SUB_SLOT_US(NUM_ANTENNAS, RANGING_MODE == RANGING_MODE_SINGLE_SIDED)))
+
+
+// Compile-Time Timing Budget ------------------------------------------------------------------------------------------
+
+_Static_assert(MAX_ROUND_DURATION_US <= SCHEDULING_INTERVAL_US, "Schedule, Ranging, and Status Phases for MAX_NUM_RANGING_DEVICES do not fit into SCHEDULING_INTERVAL_US");
+_Static_assert(SCHEDULING_INTERVAL_MOVING_US <= SCHEDULING_INTERVAL_US, "SCHEDULING_INTERVAL_MOVING_US must not exceed SCHEDULING_INTERVAL_US");
+_Static_assert(SCHEDULING_INTERVAL_US <= SCHEDULING_INTERVAL_STILL_US, "SCHEDULING_INTERVAL_US must not exceed SCHEDULING_INTERVAL_STILL_US");
+_Static_assert(((SCHEDULING_INTERVAL_MOVING_US % SCHEDULING_INTERVAL_RESOLUTION_US) == 0) && ((SCHEDULING_INTERVAL_US % SCHEDULING_INTERVAL_RESOLUTION_US) == 0) &&
+      ((SCHEDULING_INTERVAL_STILL_US % SCHEDULING_INTERVAL_RESOLUTION_US) == 0), "Scheduling intervals must be multiples of SCHEDULING_INTERVAL_RESOLUTION_US");
+_Static_assert(SCHEDULE_NUM_MASTER_BROADCASTS <= SCHEDULE_NUM_TOTAL_BROADCASTS, "The master cannot send more schedules than the total number of broadcasts");
+_Static_assert(!(SCHEDULE_FLOOD && RANGE_STATUS_PIGGYBACK), "Flooded schedules must be identical, so they cannot relay per-device statuses");
+_Static_assert((DW_PREAMBLE_LENGTH == DWT_PLEN_128) && (DW_PAC_SIZE == DWT_PAC8), "Network search sniff timing assumes a 128-symbol preamble with 8-symbol PACs");
+_Static_assert((NETWORK_SEARCH_SNIFF_ON_PACS >= 1) && (NETWORK_SEARCH_SNIFF_ON_PACS <= 15) && (US_TO_DW_SNIFF_OFF(NETWORK_SEARCH_SNIFF_OFF_US) <= 255), "Sniff mode on and off times exceed their DW3000 register ranges");
+_Static_assert(((1000UL * NETWORK_SEARCH_SNIFF_OFF_US) + (2 * (NETWORK_SEARCH_SNIFF_ON_PACS + 1) * DW_PAC_SYMBOLS * DW_PREAMBLE_SYMBOL_NS)) < (128 * DW_PREAMBLE_SYMBOL_NS), "A sniffing receiver must wake up early enough within every preamble to detect and acquire it");
+_Static_assert(SCHEDULE_MERGE_TIMEOUT_US < SCHEDULE_MERGE_SLOT_US, "Listening for merge requests must end within the merge request slot");
+_Static_assert(RANGING_TIMEOUT_US < RANGING_BROADCAST_INTERVAL_US, "Ranging reception timeouts must end before the next ranging packet");
+_Static_assert(RANGE_STATUS_TIMEOUT_US < RANGE_STATUS_BROADCAST_PERIOD_US, "Status reception timeouts must end within a status slot");
+_Static_assert(((SCHEDULING_INTERVAL_STILL_US * DW_DELAY_UNITS_PER_US_NUMERATOR) / DW_DELAY_UNITS_PER_US_DENOMINATOR) < (1ULL << 32), "Delayed TX/RX times within a round must not wrap around");
+
+#endif  // #ifndef __TIMING_HEADER_H__
@@ -9,14 +9,16 @@
 
 static TaskHandle_t ranging_task_handle;
 static volatile bool is_ranging = false;
+static volatile uint8_t ranging_channel;
 
 
 // Public API Functions ------------------------------------------------------------------------------------------------
 
-void ranging_begin(schedule_role_t role)
+void ranging_begin(schedule_role_t role, uint8_t channel)
 {
-   // Notify the ranging task to start with the indicated role
+   // Notify the ranging task to start with the indicated role on the indicated channel, or on any channel if unknown
    is_ranging = true;
+   ranging_channel = channel;
    scheduler_prepare();
    xTaskNotify(ranging_task_handle, role, eSetValueWithOverwrite);
 }
@@ -37,7 +39,13 @@ bool ranging_active(void)
 void ranging_schedule_device(const uint8_t *device_id)
 {
    // Instruct ranging scheduler to add device
-   scheduler_add_device(device_id[0]);
+   scheduler_add_device(DEVICE_ID(device_id));
+}
+
+void ranging_update_motion_status(bool in_motion)
+{
+   // Inform the ranging scheduler of the current device motion status
+   scheduler_set_motion_status(in_motion);
 }
 
 void RangingTask(void *uid)
@@ -52,7 +60,7 @@ void RangingTask(void *uid)
    {
       // Sleep until time to start ranging with the indicated role
       if ((xTaskNotifyWait(pdFALSE, 0xffffffff, &desired_role_bits, portMAX_DELAY) == pdTRUE) && uid)
-         scheduler_run((schedule_role_t)desired_role_bits, rtc_get_timestamp());
+         scheduler_run((schedule_role_t)desired_role_bits, ranging_channel, rtc_get_timestamp());
 
       // Notify the application that network connectivity has been lost
       is_ranging = false;
@@ -1,6 +1,7 @@
 // Header Inclusions ---------------------------------------------------------------------------------------------------
 
 #include "app_tasks.h"
+#include "logging.h"
 #include "rtc.h"
 #include "storage.h"
 #include "system.h"
@@ -13,17 +14,21 @@ typedef enum {
    STORAGE_TYPE_VOLTAGE,
    STORAGE_TYPE_CHARGING_EVENT,
    STORAGE_TYPE_MOTION,
-   STORAGE_TYPE_RANGES
+   STORAGE_TYPE_RANGES,
+   STORAGE_TYPE_TELEMETRY
 } storage_data_type_t;
 
 typedef struct storage_item_t { uint32_t timestamp, value, type; } storage_item_t;
-typedef struct ranging_data_t { uint8_t data[MAX_COMPRESSED_RANGE_DATA_LENGTH]; uint32_t length; } ranging_data_t;
+typedef struct ranging_data_t { uint8_t data[MAX_COMPRESSED_RANGE_DATA_LENGTH]; uint32_t length; uint16_t timestamp_ms; } ranging_data_t;
+typedef struct telemetry_data_t { uint8_t data[MAX_TELEMETRY_DATA_LENGTH]; uint32_t length; } telemetry_data_t;
 
 
 // Static Global Variables ---------------------------------------------------------------------------------------------
 
 static QueueHandle_t storage_queue;
 static ranging_data_t range_data[STORAGE_QUEUE_MAX_NUM_ITEMS];
+static telemetry_data_t telemetry_summary;
+static volatile bool telemetry_summary_pending;
 
 
 // Private Helper Functions --------------------------------------------------------------------------------------------
@@ -55,14 +60,25 @@ static void store_motion_change(uint32_t timestamp, bool in_motion)
    storage_flush(false);
 }
 
-static void store_ranges(uint32_t timestamp, const uint8_t *range_data, uint32_t range_data_len)
+static void store_ranges(uint32_t timestamp, uint16_t timestamp_ms, const uint8_t *range_data, uint32_t range_data_len)
 {
    const uint8_t storage_type = STORAGE_TYPE_RANGES;
    storage_store(&storage_type, sizeof(storage_type));
+   storage_store(&timestamp, sizeof(timestamp));
+   storage_store(&timestamp_ms, sizeof(timestamp_ms));
    storage_store(range_data, range_data_len);
    storage_flush(false);
 }
 
+static void store_telemetry(uint32_t timestamp, const uint8_t *telemetry_data, uint32_t telemetry_data_len)
+{
+   const uint8_t storage_type = STORAGE_TYPE_TELEMETRY;
+   storage_store(&storage_type, sizeof(storage_type));
+   storage_store(&timestamp, sizeof(timestamp));
+   storage_store(telemetry_data, telemetry_data_len);
+   storage_flush(false);
+}
+
 
 // Public API Functions ------------------------------------------------------------------------------------------------
 
@@ -94,16 +110,32 @@ void storage_write_motion_status(bool in_motion)
    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
 }
 
-void storage_write_ranging_data(uint32_t timestamp, const uint8_t *ranging_data, uint32_t ranging_data_len)
+void storage_write_ranging_data(uint32_t timestamp, uint16_t timestamp_ms, const uint8_t *ranging_data, uint32_t ranging_data_len)
 {
    static uint32_t range_data_index = 0;
    storage_item_t storage_item = { .timestamp = timestamp, .value = range_data_index, .type = STORAGE_TYPE_RANGES };
    memcpy(range_data[range_data_index].data, ranging_data, ranging_data_len);
    range_data[range_data_index].length = ranging_data_len;
+   range_data[range_data_index].timestamp_ms = timestamp_ms;
    range_data_index = (range_data_index + 1) % STORAGE_QUEUE_MAX_NUM_ITEMS;
    xQueueSendToBack(storage_queue, &storage_item, portMAX_DELAY);
 }
 
+void storage_write_telemetry(uint32_t timestamp, const uint8_t *telemetry_data, uint32_t telemetry_data_len)
+{
+   // Skip this summary if the previous one has not been stored yet, since they share a single buffer
+   if (telemetry_summary_pending)
+   {
+      print("WARNING: Dropping telemetry summary while the previous one is still being stored\n");
+      return;
+   }
+   storage_item_t storage_item = { .timestamp = timestamp, .value = 0, .type = STORAGE_TYPE_TELEMETRY };
+   memcpy(telemetry_summary.data, telemetry_data, telemetry_data_len);
+   telemetry_summary.length = telemetry_data_len;
+   telemetry_summary_pending = true;
+   xQueueSendToBack(storage_queue, &storage_item, portMAX_DELAY);
+}
+
 void StorageTask(void *params)
 {
    // Create a queue to hold pending storage items
@@ -135,7 +167,11 @@ void StorageTask(void *params)
                store_motion_change(item.timestamp, item.value);
                break;
             case STORAGE_TYPE_RANGES:
-               store_ranges(item.timestamp, range_data[item.value].data, range_data[item.value].length);
+               store_ranges(item.timestamp, range_data[item.value].timestamp_ms, range_data[item.value].data, range_data[item.value].length);
+               break;
+            case STORAGE_TYPE_TELEMETRY:
+               store_telemetry(item.timestamp, telemetry_summary.data, telemetry_summary.length);
+               telemetry_summary_pending = false;
                break;
             default:
                break;
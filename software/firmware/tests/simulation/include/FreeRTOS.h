@@ -0,0 +1,52 @@
+#ifndef __SIM_FREERTOS_HEADER_H__
+#define __SIM_FREERTOS_HEADER_H__
+
+// Host stand-in for the subset of the FreeRTOS API used by the ranging protocol
+
+// Header Inclusions ---------------------------------------------------------------------------------------------------
+
+#include <stdbool.h>
+#include <stdint.h>
+
+
+// Kernel Configuration ------------------------------------------------------------------------------------------------
+
+#define configTICK_RATE_HZ                          1000
+#define NVIC_configMAX_SYSCALL_INTERRUPT_PRIORITY   (0x3)
+#define configASSERT0(x)                            if ((x) != 0) vAssertCalled(__FILE__, __LINE__)
+#define configASSERT1(x)                            if ((x) != 1) vAssertCalled(__FILE__, __LINE__)
+
+
+// Kernel Types and Definitions ----------------------------------------------------------------------------------------
+
+typedef long BaseType_t;
+typedef uint32_t TickType_t;
+typedef void* TaskHandle_t;
+typedef void* QueueHandle_t;
+typedef void* SemaphoreHandle_t;
+typedef enum { eNoAction = 0, eSetBits, eIncrement, eSetValueWithOverwrite, eSetValueWithoutOverwrite } eNotifyAction;
+
+#define pdFALSE                                     ((BaseType_t)0)
+#define pdTRUE                                      ((BaseType_t)1)
+#define pdPASS                                      pdTRUE
+#define portMAX_DELAY                               ((TickType_t)0xffffffffUL)
+#define pdMS_TO_TICKS(ms)                           ((TickType_t)(((TickType_t)(ms) * (TickType_t)configTICK_RATE_HZ) / (TickType_t)1000))
+#define portYIELD_FROM_ISR(x)                       ((void)(x))
+#define taskSCHEDULER_RUNNING                       ((BaseType_t)2)
+
+
+// Kernel API ----------------------------------------------------------------------------------------------------------
+
+void vAssertCalled(const char *file, uint32_t line);
+TaskHandle_t xTaskGetCurrentTaskHandle(void);
+BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value, eNotifyAction action);
+BaseType_t xTaskNotifyFromISR(TaskHandle_t task, uint32_t value, eNotifyAction action, BaseType_t *higher_priority_task_woken);
+BaseType_t xTaskNotifyWait(uint32_t bits_to_clear_on_entry, uint32_t bits_to_clear_on_exit, uint32_t *notification_value, TickType_t ticks_to_wait);
+void vTaskDelay(TickType_t ticks);
+BaseType_t xTaskGetSchedulerState(void);
+BaseType_t xPortIsInsideInterrupt(void);
+SemaphoreHandle_t xSemaphoreCreateBinary(void);
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks_to_wait);
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t semaphore, BaseType_t *higher_priority_task_woken);
+
+#endif  // #ifndef __SIM_FREERTOS_HEADER_H__
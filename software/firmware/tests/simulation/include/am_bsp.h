@@ -0,0 +1,148 @@
+#ifndef __SIM_AM_BSP_HEADER_H__
+#define __SIM_AM_BSP_HEADER_H__
+
+// Host stand-in for the subset of the Ambiq BSP/HAL used by the ranging protocol and DW3000 glue code
+
+// Header Inclusions ---------------------------------------------------------------------------------------------------
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+
+// Core and Clock Definitions ------------------------------------------------------------------------------------------
+
+#define AM_HAL_STATUS_SUCCESS                       0
+#define AM_HAL_CLKGEN_FREQ_MAX_HZ                   96000000
+#define AM_HAL_SYSCTRL_WAKE                         0
+#define __DMB()                                     __sync_synchronize()
+
+typedef enum { RTC_IRQn = 2, IOMSTR0_IRQn = 6, TIMER0_IRQn = 32, GPIO0_001F_IRQn = 56 } IRQn_Type;
+typedef struct { uint32_t ui32Reserved; } am_hal_reset_status_t;
+
+void NVIC_SetPriority(int irq, uint32_t priority);
+void NVIC_EnableIRQ(int irq);
+void NVIC_DisableIRQ(int irq);
+void am_hal_delay_us(uint32_t us);
+uint32_t am_hal_interrupt_master_disable(void);
+void am_hal_interrupt_master_set(uint32_t interrupt_mask);
+uint32_t __get_PRIMASK(void);
+
+
+// GPIO Definitions ----------------------------------------------------------------------------------------------------
+
+#define GPIO_NUM2IDX(pin)                           ((pin) / 32)
+#define AM_HAL_GPIO_INT_CHANNEL_0                   0
+#define AM_HAL_GPIO_INT_CTRL_INDV_DISABLE           0
+#define AM_HAL_GPIO_INT_CTRL_INDV_ENABLE            1
+#define AM_HAL_GPIO_INPUT_READ                      0
+#define AM_HAL_GPIO_PIN_PULLDOWN_50K                1
+#define AM_HAL_GPIO_PINCFG_INPUT                    ((am_hal_gpio_pincfg_t){ .GP.cfg_b = { 0 } })
+#define AM_HAL_PIN_29_NCE29                         0
+#define AM_HAL_PIN_31_M3SCK                         0
+#define AM_HAL_PIN_32_M3MOSI                        0
+#define AM_HAL_PIN_33_M3MISO                        0
+
+typedef struct { struct { struct { uint32_t uFuncSel, ePullup, uNCE; } cfg_b; } GP; } am_hal_gpio_pincfg_t;
+typedef void (*am_hal_gpio_handler_t)(void *args);
+
+extern const am_hal_gpio_pincfg_t am_hal_gpio_pincfg_output, am_hal_gpio_pincfg_tristate;
+extern const am_hal_gpio_pincfg_t g_AM_BSP_GPIO_IOM0_SCK, g_AM_BSP_GPIO_IOM0_MISO, g_AM_BSP_GPIO_IOM0_MOSI, g_AM_BSP_GPIO_IOM0_CS;
+
+uint32_t am_hal_gpio_pinconfig(uint32_t pin, am_hal_gpio_pincfg_t config);
+uint32_t am_hal_gpio_state_read(uint32_t pin, uint32_t read_type, uint32_t *state);
+uint32_t am_hal_gpio_interrupt_control(uint32_t channel, uint32_t control, void *pin);
+uint32_t am_hal_gpio_interrupt_register(uint32_t channel, uint32_t pin, am_hal_gpio_handler_t handler, void *args);
+void am_hal_gpio_output_set(uint32_t pin);
+void am_hal_gpio_output_clear(uint32_t pin);
+void am_hal_gpio_output_tristate_enable(uint32_t pin);
+void am_hal_gpio_output_tristate_disable(uint32_t pin);
+
+
+// IOM (SPI) Definitions -----------------------------------------------------------------------------------------------
+
+typedef enum { AM_HAL_IOM_SPI_MODE } am_hal_iom_mode_e;
+typedef enum { AM_HAL_IOM_SPI_MODE_0 } am_hal_iom_spi_mode_e;
+typedef enum { AM_HAL_IOM_TX, AM_HAL_IOM_RX } am_hal_iom_dir_e;
+#define AM_HAL_IOM_6MHZ                             6000000
+#define AM_HAL_IOM_24MHZ                            24000000
+#define AM_HAL_IOM_INT_CMDCMP                       0x00000001
+#define AM_HAL_IOM_INT_DCMP                         0x00000002
+#define AM_HAL_IOM_INT_DERR                         0x00000004
+#define AM_HAL_IOM_INT_ERR                          0x00000008
+
+typedef void (*am_hal_iom_callback_t)(void *pCallbackCtxt, uint32_t transactionStatus);
+
+typedef struct
+{
+   am_hal_iom_mode_e eInterfaceMode;
+   uint32_t ui32ClockFreq;
+   am_hal_iom_spi_mode_e eSpiMode;
+   uint32_t *pNBTxnBuf;
+   uint32_t ui32NBTxnBufLength;
+} am_hal_iom_config_t;
+
+typedef struct
+{
+   union { uint32_t ui32SpiChipSelect; } uPeerInfo;
+   uint32_t ui32InstrLen;
+   uint64_t ui64Instr;
+   am_hal_iom_dir_e eDirection;
+   uint32_t ui32NumBytes;
+   uint32_t *pui32TxBuffer, *pui32RxBuffer;
+   bool bContinue;
+   uint8_t ui8RepeatCount, ui8Priority;
+   uint32_t ui32PauseCondition, ui32StatusSetClr;
+} am_hal_iom_transfer_t;
+
+uint32_t am_hal_iom_initialize(uint32_t module, void **handle);
+uint32_t am_hal_iom_uninitialize(void *handle);
+uint32_t am_hal_iom_power_ctrl(void *handle, uint32_t state, bool retain_state);
+uint32_t am_hal_iom_configure(void *handle, const am_hal_iom_config_t *config);
+uint32_t am_hal_iom_enable(void *handle);
+uint32_t am_hal_iom_disable(void *handle);
+uint32_t am_hal_iom_blocking_transfer(void *handle, am_hal_iom_transfer_t *transaction);
+uint32_t am_hal_iom_nonblocking_transfer(void *handle, am_hal_iom_transfer_t *transaction, am_hal_iom_callback_t callback, void *callback_context);
+uint32_t am_hal_iom_interrupt_enable(void *handle, uint32_t interrupt_mask);
+uint32_t am_hal_iom_interrupt_status_get(void *handle, bool enabled_only, uint32_t *interrupt_status);
+uint32_t am_hal_iom_interrupt_clear(void *handle, uint32_t interrupt_mask);
+uint32_t am_hal_iom_interrupt_service(void *handle, uint32_t interrupt_mask);
+
+
+// Timer Definitions ---------------------------------------------------------------------------------------------------
+
+#define AM_HAL_TIMER_COMPARE0                       0x1
+#define AM_HAL_TIMER_COMPARE1                       0x2
+#define AM_HAL_TIMER_COMPARE_BOTH                   0x3
+#define AM_HAL_TIMER_MASK(timer, compare)           ((compare) << (2 * (timer)))
+
+typedef enum { AM_HAL_TIMER_FN_EDGE, AM_HAL_TIMER_FN_UPCOUNT } am_hal_timer_function_e;
+typedef struct { am_hal_timer_function_e eFunction; uint32_t ui32Compare0, ui32Compare1; } am_hal_timer_config_t;
+
+uint32_t am_hal_timer_default_config_set(am_hal_timer_config_t *config);
+uint32_t am_hal_timer_config(uint32_t timer_number, am_hal_timer_config_t *config);
+uint32_t am_hal_timer_clear(uint32_t timer_number);
+uint32_t am_hal_timer_read(uint32_t timer_number);
+uint32_t am_hal_timer_interrupt_enable(uint32_t interrupt_mask);
+uint32_t am_hal_timer_interrupt_disable(uint32_t interrupt_mask);
+uint32_t am_hal_timer_interrupt_clear(uint32_t interrupt_mask);
+
+
+// RTC Definitions -----------------------------------------------------------------------------------------------------
+
+#define AM_HAL_RTC_INT_ALM                          0x8
+typedef enum { AM_HAL_RTC_ALM_RPT_DIS, AM_HAL_RTC_ALM_RPT_YR, AM_HAL_RTC_ALM_RPT_MTH, AM_HAL_RTC_ALM_RPT_WK,
+   AM_HAL_RTC_ALM_RPT_DAY, AM_HAL_RTC_ALM_RPT_HR, AM_HAL_RTC_ALM_RPT_MIN, AM_HAL_RTC_ALM_RPT_SEC,
+   AM_HAL_RTC_ALM_RPT_10TH, AM_HAL_RTC_ALM_RPT_100TH } am_hal_rtc_alarm_repeat_e;
+
+typedef struct
+{
+   uint32_t ui32ReadError, ui32CenturyEnable, ui32Weekday, ui32Century, ui32Year, ui32Month;
+   uint32_t ui32DayOfMonth, ui32Hour, ui32Minute, ui32Second, ui32Hundredths;
+} am_hal_rtc_time_t;
+
+uint32_t am_hal_rtc_alarm_set(am_hal_rtc_time_t *time, am_hal_rtc_alarm_repeat_e repeat_interval);
+uint32_t am_hal_rtc_interrupt_enable(uint32_t interrupt_mask);
+uint32_t am_hal_rtc_interrupt_disable(uint32_t interrupt_mask);
+
+#endif  // #ifndef __SIM_AM_BSP_HEADER_H__
@@ -0,0 +1,10 @@
+#ifndef __SIM_AM_UTIL_HEADER_H__
+#define __SIM_AM_UTIL_HEADER_H__
+
+// Host stand-in for the Ambiq utility library
+
+#include <stdint.h>
+
+uint32_t am_util_stdio_printf(const char *format, ...);
+
+#endif  // #ifndef __SIM_AM_UTIL_HEADER_H__
@@ -0,0 +1,2 @@
+// Host stand-in: the simulated kernel API is declared in FreeRTOS.h
+#include "FreeRTOS.h"
@@ -0,0 +1,11 @@
+#ifndef __SIM_WSF_TYPES_HEADER_H__
+#define __SIM_WSF_TYPES_HEADER_H__
+
+// Host stand-in for the Cordio WSF base types
+
+#include <stdbool.h>
+#include <stdint.h>
+
+typedef uint8_t bool_t;
+
+#endif  // #ifndef __SIM_WSF_TYPES_HEADER_H__
@@ -0,0 +1,324 @@
+// Header Inclusions ---------------------------------------------------------------------------------------------------
+
+#include <math.h>
+#include "simulator.h"
+
+
+// Static Global Variables ---------------------------------------------------------------------------------------------
+
+typedef struct { sim_time_t time; uint64_t id; sim_event_handler_t handler; void *context; } sim_event_t;
+typedef struct { bool given; sim_task_t *waiting_task; } sim_semaphore_t;
+
+static sim_event_t *events;
+static size_t num_events, max_events;
+static uint64_t next_event_id = 1, random_state = 0x9E3779B97F4A7C15ULL;
+static sim_time_t current_time;
+static ucontext_t kernel_context;
+
+sim_device_t *sim_current_device;
+sim_task_t *sim_current_task;
+
+
+// Private Helper Functions --------------------------------------------------------------------------------------------
+
+static bool event_before(const sim_event_t *a, const sim_event_t *b)
+{
+   return (a->time < b->time) || ((a->time == b->time) && (a->id < b->id));
+}
+
+static void event_swap(size_t a, size_t b)
+{
+   sim_event_t temp = events[a];
+   events[a] = events[b];
+   events[b] = temp;
+}
+
+static sim_event_t event_pop(void)
+{
+   // Remove the earliest event and restore the heap property
+   sim_event_t earliest = events[0];
+   events[0] = events[--num_events];
+   for (size_t i = 0, child = 1; child < num_events; i = child, child = (2 * i) + 1)
+   {
+      if (((child + 1) < num_events) && event_before(&events[child + 1], &events[child]))
+         ++child;
+      if (!event_before(&events[child], &events[i]))
+         break;
+      event_swap(i, child);
+   }
+   return earliest;
+}
+
+static void task_resume(void *context, uint64_t event_id)
+{
+   // Ignore stale wakeup events which have been superseded
+   sim_task_t *task = (sim_task_t*)context;
+   if (task->finished || (task->wakeup_event != event_id))
+      return;
+   task->wakeup_event = 0;
+   task->wakeup_from_notification = false;
+
+   // Switch into the task context until it blocks again
+   sim_current_task = task;
+   sim_current_device = task->device;
+   swapcontext(&kernel_context, &task->context);
+   sim_current_task = NULL;
+   sim_current_device = NULL;
+   if (task->finished)
+   {
+      free(task->stack);
+      task->stack = NULL;
+   }
+}
+
+static void task_block(void)
+{
+   // Hand control back to the simulation kernel
+   swapcontext(&sim_current_task->context, &kernel_context);
+}
+
+static void task_entry(void)
+{
+   // Run the task function and mark the task as finished when it returns
+   sim_task_t *task = sim_current_task;
+   task->function(task->argument);
+   task->finished = true;
+}
+
+static BaseType_t task_notify(TaskHandle_t handle, uint32_t value, eNotifyAction action, sim_time_t latency)
+{
+   // Update the notification value of the target task
+   sim_task_t *task = (sim_task_t*)handle;
+   if (!task || task->finished)
+      return pdFALSE;
+   switch (action)
+   {
+      case eSetBits:
+         task->notification_value |= value;
+         break;
+      case eIncrement:
+         ++task->notification_value;
+         break;
+      case eSetValueWithOverwrite:
+         task->notification_value = value;
+         break;
+      case eSetValueWithoutOverwrite:
+         if (task->notification_pending)
+            return pdFALSE;
+         task->notification_value = value;
+         break;
+      default:
+         break;
+   }
+
+   // Wake up the task if it is currently waiting for a notification
+   task->notification_pending = true;
+   if (task->waiting_for_notification && !task->wakeup_from_notification)
+   {
+      task->wakeup_from_notification = true;
+      task->wakeup_event = sim_schedule_event(current_time + latency, task_resume, task);
+   }
+   return pdTRUE;
+}
+
+
+// Simulation Kernel API -----------------------------------------------------------------------------------------------
+
+sim_time_t sim_now(void)
+{
+   return current_time;
+}
+
+uint64_t sim_schedule_event(sim_time_t time, sim_event_handler_t handler, void *context)
+{
+   // Grow the event heap if necessary
+   if (num_events == max_events)
+   {
+      max_events = max_events ? (2 * max_events) : 1024;
+      events = (sim_event_t*)realloc(events, max_events * sizeof(sim_event_t));
+   }
+
+   // Insert the new event and restore the heap property
+   size_t i = num_events++;
+   events[i] = (sim_event_t){ .time = (time < current_time) ? current_time : time, .id = next_event_id++,
+      .handler = handler, .context = context };
+   for (; i && event_before(&events[i], &events[(i - 1) / 2]); i = (i - 1) / 2)
+      event_swap(i, (i - 1) / 2);
+   return next_event_id - 1;
+}
+
+void sim_run_until(sim_time_t end_time)
+{
+   // Process all events in chronological order
+   while (num_events && (events[0].time <= end_time))
+   {
+      sim_event_t event = event_pop();
+      current_time = event.time;
+      event.handler(event.context, event.id);
+   }
+   current_time = end_time;
+}
+
+sim_task_t* sim_task_create(sim_device_t *device, const char *name, sim_task_function_t function, void *argument)
+{
+   // Create a new cooperative task context with its own stack
+   sim_task_t *task = (sim_task_t*)calloc(1, sizeof(sim_task_t));
+   task->stack = malloc(SIM_TASK_STACK_SIZE);
+   task->device = device;
+   task->function = function;
+   task->argument = argument;
+   task->name = name;
+   getcontext(&task->context);
+   task->context.uc_stack.ss_sp = task->stack;
+   task->context.uc_stack.ss_size = SIM_TASK_STACK_SIZE;
+   task->context.uc_link = &kernel_context;
+   makecontext(&task->context, task_entry, 0);
+
+   // Schedule the task to start running immediately
+   task->wakeup_event = sim_schedule_event(current_time, task_resume, task);
+   return task;
+}
+
+void sim_task_sleep(sim_time_t duration)
+{
+   // Block the current task for the specified amount of simulated time
+   sim_task_t *task = sim_current_task;
+   task->wakeup_event = sim_schedule_event(current_time + duration, task_resume, task);
+   task_block();
+}
+
+void sim_run_isr(sim_device_t *device, void (*isr)(void))
+{
+   // Run an interrupt service routine in the context of the specified device
+   sim_device_t *interrupted_device = sim_current_device;
+   sim_task_t *interrupted_task = sim_current_task;
+   sim_current_device = device;
+   sim_current_task = NULL;
+   isr();
+   sim_current_device = interrupted_device;
+   sim_current_task = interrupted_task;
+}
+
+void sim_random_seed(uint32_t seed)
+{
+   random_state = 0x9E3779B97F4A7C15ULL * ((uint64_t)seed + 1);
+}
+
+double sim_random_uniform(void)
+{
+   // Generate a uniformly distributed random number in [0, 1) using xorshift64*
+   random_state ^= random_state >> 12;
+   random_state ^= random_state << 25;
+   random_state ^= random_state >> 27;
+   return (double)((random_state * 0x2545F4914F6CDD1DULL) >> 11) / (double)(1ULL << 53);
+}
+
+double sim_random_gaussian(void)
+{
+   // Generate a normally distributed random number using the Box-Muller transform
+   const double u1 = 1.0 - sim_random_uniform(), u2 = sim_random_uniform();
+   return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+
+// FreeRTOS Kernel API -------------------------------------------------------------------------------------------------
+
+TaskHandle_t xTaskGetCurrentTaskHandle(void)
+{
+   return sim_current_task;
+}
+
+BaseType_t xTaskNotify(TaskHandle_t task, uint32_t value, eNotifyAction action)
+{
+   return task_notify(task, value, action, 0);
+}
+
+BaseType_t xTaskNotifyFromISR(TaskHandle_t task, uint32_t value, eNotifyAction action, BaseType_t *higher_priority_task_woken)
+{
+   if (higher_priority_task_woken)
+      *higher_priority_task_woken = pdTRUE;
+   return task_notify(task, value, action, SIM_US(sim_config.isr_latency_us));
+}
+
+BaseType_t xTaskNotifyWait(uint32_t bits_to_clear_on_entry, uint32_t bits_to_clear_on_exit, uint32_t *notification_value, TickType_t ticks_to_wait)
+{
+   // Block until a notification arrives or the timeout expires
+   sim_task_t *task = sim_current_task;
+   if (!task->notification_pending)
+   {
+      task->notification_value &= ~bits_to_clear_on_entry;
+      if (!ticks_to_wait)
+         return pdFALSE;
+      task->waiting_for_notification = true;
+      task->wakeup_event = (ticks_to_wait == portMAX_DELAY) ? 0 :
+            sim_schedule_event(current_time + ((sim_time_t)ticks_to_wait * SIM_PS_PER_MS), task_resume, task);
+      task_block();
+      task->waiting_for_notification = false;
+      if (!task->notification_pending)
+         return pdFALSE;
+   }
+
+   // Return and clear the pending notification value
+   if (notification_value)
+      *notification_value = task->notification_value;
+   task->notification_value &= ~bits_to_clear_on_exit;
+   task->notification_pending = false;
+   return pdTRUE;
+}
+
+void vTaskDelay(TickType_t ticks)
+{
+   sim_task_sleep((sim_time_t)ticks * SIM_PS_PER_MS);
+}
+
+BaseType_t xTaskGetSchedulerState(void)
+{
+   return taskSCHEDULER_RUNNING;
+}
+
+BaseType_t xPortIsInsideInterrupt(void)
+{
+   return sim_current_task ? pdFALSE : pdTRUE;
+}
+
+SemaphoreHandle_t xSemaphoreCreateBinary(void)
+{
+   return calloc(1, sizeof(sim_semaphore_t));
+}
+
+BaseType_t xSemaphoreTake(SemaphoreHandle_t semaphore, TickType_t ticks_to_wait)
+{
+   // Block until the semaphore is given, supporting only indefinite waits
+   sim_semaphore_t *binary_semaphore = (sim_semaphore_t*)semaphore;
+   while (!binary_semaphore->given)
+   {
+      if (!ticks_to_wait)
+         return pdFALSE;
+      binary_semaphore->waiting_task = sim_current_task;
+      sim_current_task->wakeup_event = 0;
+      task_block();
+   }
+   binary_semaphore->given = false;
+   return pdTRUE;
+}
+
+BaseType_t xSemaphoreGiveFromISR(SemaphoreHandle_t semaphore, BaseType_t *higher_priority_task_woken)
+{
+   // Wake up any task waiting on the semaphore
+   sim_semaphore_t *binary_semaphore = (sim_semaphore_t*)semaphore;
+   sim_task_t *task = binary_semaphore->waiting_task;
+   binary_semaphore->given = true;
+   binary_semaphore->waiting_task = NULL;
+   if (task)
+      task->wakeup_event = sim_schedule_event(current_time + SIM_US(sim_config.isr_latency_us), task_resume, task);
+   if (higher_priority_task_woken)
+      *higher_priority_task_woken = pdTRUE;
+   return pdTRUE;
+}
+
+void am_hal_delay_us(uint32_t us)
+{
+   // Busy-waits only consume simulated time when called from a task context
+   if (sim_current_task)
+      sim_task_sleep((sim_time_t)us * SIM_PS_PER_US);
+}
@@ -0,0 +1,402 @@
+// Header Inclusions ---------------------------------------------------------------------------------------------------
+
+#include <dlfcn.h>
+#include <getopt.h>
+#include <math.h>
+#include <unistd.h>
+#include "simulator.h"
+
+
+// Simulation Definitions ----------------------------------------------------------------------------------------------
+
+#define EPOCH_START_TIMESTAMP                       1700000000
+#define REJOIN_DELAY_SECONDS                        2.0
+#define SIM_NETWORK_START_SPREAD_SECONDS            0.05
+#define SIM_MAX_CLOCK_SYNC_ERROR_PPM                0.5
+
+static const double RADIO_STATE_CURRENT_MA[RADIO_NUM_STATES] = { 0.00025, 7.4, 42.0, 58.0, 58.0 };
+static const char *RADIO_STATE_NAMES[RADIO_NUM_STATES] = { "sleep", "idle", "tx", "listen", "receive" };
+
+
+// Global Simulation State ---------------------------------------------------------------------------------------------
+
+sim_config_t sim_config = { .num_devices = 5, .num_networks = 1, .num_channels = 2, .seconds = 60, .seed = 1, .packet_loss = 0.01, .antenna_loss = 0.0, .room_size_m = 8.0,
+   .radio_range_m = 0.0, .clock_ppm = 10.0, .mcu_ppm = 100.0, .timestamp_noise_ticks = 10.0, .isr_latency_us = 20.0, .moving_seconds = -1.0, .join_delay_s = 0.0, .nlos_probability = 0.0, .colliding_ids = false, .verbose = false };
+sim_device_t sim_devices[SIM_MAX_DEVICES];
+
+
+// Private Helper Functions --------------------------------------------------------------------------------------------
+
+static bool load_protocol_library(sim_device_t *device, const char *library_path)
+{
+   // Load a private copy of the protocol library so that every device gets its own static state
+   char copy_path[] = "/tmp/socitrack_simulation_XXXXXX";
+   FILE *source = fopen(library_path, "rb");
+   const int destination = mkstemp(copy_path);
+   if (!source || (destination < 0))
+   {
+      fprintf(stderr, "ERROR: Unable to copy protocol library %s\n", library_path);
+      return false;
+   }
+   char buffer[65536];
+   for (size_t length; (length = fread(buffer, 1, sizeof(buffer), source)) > 0; )
+      if (write(destination, buffer, length) != (ssize_t)length)
+         break;
+   fclose(source);
+   close(destination);
+   device->library = dlopen(copy_path, RTLD_NOW | RTLD_LOCAL);
+   unlink(copy_path);
+   if (!device->library)
+   {
+      fprintf(stderr, "ERROR: %s\n", dlerror());
+      return false;
+   }
+
+   // Resolve the protocol entry points used by the simulator
+   *(void**)&device->ranging_radio_init = dlsym(device->library, "ranging_radio_init");
+   *(void**)&device->ranging_radio_sleep = dlsym(device->library, "ranging_radio_sleep");
+   *(void**)&device->scheduler_init = dlsym(device->library, "scheduler_init");
+   *(void**)&device->scheduler_run = dlsym(device->library, "scheduler_run");
+   *(void**)&device->scheduler_add_device = dlsym(device->library, "scheduler_add_device");
+   *(void**)&device->scheduler_set_motion_status = dlsym(device->library, "scheduler_set_motion_status");
+   *(void**)&device->scheduler_rtc_isr = dlsym(device->library, "scheduler_rtc_isr");
+   *(void**)&device->am_timer02_isr = dlsym(device->library, "am_timer02_isr");
+   *(void**)&device->schedule_phase_get_clock_offset = dlsym(device->library, "schedule_phase_get_clock_offset");
+   if (!device->ranging_radio_init || !device->ranging_radio_sleep || !device->scheduler_init || !device->scheduler_run || !device->scheduler_add_device ||
+         !device->scheduler_set_motion_status || !device->scheduler_rtc_isr || !device->am_timer02_isr || !device->schedule_phase_get_clock_offset)
+   {
+      fprintf(stderr, "ERROR: Protocol library %s is missing required symbols\n", library_path);
+      return false;
+   }
+   return true;
+}
+
+static sim_device_t* find_master(const sim_device_t *joining_device)
+{
+   // Prefer the master of the initial network of the joining device, otherwise choosing the current master with the highest EUI
+   sim_device_t *master = NULL;
+   for (uint32_t i = 0; i < sim_config.num_devices; ++i)
+      if (sim_devices[i].is_master)
+      {
+         if (sim_devices[i].network == joining_device->network)
+            return &sim_devices[i];
+         else if (!master || (DEVICE_ID(sim_devices[i].uid) > DEVICE_ID(master->uid)))
+            master = &sim_devices[i];
+      }
+   return master;
+}
+
+static uint8_t choose_network_channel(const sim_device_t *new_master)
+{
+   // Form a new network on the channel advertised by the fewest other masters, exactly like the application does
+   static const uint8_t network_channels[] = RADIO_NETWORK_CHANNELS;
+   uint8_t best_channel = network_channels[0];
+   uint32_t best_channel_usage = UINT32_MAX;
+   for (uint32_t i = 0; (i < sim_config.num_channels) && (i < sizeof(network_channels)); ++i)
+   {
+      uint32_t channel_usage = 0;
+      for (uint32_t j = 0; j < sim_config.num_devices; ++j)
+         channel_usage += (&sim_devices[j] != new_master) && sim_devices[j].is_master && (sim_devices[j].network_channel == network_channels[i]);
+      if (channel_usage < best_channel_usage)
+      {
+         best_channel = network_channels[i];
+         best_channel_usage = channel_usage;
+      }
+   }
+   return best_channel;
+}
+
+static void join_task(void *argument)
+{
+   // Emulate the BLE scheduling request handled by the master after the configured discovery delay
+   const sim_device_t *joining_device = (const sim_device_t*)argument;
+   sim_device_t *master = find_master(joining_device);
+   if (sim_config.join_delay_s > 0.0)
+      sim_task_sleep((sim_time_t)(sim_config.join_delay_s * SIM_PS_PER_SECOND));
+   if (master)
+      master->scheduler_add_device(DEVICE_ID(joining_device->uid));
+}
+
+static void motion_task(void *argument)
+{
+   // Emulate IMU motion reports: moving until the configured time and still afterward
+   sim_device_t *device = (sim_device_t*)argument;
+   const sim_time_t still_time = (sim_time_t)(sim_config.moving_seconds * SIM_PS_PER_SECOND);
+   if (sim_now() < still_time)
+   {
+      device->scheduler_set_motion_status(true);
+      sim_task_sleep(still_time - sim_now());
+   }
+   device->scheduler_set_motion_status(false);
+}
+
+static void device_task(void *argument)
+{
+   // Initialize the ranging radio and scheduler exactly like the ranging task does
+   sim_device_t *device = (sim_device_t*)argument;
+   device->ranging_radio_init(device->uid);
+   device->ranging_radio_sleep(true);
+   device->scheduler_init(device->uid);
+   if (sim_config.moving_seconds >= 0.0)
+      sim_task_create(device, "motion", motion_task, device);
+
+   // Repeatedly join the network, rejoining after a simulated BLE rediscovery delay whenever it is lost
+   while (true)
+   {
+      sim_device_t *master = find_master(device);
+      if (!device->is_master && master)
+         sim_task_create(master, "join", join_task, device);
+      const uint8_t channel = device->is_master ? choose_network_channel(device) : master ? master->network_channel : 0;
+      ++device->network_joins;
+      device->scheduler_run(device->is_master ? ROLE_MASTER : ROLE_PARTICIPANT, channel, EPOCH_START_TIMESTAMP + (uint32_t)(sim_now() / SIM_PS_PER_SECOND));
+      device->network_channel = 0;
+      ++device->network_drops;
+      sim_task_sleep((sim_time_t)(REJOIN_DELAY_SECONDS * SIM_PS_PER_SECOND));
+   }
+}
+
+static void start_device(void *context, uint64_t event_id)
+{
+   sim_device_t *device = (sim_device_t*)context;
+   device->task = sim_task_create(device, "ranging", device_task, device);
+}
+
+static void print_usage(const char *program)
+{
+   printf("Usage: %s [options]\n"
+          "   -n, --devices N        number of simulated tags (default %u, max %u)\n"
+          "   -N, --networks K       split the tags into K independently started networks (default %u)\n"
+          "   -C, --channels C       number of radio channels on which new networks may form; 1 forces merging (default %u)\n"
+          "   -t, --seconds S        simulated duration in seconds (default %u)\n"
+          "   -s, --seed N           random seed (default %u)\n"
+          "   -l, --loss P           independent packet loss probability (default %.3f)\n"
+          "   -a, --antenna-loss P   additional loss on one obstructed ranging antenna per device (default %.3f)\n"
+          "   -r, --room M           side length of the square room in meters (default %.1f)\n"
+          "   -R, --range M          maximum distance at which packets can be heard in meters (default: unlimited)\n"
+          "   -p, --ppm P            maximum DW3000 crystal offset in ppm (default %.1f)\n"
+          "   -m, --mcu-ppm P        maximum MCU timer clock offset in ppm (default %.1f)\n"
+          "   -j, --jitter T         RX timestamp noise standard deviation in DW3000 ticks (default %.1f)\n"
+          "   -i, --latency-us T     ISR-to-task notification latency in microseconds (default %.1f)\n"
+          "   -M, --moving S         report motion from every device for S seconds and stillness afterward (default: no reports)\n"
+          "   -J, --join-delay S     BLE discovery delay before a master schedules a joining device in seconds (default %.1f)\n"
+          "   -x, --nlos P           probability that the direct path of each received frame is obstructed (default %.3f)\n"
+          "   -I, --colliding-ids    give pairs of tags IDs which differ only in their high byte\n"
+          "   -L, --library PATH     protocol library to simulate (default ./libranging.so)\n"
+          "   -v, --verbose          print all firmware log messages\n",
+          program, sim_config.num_devices, SIM_MAX_DEVICES, sim_config.num_networks, sim_config.num_channels, sim_config.seconds, sim_config.seed, sim_config.packet_loss, sim_config.antenna_loss,
+          sim_config.room_size_m, sim_config.clock_ppm, sim_config.mcu_ppm, sim_config.timestamp_noise_ticks, sim_config.isr_latency_us, sim_config.join_delay_s, sim_config.nlos_probability);
+}
+
+static void print_report(void)
+{
+   // Print the simulation parameters and the per-phase timing statistics
+   const uint32_t num_devices = sim_config.num_devices, seconds = sim_config.seconds;
+   const uint32_t scheduled_devices = (num_devices < MAX_NUM_RANGING_DEVICES) ? num_devices : MAX_NUM_RANGING_DEVICES;
+   printf("SociTrack ranging simulation: %u devices, %u s, seed %u, loss %.3f, room %.1f m, %.1f ppm\n\n",
+         num_devices, seconds, sim_config.seed, sim_config.packet_loss, sim_config.room_size_m, sim_config.clock_ppm);
+   sim_air_report_rounds(stdout);
+
+   // Print the airtime used by each protocol phase
+   const char *air_names[AIR_NUM_TYPES] = { "schedule", "ranging", "status", "other" };
+   sim_time_t total_airtime = 0;
+   printf("\nAirtime per second:\n");
+   for (int type = 0; type < AIR_NUM_TYPES; ++type)
+   {
+      total_airtime += sim_air_time((sim_air_type_t)type);
+      printf("   %-9s %9.1f us   %8.1f frames\n", air_names[type], SIM_TO_US(sim_air_time((sim_air_type_t)type)) / seconds,
+            (double)sim_air_frame_count((sim_air_type_t)type) / seconds);
+   }
+   printf("   utilization %.2f%%\n", 100.0 * (double)total_airtime / ((double)seconds * SIM_PS_PER_SECOND));
+
+   // Print the radio activity and ranging statistics of every device
+   uint64_t total_ranges = 0;
+   uint32_t total_drops = 0;
+   double total_listen_ms = 0.0, total_current_ma = 0.0;
+   printf("\nPer-device radio activity (ms per second) and ranging results:\n");
+   printf("   dev    %8s %8s %8s %8s %8s  est.mA   sent   recv  rxto  err  late  drop  ranges/s  err.mean  err.rms   err.max\n",
+         RADIO_STATE_NAMES[0], RADIO_STATE_NAMES[1], RADIO_STATE_NAMES[2], RADIO_STATE_NAMES[3], RADIO_STATE_NAMES[4]);
+   for (uint32_t i = 0; i < num_devices; ++i)
+   {
+      sim_device_t *device = &sim_devices[i];
+      sim_radio_t *radio = &device->radio;
+      sim_radio_finalize(device);
+      double current_ma = 0.0, total_ps = 0.0;
+      for (int state = 0; state < RADIO_NUM_STATES; ++state)
+         total_ps += (double)radio->state_time[state];
+      for (int state = 0; state < RADIO_NUM_STATES; ++state)
+         current_ma += RADIO_STATE_CURRENT_MA[state] * (double)radio->state_time[state] / total_ps;
+      const double mean_error = device->ranges_reported ? (device->range_error_sum / device->ranges_reported) : 0.0;
+      const double rms_error = device->ranges_reported ? sqrt(device->range_error_squared_sum / device->ranges_reported) : 0.0;
+      printf("   %04X%s %8.2f %8.2f %8.2f %8.2f %8.2f %7.2f %6u %6u %5u %4u %5u %5u %9.2f %9.1f %8.1f %9.1f\n",
+            (uint32_t)DEVICE_ID(device->uid), device->is_master ? "*" : " ",
+            SIM_TO_US(radio->state_time[RADIO_SLEEP]) / 1000.0 / seconds, SIM_TO_US(radio->state_time[RADIO_IDLE]) / 1000.0 / seconds,
+            SIM_TO_US(radio->state_time[RADIO_TX]) / 1000.0 / seconds, SIM_TO_US(radio->state_time[RADIO_LISTEN]) / 1000.0 / seconds,
+            SIM_TO_US(radio->state_time[RADIO_RECEIVE]) / 1000.0 / seconds, current_ma, radio->frames_sent, radio->frames_received,
+            radio->rx_timeouts, radio->rx_errors, radio->late_tx + radio->late_rx, device->network_drops,
+            (double)device->ranges_reported / seconds, mean_error, rms_error, device->range_error_max);
+      total_ranges += device->ranges_reported;
+      total_drops += device->network_drops;
+      total_listen_ms += SIM_TO_US(radio->state_time[RADIO_LISTEN]) / 1000.0 / seconds;
+      total_current_ma += current_ma;
+   }
+
+   // Determine the longest interval between successive ranges for every ordered device pair
+   const sim_time_t end_time = (sim_time_t)seconds * SIM_PS_PER_SECOND;
+   double max_pair_period_s = 0.0;
+   uint32_t unranged_pairs = 0;
+   for (uint32_t i = 0; i < scheduled_devices; ++i)
+      for (uint32_t j = 0; j < scheduled_devices; ++j)
+         if (i != j)
+         {
+            const sim_device_t *device = &sim_devices[i];
+            if (!device->last_range_time[j])
+               ++unranged_pairs;
+            else
+            {
+               const sim_time_t period = (end_time - device->last_range_time[j]) > device->max_range_period[j] ?
+                     (end_time - device->last_range_time[j]) : device->max_range_period[j];
+               max_pair_period_s = fmax(max_pair_period_s, (double)period / SIM_PS_PER_SECOND);
+            }
+         }
+
+   // Print a single-line summary suitable for automated comparisons
+   printf("\nRanges per second: %.2f (ideal %u with %u scheduled devices)\n", (double)total_ranges / seconds,
+         scheduled_devices * (scheduled_devices - 1), scheduled_devices);
+   printf("Longest per-pair range period: %.2f s (%u device pairs never ranged)\n", max_pair_period_s, unranged_pairs);
+
+   // Report how much RX payload SPI time remains inside the radio interrupt, modeled on the 24 MHz SPI bus
+   uint64_t isr_rx_bytes = 0, dma_rx_bytes = 0, frames_received = 0;
+   for (uint32_t i = 0; i < num_devices; ++i)
+   {
+      isr_rx_bytes += sim_devices[i].spi_isr_rx_bytes;
+      dma_rx_bytes += sim_devices[i].spi_dma_rx_bytes;
+      frames_received += sim_devices[i].radio.frames_received;
+   }
+   if (frames_received)
+      printf("RX payload SPI time per received packet: %.2f us in radio ISR, %.2f us by DMA (%.2f us in ISR if read blocking)\n",
+            (double)(8 * isr_rx_bytes) / 24.0 / frames_received, (double)(8 * dma_rx_bytes) / 24.0 / frames_received,
+            (double)(8 * (isr_rx_bytes + dma_rx_bytes)) / 24.0 / frames_received);
+   if (sim_config.num_networks == 1)
+   {
+      // Report how closely participants follow the master's clock, counting how many of them only hear it through relays
+      uint32_t hops[SIM_MAX_DEVICES] = { 0 }, multi_hop_devices = 0, synchronized_reports = 0, unsynchronized_reports = 0;
+      double clock_sync_error_max = 0.0;
+      for (uint32_t hop = 1, added = 1; added; ++hop)
+      {
+         added = 0;
+         for (uint32_t i = 1; i < num_devices; ++i)
+            for (uint32_t j = 0; !hops[i] && (j < num_devices); ++j)
+               if (((j == 0) || (hops[j] && (hops[j] < hop))) && ((sim_config.radio_range_m <= 0.0) || (sim_distance_m(&sim_devices[i], &sim_devices[j]) <= sim_config.radio_range_m)))
+               {
+                  hops[i] = hop;
+                  multi_hop_devices += (hop > 1);
+                  ++added;
+               }
+      }
+      for (uint32_t i = 1; i < num_devices; ++i)
+      {
+         synchronized_reports += sim_devices[i].clock_sync_reports;
+         unsynchronized_reports += sim_devices[i].clock_unsynchronized_reports;
+         clock_sync_error_max = fmax(clock_sync_error_max, sim_devices[i].clock_sync_error_max);
+      }
+      printf("Master clock offset error: max %.3f ppm over %u reports, %u reports on the local clock (%u devices beyond one hop)\n",
+            clock_sync_error_max, synchronized_reports, unsynchronized_reports, multi_hop_devices);
+   }
+   else
+   {
+      uint32_t num_masters = 0;
+      for (uint32_t i = 0; i < num_devices; ++i)
+         num_masters += sim_devices[i].is_master;
+      printf("Networks remaining after merging %u initial networks: %u\n", sim_config.num_networks, num_masters);
+   }
+   printf("RESULT devices=%u ranges_per_s=%.2f ideal_ranges_per_s=%u max_pair_period_s=%.2f unranged_pairs=%u idle_listen_ms_per_s=%.2f radio_current_ma=%.3f network_drops=%u\n",
+         num_devices, (double)total_ranges / seconds, scheduled_devices * (scheduled_devices - 1), max_pair_period_s,
+         unranged_pairs, total_listen_ms / num_devices, total_current_ma / num_devices, total_drops);
+}
+
+
+// Main Simulation Entry Point -----------------------------------------------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+   // Parse all command-line options
+   const char *library_path = "./libranging.so";
+   static const struct option options[] = {
+      { "devices", required_argument, NULL, 'n' }, { "networks", required_argument, NULL, 'N' }, { "channels", required_argument, NULL, 'C' }, { "seconds", required_argument, NULL, 't' },
+      { "seed", required_argument, NULL, 's' }, { "loss", required_argument, NULL, 'l' },
+      { "antenna-loss", required_argument, NULL, 'a' }, { "room", required_argument, NULL, 'r' }, { "range", required_argument, NULL, 'R' },
+      { "ppm", required_argument, NULL, 'p' }, { "mcu-ppm", required_argument, NULL, 'm' },
+      { "jitter", required_argument, NULL, 'j' }, { "latency-us", required_argument, NULL, 'i' },
+      { "moving", required_argument, NULL, 'M' }, { "join-delay", required_argument, NULL, 'J' }, { "nlos", required_argument, NULL, 'x' }, { "colliding-ids", no_argument, NULL, 'I' }, { "library", required_argument, NULL, 'L' },
+      { "verbose", no_argument, NULL, 'v' }, { "help", no_argument, NULL, 'h' }, { NULL, 0, NULL, 0 } };
+   for (int option; (option = getopt_long(argc, argv, "n:N:C:t:s:l:a:r:R:p:m:j:i:M:J:x:IL:vh", options, NULL)) != -1; )
+      switch (option)
+      {
+         case 'n': sim_config.num_devices = (uint32_t)strtoul(optarg, NULL, 0); break;
+         case 'N': sim_config.num_networks = (uint32_t)strtoul(optarg, NULL, 0); break;
+         case 'C': sim_config.num_channels = (uint32_t)strtoul(optarg, NULL, 0); break;
+         case 't': sim_config.seconds = (uint32_t)strtoul(optarg, NULL, 0); break;
+         case 's': sim_config.seed = (uint32_t)strtoul(optarg, NULL, 0); break;
+         case 'l': sim_config.packet_loss = strtod(optarg, NULL); break;
+         case 'a': sim_config.antenna_loss = strtod(optarg, NULL); break;
+         case 'r': sim_config.room_size_m = strtod(optarg, NULL); break;
+         case 'R': sim_config.radio_range_m = strtod(optarg, NULL); break;
+         case 'p': sim_config.clock_ppm = strtod(optarg, NULL); break;
+         case 'm': sim_config.mcu_ppm = strtod(optarg, NULL); break;
+         case 'j': sim_config.timestamp_noise_ticks = strtod(optarg, NULL); break;
+         case 'i': sim_config.isr_latency_us = strtod(optarg, NULL); break;
+         case 'M': sim_config.moving_seconds = strtod(optarg, NULL); break;
+         case 'J': sim_config.join_delay_s = strtod(optarg, NULL); break;
+         case 'x': sim_config.nlos_probability = strtod(optarg, NULL); break;
+         case 'I': sim_config.colliding_ids = true; break;
+         case 'L': library_path = optarg; break;
+         case 'v': sim_config.verbose = true; break;
+         default: print_usage(argv[0]); return (option == 'h') ? 0 : 1;
+      }
+   if ((sim_config.num_devices < 1) || (sim_config.num_devices > SIM_MAX_DEVICES) || !sim_config.seconds ||
+         !sim_config.num_networks || (sim_config.num_networks > sim_config.num_devices) || !sim_config.num_channels)
+   {
+      print_usage(argv[0]);
+      return 1;
+   }
+
+   // Create all simulated devices with random positions and clock offsets
+   sim_random_seed(sim_config.seed);
+   for (uint32_t i = 0; i < sim_config.num_devices; ++i)
+   {
+      sim_device_t *device = &sim_devices[i];
+      device->index = i;
+      device->network = (i * sim_config.num_networks) / sim_config.num_devices;
+      device->is_master = !i || (device->network != sim_devices[i-1].network);
+      device->uid[0] = (uint8_t)(sim_config.colliding_ids ? ((i / 2) + 1) : (i + 1));
+      device->uid[1] = (uint8_t)(sim_config.colliding_ids ? (0x42 + (i % 2)) : 0x42); device->uid[2] = 0x19; device->uid[3] = 0xC0; device->uid[4] = 0x98; device->uid[5] = 0xE5;
+      device->x = sim_config.room_size_m * sim_random_uniform();
+      device->y = sim_config.room_size_m * sim_random_uniform();
+      device->clock_ppm = sim_config.clock_ppm * ((2.0 * sim_random_uniform()) - 1.0);
+      device->mcu_ppm = sim_config.mcu_ppm * ((2.0 * sim_random_uniform()) - 1.0);
+      device->clock_offset_s = 17.0 * sim_random_uniform();
+      device->obstructed_antenna = (sim_config.antenna_loss > 0.0) ? (uint8_t)((SCHEDULE_XMIT_ANTENNA + 1 + (uint8_t)((NUM_ANTENNAS - 1) * sim_random_uniform())) % NUM_ANTENNAS) : 0xFF;
+      device->radio.state = RADIO_SLEEP;
+      if (!load_protocol_library(device, library_path))
+         return 1;
+
+      // Start the first master immediately, any other masters shortly afterward so that their rounds overlap, and all
+      //   other devices at random times within the first second
+      const double start_time_s = !i ? 0.0 : device->is_master ? (SIM_NETWORK_START_SPREAD_SECONDS * sim_random_uniform()) : (0.1 + (0.9 * sim_random_uniform()));
+      sim_schedule_event((sim_time_t)(start_time_s * SIM_PS_PER_SECOND), start_device, device);
+   }
+
+   // Run the simulation and print the results
+   sim_run_until((sim_time_t)sim_config.seconds * SIM_PS_PER_SECOND);
+   print_report();
+   uint64_t total_ranges = 0;
+   double clock_sync_error_max = 0.0;
+   for (uint32_t i = 0; i < sim_config.num_devices; ++i)
+   {
+      total_ranges += sim_devices[i].ranges_reported;
+      clock_sync_error_max = fmax(clock_sync_error_max, sim_devices[i].clock_sync_error_max);
+   }
+   if (clock_sync_error_max > SIM_MAX_CLOCK_SYNC_ERROR_PPM)
+      return 3;
+   return ((sim_config.num_devices > 1) && !total_ranges) ? 2 : 0;
+}
@@ -0,0 +1,354 @@
+// Header Inclusions ---------------------------------------------------------------------------------------------------
+
+#include <math.h>
+#include <stdarg.h>
+#include "ranging.h"
+#include "simulator.h"
+
+
+// Static Global Variables ---------------------------------------------------------------------------------------------
+
+const am_hal_gpio_pincfg_t am_hal_gpio_pincfg_output, am_hal_gpio_pincfg_tristate;
+const am_hal_gpio_pincfg_t g_AM_BSP_GPIO_IOM0_SCK, g_AM_BSP_GPIO_IOM0_MISO, g_AM_BSP_GPIO_IOM0_MOSI, g_AM_BSP_GPIO_IOM0_CS;
+
+
+// Private Helper Functions --------------------------------------------------------------------------------------------
+
+static sim_time_t mcu_duration(const sim_device_t *device, double seconds)
+{
+   // Convert a duration measured by the MCU clock into global simulation time
+   return (sim_time_t)llround(seconds * (double)SIM_PS_PER_SECOND / (1.0 + (device->mcu_ppm * 1.0e-6)));
+}
+
+static void rtc_alarm_handler(void *context, uint64_t event_id);
+
+static void schedule_rtc_alarm(sim_device_t *device)
+{
+   // Schedule the next alarm on a repeat boundary of the free-running RTC
+   const sim_time_t next_alarm = device->rtc_origin + ((((sim_now() - device->rtc_origin) / device->rtc_period) + 1) * device->rtc_period);
+   device->rtc_event = sim_schedule_event(next_alarm, rtc_alarm_handler, device);
+}
+
+static void rtc_alarm_handler(void *context, uint64_t event_id)
+{
+   // Re-arm the repeating alarm and invoke the scheduler RTC interrupt
+   sim_device_t *device = (sim_device_t*)context;
+   if (device->rtc_event != event_id)
+      return;
+   schedule_rtc_alarm(device);
+   if (device->rtc_interrupt_enabled)
+      sim_run_isr(device, device->scheduler_rtc_isr);
+}
+
+static void wakeup_timer_handler(void *context, uint64_t event_id)
+{
+   // Invoke the radio wakeup timer interrupt
+   sim_device_t *device = (sim_device_t*)context;
+   if ((device->timer_event != event_id) || !device->timer_interrupt_enabled)
+      return;
+   device->timer_event = 0;
+   sim_run_isr(device, device->am_timer02_isr);
+}
+
+
+// Simulated Platform API ----------------------------------------------------------------------------------------------
+
+double sim_distance_m(const sim_device_t *a, const sim_device_t *b)
+{
+   return hypot(a->x - b->x, a->y - b->y);
+}
+
+
+// Ambiq Utility and System Functions ----------------------------------------------------------------------------------
+
+uint32_t am_util_stdio_printf(const char *format, ...)
+{
+   // Prefix every log message with the simulation time and the active device
+   if (!sim_config.verbose)
+      return 0;
+   va_list arguments;
+   va_start(arguments, format);
+   printf("[%12.3f ms] [0x%04X] ", SIM_TO_US(sim_now()) / 1000.0, sim_current_device ? (uint32_t)DEVICE_ID(sim_current_device->uid) : 0);
+   const int length = vprintf(format, arguments);
+   va_end(arguments);
+   return (length < 0) ? 0 : (uint32_t)length;
+}
+
+void vAssertCalled(const char *file, uint32_t line)
+{
+   fprintf(stderr, "ASSERTION FAILED: %s:%u\n", file, line);
+   abort();
+}
+
+void NVIC_SetPriority(int irq, uint32_t priority) {}
+void NVIC_EnableIRQ(int irq) {}
+void NVIC_DisableIRQ(int irq) {}
+uint32_t am_hal_interrupt_master_disable(void) { return 0; }
+void am_hal_interrupt_master_set(uint32_t interrupt_mask) {}
+uint32_t __get_PRIMASK(void) { return 0; }
+
+
+// GPIO Functions ------------------------------------------------------------------------------------------------------
+
+uint32_t am_hal_gpio_pinconfig(uint32_t pin, am_hal_gpio_pincfg_t config) { return AM_HAL_STATUS_SUCCESS; }
+uint32_t am_hal_gpio_interrupt_control(uint32_t channel, uint32_t control, void *pin) { return AM_HAL_STATUS_SUCCESS; }
+void am_hal_gpio_output_tristate_enable(uint32_t pin) {}
+void am_hal_gpio_output_tristate_disable(uint32_t pin) {}
+
+uint32_t am_hal_gpio_state_read(uint32_t pin, uint32_t read_type, uint32_t *state)
+{
+   *state = (pin == PIN_RADIO_INTERRUPT) ? sim_radio_interrupt_pending(sim_current_device) : 0;
+   return AM_HAL_STATUS_SUCCESS;
+}
+
+uint32_t am_hal_gpio_interrupt_register(uint32_t channel, uint32_t pin, am_hal_gpio_handler_t handler, void *args)
+{
+   if (pin == PIN_RADIO_INTERRUPT)
+   {
+      sim_current_device->radio_isr = handler;
+      sim_current_device->radio_isr_args = args;
+   }
+   return AM_HAL_STATUS_SUCCESS;
+}
+
+static void set_antenna_select_pin(uint32_t pin, bool asserted)
+{
+   // Decode the antenna selected by the RF switch on boards which contain one
+#ifdef PIN_RADIO_ANTENNA_SELECT1
+   sim_device_t *device = sim_current_device;
+   const uint8_t pin_mask = (pin == PIN_RADIO_ANTENNA_SELECT1) ? 0x01 : (pin == PIN_RADIO_ANTENNA_SELECT2) ? 0x02 : 0x00;
+   device->antenna_select_pins = asserted ? (device->antenna_select_pins | pin_mask) : (device->antenna_select_pins & ~pin_mask);
+   device->radio.antenna = (device->antenna_select_pins == 0x02) ? 0 : (device->antenna_select_pins == 0x01) ? 1 : 2;
+#endif
+}
+
+void am_hal_gpio_output_set(uint32_t pin)
+{
+   if (pin == PIN_RADIO_WAKEUP)
+      sim_radio_set_wakeup_pin(sim_current_device, true);
+   else
+      set_antenna_select_pin(pin, true);
+}
+
+void am_hal_gpio_output_clear(uint32_t pin)
+{
+   if (pin == PIN_RADIO_WAKEUP)
+      sim_radio_set_wakeup_pin(sim_current_device, false);
+   else
+      set_antenna_select_pin(pin, false);
+}
+
+
+// IOM (SPI) Functions -------------------------------------------------------------------------------------------------
+
+uint32_t am_hal_iom_initialize(uint32_t module, void **handle) { *handle = sim_current_device; return AM_HAL_STATUS_SUCCESS; }
+uint32_t am_hal_iom_uninitialize(void *handle) { return AM_HAL_STATUS_SUCCESS; }
+uint32_t am_hal_iom_power_ctrl(void *handle, uint32_t state, bool retain_state) { return AM_HAL_STATUS_SUCCESS; }
+uint32_t am_hal_iom_configure(void *handle, const am_hal_iom_config_t *config) { return AM_HAL_STATUS_SUCCESS; }
+uint32_t am_hal_iom_enable(void *handle) { return AM_HAL_STATUS_SUCCESS; }
+uint32_t am_hal_iom_disable(void *handle) { return AM_HAL_STATUS_SUCCESS; }
+
+uint32_t am_hal_iom_blocking_transfer(void *handle, am_hal_iom_transfer_t *transaction)
+{
+   // Only raw register reads bypass the simulated DW3000 driver API
+   if (transaction->eDirection == AM_HAL_IOM_RX)
+      sim_radio_spi_read((sim_device_t*)handle, transaction->ui64Instr, (uint8_t*)transaction->pui32RxBuffer, transaction->ui32NumBytes);
+   return AM_HAL_STATUS_SUCCESS;
+}
+
+uint32_t am_hal_iom_interrupt_enable(void *handle, uint32_t interrupt_mask) { return AM_HAL_STATUS_SUCCESS; }
+uint32_t am_hal_iom_interrupt_clear(void *handle, uint32_t interrupt_mask) { return AM_HAL_STATUS_SUCCESS; }
+
+static void complete_spi_transfer(sim_device_t *device)
+{
+   // Deliver the data of DMA reads from the DW3000 RX buffer, which are the only non-blocking transfers issued
+   const am_hal_iom_callback_t callback = device->spi_callback;
+   if (device->spi_transfer.eDirection == AM_HAL_IOM_RX)
+      dwt_readrxdata((uint8_t*)device->spi_transfer.pui32RxBuffer, (uint16_t)device->spi_transfer.ui32NumBytes, 0);
+   device->spi_event = 0;
+   device->spi_callback = NULL;
+   if (callback)
+      callback(device->spi_callback_context, AM_HAL_STATUS_SUCCESS);
+}
+
+static void spi_transfer_handler(void *context, uint64_t event_id)
+{
+   // Complete the transfer from the IOM interrupt unless it was already completed by polling
+   sim_device_t *device = (sim_device_t*)context;
+   if (device->spi_event != event_id)
+      return;
+   sim_device_t *interrupted_device = sim_current_device;
+   sim_task_t *interrupted_task = sim_current_task;
+   sim_current_device = device;
+   sim_current_task = NULL;
+   complete_spi_transfer(device);
+   sim_current_device = interrupted_device;
+   sim_current_task = interrupted_task;
+}
+
+uint32_t am_hal_iom_nonblocking_transfer(void *handle, am_hal_iom_transfer_t *transaction, am_hal_iom_callback_t callback, void *callback_context)
+{
+   // Model the transfer duration on the 24 MHz radio SPI bus
+   sim_device_t *device = (sim_device_t*)handle;
+   device->spi_transfer = *transaction;
+   device->spi_callback = callback;
+   device->spi_callback_context = callback_context;
+   if (transaction->eDirection == AM_HAL_IOM_RX)
+      device->spi_dma_rx_bytes += transaction->ui32NumBytes;
+   const double duration_us = (double)(8 * (transaction->ui32InstrLen + transaction->ui32NumBytes)) / (AM_HAL_IOM_24MHZ / 1.0e6);
+   device->spi_event = sim_schedule_event(sim_now() + SIM_US(duration_us), spi_transfer_handler, device);
+   return AM_HAL_STATUS_SUCCESS;
+}
+
+uint32_t am_hal_iom_interrupt_status_get(void *handle, bool enabled_only, uint32_t *interrupt_status)
+{
+   *interrupt_status = ((sim_device_t*)handle)->spi_event ? AM_HAL_IOM_INT_CMDCMP : 0;
+   return AM_HAL_STATUS_SUCCESS;
+}
+
+uint32_t am_hal_iom_interrupt_service(void *handle, uint32_t interrupt_mask)
+{
+   // Polling finishes a pending transfer immediately
+   sim_device_t *device = (sim_device_t*)handle;
+   if (device->spi_event)
+      complete_spi_transfer(device);
+   return AM_HAL_STATUS_SUCCESS;
+}
+
+
+// Timer Functions -----------------------------------------------------------------------------------------------------
+
+uint32_t am_hal_timer_default_config_set(am_hal_timer_config_t *config)
+{
+   config->eFunction = AM_HAL_TIMER_FN_EDGE;
+   config->ui32Compare0 = config->ui32Compare1 = 0xFFFFFFFF;
+   return AM_HAL_STATUS_SUCCESS;
+}
+
+uint32_t am_hal_timer_config(uint32_t timer_number, am_hal_timer_config_t *config)
+{
+   sim_current_device->timer_compare0 = config->ui32Compare0;
+   return AM_HAL_STATUS_SUCCESS;
+}
+
+uint32_t am_hal_timer_clear(uint32_t timer_number)
+{
+   // Restart the timer counter and schedule its next compare interrupt
+   sim_device_t *device = sim_current_device;
+   device->timer_start = sim_now();
+   device->timer_event = sim_schedule_event(sim_now() + mcu_duration(device, (double)device->timer_compare0 / (double)RADIO_WAKEUP_TIMER_TICK_RATE_HZ), wakeup_timer_handler, device);
+   return AM_HAL_STATUS_SUCCESS;
+}
+
+uint32_t am_hal_timer_read(uint32_t timer_number)
+{
+   // Return the number of MCU timer ticks elapsed since the counter was last cleared
+   const sim_device_t *device = sim_current_device;
+   return (uint32_t)((double)(sim_now() - device->timer_start) * 1.0e-12 * (1.0 + (device->mcu_ppm * 1.0e-6)) * (double)RADIO_WAKEUP_TIMER_TICK_RATE_HZ);
+}
+
+uint32_t am_hal_timer_interrupt_enable(uint32_t interrupt_mask)
+{
+   sim_current_device->timer_interrupt_enabled = true;
+   return AM_HAL_STATUS_SUCCESS;
+}
+
+uint32_t am_hal_timer_interrupt_disable(uint32_t interrupt_mask)
+{
+   sim_current_device->timer_interrupt_enabled = false;
+   return AM_HAL_STATUS_SUCCESS;
+}
+
+uint32_t am_hal_timer_interrupt_clear(uint32_t interrupt_mask) { return AM_HAL_STATUS_SUCCESS; }
+
+
+// RTC Functions -------------------------------------------------------------------------------------------------------
+
+uint32_t am_hal_rtc_alarm_set(am_hal_rtc_time_t *time, am_hal_rtc_alarm_repeat_e repeat_interval)
+{
+   // Only the once-per-second and tenth-second repeating alarms are used by the ranging scheduler, where the
+   //   RTC phase is fixed the first time an alarm is set
+   sim_device_t *device = sim_current_device;
+   device->rtc_event = 0;
+   if ((repeat_interval == AM_HAL_RTC_ALM_RPT_SEC) || (repeat_interval == AM_HAL_RTC_ALM_RPT_10TH))
+   {
+      if (!device->rtc_period)
+         device->rtc_origin = sim_now();
+      device->rtc_period = mcu_duration(device, 1.0) / ((repeat_interval == AM_HAL_RTC_ALM_RPT_SEC) ? 1 : 10);
+      schedule_rtc_alarm(device);
+   }
+   return AM_HAL_STATUS_SUCCESS;
+}
+
+uint32_t am_hal_rtc_interrupt_enable(uint32_t interrupt_mask)
+{
+   sim_current_device->rtc_interrupt_enabled = true;
+   return AM_HAL_STATUS_SUCCESS;
+}
+
+uint32_t am_hal_rtc_interrupt_disable(uint32_t interrupt_mask)
+{
+   sim_current_device->rtc_interrupt_enabled = false;
+   return AM_HAL_STATUS_SUCCESS;
+}
+
+
+// Application Data Sinks ----------------------------------------------------------------------------------------------
+
+void bluetooth_write_range_results(const uint8_t *results, uint16_t results_length) {}
+
+void bluetooth_write_telemetry(const uint8_t *telemetry, uint16_t telemetry_length) {}
+
+void storage_write_telemetry(uint32_t timestamp, const uint8_t *telemetry_data, uint32_t telemetry_data_len) {}
+
+void bluetooth_set_current_ranging_role(uint8_t ranging_role)
+{
+   // Track role changes caused by network merges so that rejoining devices target a current master
+   sim_current_device->is_master = (ranging_role == ROLE_MASTER);
+}
+
+void bluetooth_set_current_ranging_channel(uint8_t ranging_channel)
+{
+   // Track the advertised network channel so that joining devices can tune directly to it
+   sim_current_device->network_channel = ranging_channel;
+}
+
+void storage_write_ranging_data(uint32_t timestamp, uint16_t timestamp_ms, const uint8_t *ranging_data, uint32_t ranging_data_len)
+{
+   // Compare the clock offset used by every participant of a single network against its true offset from the master,
+   //   which flooded schedules may leave unsynchronized beyond the first hop
+   sim_device_t *device = sim_current_device;
+   const int16_t clock_offset = device->schedule_phase_get_clock_offset();
+   if ((sim_config.num_networks == 1) && !device->is_master)
+   {
+      if (SCHEDULE_FLOOD && !clock_offset)
+         ++device->clock_unsynchronized_reports;
+      else
+      {
+         ++device->clock_sync_reports;
+         device->clock_sync_error_max = fmax(device->clock_sync_error_max, fabs(((double)clock_offset / 16.0) - (device->clock_ppm - sim_devices[0].clock_ppm)));
+      }
+   }
+
+   // Compare every reported range against the true simulated distance
+   ++device->range_reports;
+   for (uint32_t i = 0; i < ranging_data[0]; ++i)
+   {
+      const uint8_t *datum = ranging_data + 1 + (i * COMPRESSED_RANGE_DATUM_LENGTH);
+      int16_t range_mm;
+      memcpy(&range_mm, datum + sizeof(uint16_t), sizeof(range_mm));
+      for (uint32_t j = 0; j < sim_config.num_devices; ++j)
+         if (DEVICE_ID(sim_devices[j].uid) == DEVICE_ID(datum))
+         {
+            const double error_mm = (double)range_mm - (1000.0 * sim_distance_m(device, &sim_devices[j]));
+            device->range_error_sum += error_mm;
+            device->range_error_squared_sum += error_mm * error_mm;
+            device->range_error_max = fmax(device->range_error_max, fabs(error_mm));
+            if (device->last_range_time[j] && ((sim_now() - device->last_range_time[j]) > device->max_range_period[j]))
+               device->max_range_period[j] = sim_now() - device->last_range_time[j];
+            device->last_range_time[j] = sim_now();
+            ++device->ranges_reported;
+            break;
+         }
+   }
+}
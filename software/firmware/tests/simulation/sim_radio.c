@@ -0,0 +1,787 @@
+// Header Inclusions ---------------------------------------------------------------------------------------------------
+
+#include <math.h>
+#include "ranging.h"
+#include "scheduler.h"
+#include "simulator.h"
+
+
+// Radio Model Definitions ---------------------------------------------------------------------------------------------
+
+#define PREAMBLE_SYMBOL_PS                          1017630LL
+#define DATA_BIT_PS                                 128210LL
+#define PREAMBLE_AND_SFD_PS                         ((128 + 8) * PREAMBLE_SYMBOL_PS)
+#define PREAMBLE_ACQUISITION_PS                     (16 * PREAMBLE_SYMBOL_PS)
+#define TX_STARTUP_PS                               (2 * SIM_PS_PER_US)
+#define DELAYED_RX_MIN_LEAD_PS                      (2 * SIM_PS_PER_US)
+#define RADIO_WAKEUP_LATENCY_PS                     (400 * SIM_PS_PER_US)
+#define HALF_TIMESTAMP_PERIOD                       (1ULL << 39)
+#define PHYSICAL_TX_ANTENNA_DELAY_TICKS             RADIO_DEFAULT_TX_ANTENNA_DELAY
+#define PHYSICAL_RX_ANTENNA_DELAY_TICKS             RADIO_DEFAULT_RX_ANTENNA_DELAY
+#define RX_TIMEOUT_UNIT_PS                          ((sim_time_t)(512.0e6 / 499.2))
+#define CONCURRENT_TX_WINDOW_PS                     (PREAMBLE_SYMBOL_PS / 2)
+#define SNIFF_PAC_PS                                (8 * PREAMBLE_SYMBOL_PS)
+#define SNIFF_OFF_UNIT_PS                           (128 * SIM_PS_PER_US / 125)
+
+#define DWT_INT_RX_ERRORS                           (DWT_INT_RXPHE_BIT_MASK | DWT_INT_RXFCE_BIT_MASK | DWT_INT_RXFSL_BIT_MASK | DWT_INT_RXSTO_BIT_MASK | DWT_INT_ARFE_BIT_MASK)
+#define DWT_INT_RX_TIMEOUTS                         (DWT_INT_RXFTO_BIT_MASK | DWT_INT_RXPTO_BIT_MASK)
+
+typedef struct { sim_time_t start, end; uint8_t type, seq_num; uint16_t sender; } sim_air_record_t;
+
+
+// Static Global Variables ---------------------------------------------------------------------------------------------
+
+static sim_frame_t *frames_in_air;
+static sim_air_record_t *air_log;
+static size_t air_log_length, air_log_capacity;
+
+
+// Private Helper Functions --------------------------------------------------------------------------------------------
+
+static sim_radio_t* current_radio(void)
+{
+   return &sim_current_device->radio;
+}
+
+static uint64_t local_time(const sim_device_t *device, sim_time_t global_time)
+{
+   // Convert a global simulation time into the 40-bit DW3000 system time of the device
+   const double seconds = ((double)global_time * 1.0e-12 * (1.0 + (device->clock_ppm * 1.0e-6))) + device->clock_offset_s;
+   return ((uint64_t)floor(seconds / DWT_TIME_UNITS)) & SIM_DW_TIMESTAMP_MASK;
+}
+
+static sim_time_t global_duration(const sim_device_t *device, uint64_t local_ticks)
+{
+   // Convert a duration in local DW3000 ticks into global simulation time
+   return (sim_time_t)llround((double)local_ticks * DWT_TIME_UNITS * 1.0e12 / (1.0 + (device->clock_ppm * 1.0e-6)));
+}
+
+static sim_air_type_t air_type_of(uint8_t message_type)
+{
+   switch (message_type)
+   {
+      case SCHEDULE_PACKET:
+         return AIR_SCHEDULE;
+      case RANGING_PACKET:
+      case RANGING_BROADCAST_PACKET:
+         return AIR_RANGING;
+      case STATUS_SUCCESS_PACKET:
+         return AIR_STATUS;
+      default:
+         return AIR_OTHER;
+   }
+}
+
+static void set_state(sim_device_t *device, sim_radio_state_t state)
+{
+   // Account for the time spent in the previous radio state, with a sniffing receiver only powered during its on-times
+   sim_radio_t *radio = &device->radio;
+   const sim_time_t elapsed = sim_now() - radio->state_since;
+   if ((radio->state == RADIO_LISTEN) && radio->sniff_on_ps)
+   {
+      const sim_time_t on_time = (sim_time_t)((double)elapsed * (double)radio->sniff_on_ps / (double)(radio->sniff_on_ps + radio->sniff_off_ps));
+      radio->state_time[RADIO_LISTEN] += on_time;
+      radio->state_time[RADIO_IDLE] += elapsed - on_time;
+   }
+   else
+      radio->state_time[radio->state] += elapsed;
+   radio->state_since = sim_now();
+   radio->state = state;
+}
+
+static void radio_isr_trampoline(void *context, uint64_t event_id)
+{
+   // Invoke the registered GPIO interrupt handler for the radio
+   sim_device_t *device = (sim_device_t*)context;
+   sim_device_t *interrupted_device = sim_current_device;
+   sim_task_t *interrupted_task = sim_current_task;
+   sim_current_device = device;
+   sim_current_task = NULL;
+   while (device->radio_isr && device->radio.irq_count)
+      device->radio_isr(device->radio_isr_args);
+   sim_current_device = interrupted_device;
+   sim_current_task = interrupted_task;
+}
+
+static void raise_interrupt(sim_device_t *device, uint32_t status, uint16_t length)
+{
+   // Queue the radio event and assert the interrupt line if the event is unmasked
+   sim_radio_t *radio = &device->radio;
+   if (!(status & radio->interrupt_mask) || (radio->irq_count == SIM_IRQ_QUEUE_LENGTH))
+      return;
+   const uint8_t index = (radio->irq_head + radio->irq_count++) % SIM_IRQ_QUEUE_LENGTH;
+   radio->irq_status[index] = status;
+   radio->irq_length[index] = length;
+   sim_schedule_event(sim_now(), radio_isr_trampoline, device);
+}
+
+static void clear_interrupts(sim_radio_t *radio, uint32_t mask)
+{
+   // Remove all pending events matching the specified status mask
+   uint8_t remaining = 0;
+   for (uint8_t i = 0; i < radio->irq_count; ++i)
+   {
+      const uint8_t index = (radio->irq_head + i) % SIM_IRQ_QUEUE_LENGTH;
+      if (!(radio->irq_status[index] & mask))
+      {
+         const uint8_t destination = (radio->irq_head + remaining++) % SIM_IRQ_QUEUE_LENGTH;
+         radio->irq_status[destination] = radio->irq_status[index];
+         radio->irq_length[destination] = radio->irq_length[index];
+      }
+   }
+   radio->irq_count = remaining;
+}
+
+static void stop_activity(sim_device_t *device)
+{
+   // Abort any pending or ongoing transmissions and receptions
+   sim_radio_t *radio = &device->radio;
+   if (radio->tx_frame)
+   {
+      radio->tx_frame->aborted = true;
+      radio->tx_frame->aborted_at = sim_now();
+      radio->tx_frame = NULL;
+   }
+   radio->rx_frame = NULL;
+   radio->rx_on_event = radio->rx_timeout_event = 0;
+   if (radio->state != RADIO_SLEEP)
+      set_state(device, RADIO_IDLE);
+}
+
+static bool compute_delayed_target(sim_device_t *device, int mode, uint64_t *target, uint64_t *delta)
+{
+   // Compute the delayed TX/RX target time relative to the requested reference timestamp
+   sim_radio_t *radio = &device->radio;
+   const uint64_t now_local = local_time(device, sim_now());
+   uint64_t base = 0;
+   if (mode & DWT_START_TX_DLY_TS)
+      base = radio->tx_timestamp;
+   else if (mode & DWT_START_TX_DLY_RS)
+      base = radio->rx_timestamp;
+   *target = (base + ((uint64_t)radio->delayed_time << 8)) & SIM_DW_TIMESTAMP_MASK & ~0x1FFULL;
+   *delta = (*target - now_local) & SIM_DW_TIMESTAMP_MASK;
+   return *delta < HALF_TIMESTAMP_PERIOD;
+}
+
+static sim_time_t frame_end_time(const sim_frame_t *frame)
+{
+   // Return the time at which the frame actually stopped occupying the air
+   return (frame->aborted && (frame->aborted_at < frame->end)) ? frame->aborted_at : frame->end;
+}
+
+static void log_frame(const sim_frame_t *frame)
+{
+   // Record the frame for airtime and round-timing statistics
+   if (frame_end_time(frame) <= frame->start)
+      return;
+   if (air_log_length == air_log_capacity)
+   {
+      air_log_capacity = air_log_capacity ? (2 * air_log_capacity) : 4096;
+      air_log = (sim_air_record_t*)realloc(air_log, air_log_capacity * sizeof(sim_air_record_t));
+   }
+   air_log[air_log_length++] = (sim_air_record_t){ .start = frame->start, .end = frame_end_time(frame),
+      .type = (frame->length > sizeof(ieee154_header_t)) ? frame->data[sizeof(ieee154_header_t)] : 0,
+      .seq_num = frame->data[offsetof(ieee154_header_t, seqNum)], .sender = DEVICE_ID(frame->sender->uid) };
+}
+
+static int air_record_compare(const void *a, const void *b)
+{
+   const sim_time_t start_a = ((const sim_air_record_t*)a)->start, start_b = ((const sim_air_record_t*)b)->start;
+   return (start_a > start_b) - (start_a < start_b);
+}
+
+static void prune_frames(void)
+{
+   // Remove frames which can no longer overlap with any ongoing reception
+   for (sim_frame_t **frame = &frames_in_air; *frame; )
+      if ((*frame)->end < (sim_now() - SIM_PS_PER_MS))
+      {
+         sim_frame_t *expired = *frame;
+         *frame = expired->next;
+         log_frame(expired);
+         free(expired);
+      }
+      else
+         frame = &(*frame)->next;
+}
+
+static bool in_radio_range(const sim_device_t *sender, const sim_device_t *receiver)
+{
+   // Determine whether the receiver can hear the sender at all
+   return (sim_config.radio_range_m <= 0.0) || (sim_distance_m(sender, receiver) <= sim_config.radio_range_m);
+}
+
+static sim_time_t arrival_time(const sim_frame_t *frame, const sim_device_t *receiver)
+{
+   // Return the time at which the RMARKER of the frame arrives at the receiver
+   return frame->rmarker + (sim_time_t)llround(sim_distance_m(frame->sender, receiver) / SPEED_OF_LIGHT * 1.0e12);
+}
+
+static bool frames_combine(const sim_frame_t *frame, const sim_frame_t *other, const sim_device_t *receiver)
+{
+   // Identical frames whose RMARKERs arrive within a fraction of a preamble symbol of each other overlap in the channel
+   //   impulse response of the receiver like multipath components instead of corrupting one another
+   const sim_time_t offset = arrival_time(other, receiver) - arrival_time(frame, receiver);
+   return !other->aborted && (other->length == frame->length) && !memcmp(other->data, frame->data, frame->length) &&
+      (offset > -CONCURRENT_TX_WINDOW_PS) && (offset < CONCURRENT_TX_WINDOW_PS);
+}
+
+static bool frame_collided(const sim_frame_t *frame, const sim_device_t *receiver)
+{
+   // Determine if any other audible transmission overlapped with the frame without combining with it
+   for (const sim_frame_t *other = frames_in_air; other; other = other->next)
+      if ((other != frame) && (other->sender != receiver) && (other->channel == frame->channel) && in_radio_range(other->sender, receiver) &&
+            (frame_end_time(other) > other->start) && (other->start < frame->end) && (frame_end_time(other) > frame->start) &&
+            !frames_combine(frame, other, receiver))
+         return true;
+   return false;
+}
+
+static bool frame_passes_filter(const sim_radio_t *radio, const sim_frame_t *frame)
+{
+   // Accept only broadcast data frames addressed to our PAN or the broadcast PAN when frame filtering is enabled
+   if (!radio->frame_filtering)
+      return true;
+   const ieee154_header_t *header = (const ieee154_header_t*)frame->data;
+   return (frame->length >= sizeof(ieee154_header_t)) && ((header->frameCtrl[0] & 0x07) == 0x01) &&
+      ((frame->pan_id == radio->pan_id) || (frame->pan_id == BROADCAST_PANID)) && (header->destAddr[0] == 0xFF) && (header->destAddr[1] == 0xFF);
+}
+
+static void rx_timeout_handler(void *context, uint64_t event_id)
+{
+   // Turn off the receiver if no frame was detected in time
+   sim_device_t *device = (sim_device_t*)context;
+   if ((device->radio.rx_timeout_event != event_id) || (device->radio.state != RADIO_LISTEN))
+      return;
+   ++device->radio.rx_timeouts;
+   device->radio.rx_timeout_event = 0;
+   set_state(device, RADIO_IDLE);
+   raise_interrupt(device, DWT_INT_RXFTO_BIT_MASK, 0);
+}
+
+static void start_listening(sim_device_t *device)
+{
+   // Enable the receiver and start the frame wait timeout
+   sim_radio_t *radio = &device->radio;
+   set_state(device, RADIO_LISTEN);
+   radio->rx_on_time = sim_now();
+   radio->rx_timeout_event = radio->rx_timeout ?
+         sim_schedule_event(sim_now() + ((sim_time_t)radio->rx_timeout * RX_TIMEOUT_UNIT_PS), rx_timeout_handler, device) : 0;
+}
+
+static void rx_on_handler(void *context, uint64_t event_id)
+{
+   // Turn on the receiver at the requested delayed time
+   sim_device_t *device = (sim_device_t*)context;
+   if (device->radio.rx_on_event == event_id)
+   {
+      device->radio.rx_on_event = 0;
+      start_listening(device);
+   }
+}
+
+static void spi_ready_handler(void *context, uint64_t event_id)
+{
+   // Notify the host that the radio has finished waking up with its system time counter restarted from zero
+   sim_device_t *device = (sim_device_t*)context;
+   if (device->radio.spi_ready_event == event_id)
+   {
+      device->radio.spi_ready_event = 0;
+      device->clock_offset_s = -((double)sim_now() * 1.0e-12 * (1.0 + (device->clock_ppm * 1.0e-6)));
+      set_state(device, RADIO_IDLE);
+      raise_interrupt(device, DWT_INT_SPIRDY_BIT_MASK, 0);
+   }
+}
+
+static void frame_start_handler(void *context, uint64_t event_id)
+{
+   // Begin transmitting the frame preamble
+   sim_frame_t *frame = (sim_frame_t*)context;
+   if (!frame->aborted && (frame->sender->radio.tx_frame == frame))
+      set_state(frame->sender, RADIO_TX);
+}
+
+static bool sniff_detects_preamble(const sim_radio_t *radio)
+{
+   // A sniffing receiver only detects a preamble if one of its randomly phased on-times ends before the frame must be acquired
+   if (!radio->sniff_on_ps)
+      return true;
+   const sim_time_t detection_window = PREAMBLE_AND_SFD_PS - PREAMBLE_ACQUISITION_PS - radio->sniff_on_ps;
+   return sim_random_uniform() < ((double)detection_window / (double)(radio->sniff_on_ps + radio->sniff_off_ps));
+}
+
+static void frame_acquire_handler(void *context, uint64_t event_id)
+{
+   // Allow every listening device on the same channel to lock onto the frame preamble
+   sim_frame_t *frame = (sim_frame_t*)context;
+   if (frame->aborted)
+      return;
+   for (uint32_t i = 0; i < sim_config.num_devices; ++i)
+   {
+      sim_device_t *device = &sim_devices[i];
+      sim_radio_t *radio = &device->radio;
+      if ((device == frame->sender) || (radio->state != RADIO_LISTEN) || (radio->channel != frame->channel) ||
+            (radio->rx_on_time > sim_now()) || !in_radio_range(frame->sender, device) || !sniff_detects_preamble(radio) || (sim_random_uniform() < sim_config.packet_loss))
+         continue;
+      if (((frame->antenna == frame->sender->obstructed_antenna) || (radio->antenna == device->obstructed_antenna)) &&
+            (sim_random_uniform() < sim_config.antenna_loss))
+         continue;
+      radio->rx_frame = frame;
+      radio->rx_timeout_event = 0;
+      set_state(device, RADIO_RECEIVE);
+   }
+}
+
+static void frame_end_handler(void *context, uint64_t event_id)
+{
+   // Complete the transmission at the sender
+   sim_frame_t *frame = (sim_frame_t*)context;
+   sim_device_t *sender = frame->sender;
+   if (sender->radio.tx_frame == frame)
+   {
+      sender->radio.tx_frame = NULL;
+      ++sender->radio.frames_sent;
+      set_state(sender, RADIO_IDLE);
+      raise_interrupt(sender, DWT_INT_TXFRS_BIT_MASK, 0);
+   }
+
+   // Complete the reception at every device which locked onto this frame
+   for (uint32_t i = 0; i < sim_config.num_devices; ++i)
+   {
+      sim_device_t *device = &sim_devices[i];
+      sim_radio_t *radio = &device->radio;
+      if (radio->rx_frame != frame)
+         continue;
+      radio->rx_frame = NULL;
+      set_state(device, RADIO_IDLE);
+      if (frame->aborted || frame_collided(frame, device))
+      {
+         ++radio->collisions;
+         ++radio->rx_errors;
+         raise_interrupt(device, DWT_INT_RXFCE_BIT_MASK, 0);
+      }
+      else if (!frame_passes_filter(radio, frame))
+      {
+         ++radio->rx_errors;
+         raise_interrupt(device, DWT_INT_ARFE_BIT_MASK, 0);
+      }
+      else
+      {
+         // Obstruct the direct path of some frames, which then arrive late over a reflection with most of their energy
+         //   outside of the first path, while the first path of line-of-sight frames holds most of their energy
+         const bool obstructed = (sim_config.nlos_probability > 0.0) && (sim_random_uniform() < sim_config.nlos_probability);
+         const double excess_path_m = obstructed ? (0.3 + (1.2 * sim_random_uniform())) : 0.0;
+         radio->rx_first_path_attenuation = (float)(obstructed ? (6.0 + (10.0 * sim_random_uniform())) : (sim_config.nlos_probability > 0.0) ? (3.0 * sim_random_uniform()) : 0.0);
+
+         // Timestamp the frame arrival using the receiver clock
+         const double distance_m = sim_distance_m(frame->sender, device);
+         const sim_time_t arrival = arrival_time(frame, device) + (sim_time_t)llround(excess_path_m / SPEED_OF_LIGHT * 1.0e12);
+         const double noise = sim_config.timestamp_noise_ticks * sim_random_gaussian();
+         radio->rx_timestamp = (uint64_t)((int64_t)local_time(device, arrival) + PHYSICAL_RX_ANTENNA_DELAY_TICKS + (int64_t)llround(noise)) & SIM_DW_TIMESTAMP_MASK;
+         radio->rx_signal_level = (float)(-70.0 - (20.0 * log10(fmax(distance_m + excess_path_m, 0.5))) + sim_random_gaussian());
+         radio->rx_remote_ppm = frame->sender->clock_ppm;
+         radio->rx_length = frame->length;
+         memcpy(radio->rx_buffer, frame->data, frame->length);
+         ++radio->frames_received;
+         raise_interrupt(device, DWT_INT_RXFCG_BIT_MASK, frame->length);
+      }
+   }
+   prune_frames();
+}
+
+
+// Simulated Radio API -------------------------------------------------------------------------------------------------
+
+void sim_radio_reset(sim_device_t *device)
+{
+   // Return the radio to its power-on state without clearing its statistics
+   sim_radio_t *radio = &device->radio;
+   stop_activity(device);
+   radio->interrupt_mask = 0;
+   radio->irq_count = radio->irq_head = 0;
+   radio->delayed_time = radio->rx_timeout = 0;
+   radio->sniff_on_ps = radio->sniff_off_ps = 0;
+   radio->spi_ready_event = 0;
+   radio->channel = 5;
+   radio->frame_filtering = false;
+   set_state(device, RADIO_IDLE);
+}
+
+void sim_radio_finalize(sim_device_t *device)
+{
+   // Account for the time spent in the current radio state
+   set_state(device, device->radio.state);
+}
+
+void sim_radio_set_wakeup_pin(sim_device_t *device, bool asserted)
+{
+   // Wake up a sleeping radio on the rising edge of the wakeup pin
+   sim_radio_t *radio = &device->radio;
+   if (asserted && !radio->wakeup_pin && (radio->state == RADIO_SLEEP) && !radio->spi_ready_event)
+      radio->spi_ready_event = sim_schedule_event(sim_now() + RADIO_WAKEUP_LATENCY_PS, spi_ready_handler, device);
+   radio->wakeup_pin = asserted;
+}
+
+bool sim_radio_interrupt_pending(sim_device_t *device)
+{
+   return device->radio.irq_count > 0;
+}
+
+uint64_t sim_air_frame_count(sim_air_type_t type)
+{
+   uint64_t count = 0;
+   for (size_t i = 0; i < air_log_length; ++i)
+      count += (air_type_of(air_log[i].type) == type);
+   return count;
+}
+
+sim_time_t sim_air_time(sim_air_type_t type)
+{
+   sim_time_t total = 0;
+   for (size_t i = 0; i < air_log_length; ++i)
+      if (air_type_of(air_log[i].type) == type)
+         total += air_log[i].end - air_log[i].start;
+   return total;
+}
+
+void sim_air_report_rounds(FILE *output)
+{
+   // Flush all remaining frames into the air log
+   while (frames_in_air)
+   {
+      sim_frame_t *frame = frames_in_air;
+      frames_in_air = frame->next;
+      log_frame(frame);
+      free(frame);
+   }
+
+   // Split the chronologically sorted air log into rounds delimited by the first schedule broadcast of the master
+   qsort(air_log, air_log_length, sizeof(sim_air_record_t), air_record_compare);
+   const uint16_t master_id = DEVICE_ID(sim_devices[0].uid);
+   double phase_sum[AIR_NUM_TYPES + 1] = { 0 }, phase_max[AIR_NUM_TYPES + 1] = { 0 };
+   uint32_t phase_rounds[AIR_NUM_TYPES + 1] = { 0 };
+   for (size_t i = 0; i < air_log_length; )
+   {
+      // Find the extent of this round
+      if ((air_log[i].type != SCHEDULE_PACKET) || (air_log[i].sender != master_id) || air_log[i].seq_num)
+      {
+         ++i;
+         continue;
+      }
+      size_t round_end = i + 1;
+      while ((round_end < air_log_length) && !((air_log[round_end].type == SCHEDULE_PACKET) &&
+            (air_log[round_end].sender == master_id) && !air_log[round_end].seq_num))
+         ++round_end;
+
+      // Compute the extent of each protocol phase within the round
+      sim_time_t first[AIR_NUM_TYPES], last[AIR_NUM_TYPES];
+      for (int type = 0; type < AIR_NUM_TYPES; ++type)
+         first[type] = last[type] = -1;
+      for (size_t j = i; j < round_end; ++j)
+      {
+         const sim_air_type_t type = air_type_of(air_log[j].type);
+         if (first[type] < 0)
+            first[type] = air_log[j].start;
+         last[type] = air_log[j].end;
+      }
+      for (int type = 0; type < AIR_NUM_TYPES; ++type)
+         if (first[type] >= 0)
+         {
+            const double duration_us = SIM_TO_US((type == AIR_SCHEDULE) ? (last[type] - air_log[i].start) : (last[type] - first[type]));
+            phase_sum[type] += duration_us;
+            phase_max[type] = fmax(phase_max[type], duration_us);
+            ++phase_rounds[type];
+         }
+      sim_time_t round_last = air_log[i].end;
+      for (size_t j = i; j < round_end; ++j)
+         if (air_log[j].end > round_last)
+            round_last = air_log[j].end;
+      phase_sum[AIR_NUM_TYPES] += SIM_TO_US(round_last - air_log[i].start);
+      phase_max[AIR_NUM_TYPES] = fmax(phase_max[AIR_NUM_TYPES], SIM_TO_US(round_last - air_log[i].start));
+      ++phase_rounds[AIR_NUM_TYPES];
+      i = round_end;
+   }
+
+   // Print the per-phase timing statistics
+   static const char *phase_names[AIR_NUM_TYPES + 1] = { "schedule", "ranging", "status", "other", "round" };
+   fprintf(output, "Per-phase timing over %u master rounds (us):\n", phase_rounds[AIR_NUM_TYPES]);
+   for (int type = 0; type <= AIR_NUM_TYPES; ++type)
+      if (phase_rounds[type])
+         fprintf(output, "   %-9s mean %9.1f   max %9.1f   rounds %u\n", phase_names[type],
+               phase_sum[type] / phase_rounds[type], phase_max[type], phase_rounds[type]);
+}
+
+
+// DW3000 Driver API ---------------------------------------------------------------------------------------------------
+
+int dwt_probe(struct dwt_probe_s *probe_interf) { return DWT_SUCCESS; }
+void dwt_restoreconfig(void) {}
+void dwt_configuretxrf(dwt_txconfig_t *config) {}
+void dwt_configmrxlut(int channel) {}
+void dwt_configciadiag(uint8_t enable_mask) {}
+void dwt_seteui(uint8_t *eui64) {}
+void dwt_setdblrxbuffmode(dwt_dbl_buff_state_e dbl_buff_state, dwt_dbl_buff_mode_e dbl_buff_mode) {}
+void dwt_enableautoack(uint8_t responseDelayTime, int enable) {}
+void dwt_setrxantennadelay(uint16_t antennaDly) {}
+void dwt_settxantennadelay(uint16_t antennaDly) {}
+void dwt_configuresleep(uint16_t mode, uint8_t wake) {}
+
+int dwt_initialise(int mode)
+{
+   sim_radio_reset(sim_current_device);
+   return DWT_SUCCESS;
+}
+
+int dwt_configure(dwt_config_t *config)
+{
+   current_radio()->channel = config->chan;
+   return DWT_SUCCESS;
+}
+
+void dwt_setpanid(uint16_t panID)
+{
+   current_radio()->pan_id = panID;
+}
+
+void dwt_configureframefilter(uint16_t enabletype, uint16_t filtermode)
+{
+   current_radio()->frame_filtering = (enabletype != 0);
+}
+
+void dwt_setcallbacks(dwt_cb_t cbTxDone, dwt_cb_t cbRxOk, dwt_cb_t cbRxTo, dwt_cb_t cbRxErr, dwt_cb_t cbSPIErr, dwt_cb_t cbSPIRdy, dwt_cb_t cbDualSPIEv)
+{
+   sim_radio_t *radio = current_radio();
+   radio->tx_done = cbTxDone;
+   radio->rx_ok = cbRxOk;
+   radio->rx_timeout_cb = cbRxTo;
+   radio->rx_error = cbRxErr;
+   radio->spi_ready = cbSPIRdy;
+}
+
+void dwt_setinterrupt(uint32_t bitmask_lo, uint32_t bitmask_hi, dwt_INT_options_e INT_options)
+{
+   sim_radio_t *radio = current_radio();
+   if (INT_options == DWT_DISABLE_INT)
+      radio->interrupt_mask &= ~bitmask_lo;
+   else if (INT_options == DWT_ENABLE_INT)
+      radio->interrupt_mask |= bitmask_lo;
+   else
+      radio->interrupt_mask = bitmask_lo;
+}
+
+void dwt_writesysstatuslo(uint32_t mask)
+{
+   clear_interrupts(current_radio(), mask);
+}
+
+void dwt_forcetrxoff(void)
+{
+   stop_activity(sim_current_device);
+   clear_interrupts(current_radio(), DWT_INT_TXFRS_BIT_MASK | DWT_INT_RXFCG_BIT_MASK | DWT_INT_RX_ERRORS | DWT_INT_RX_TIMEOUTS);
+}
+
+void dwt_entersleep(int idle_rc)
+{
+   stop_activity(sim_current_device);
+   set_state(sim_current_device, RADIO_SLEEP);
+}
+
+void dwt_setsniffmode(int enable, uint8_t timeOn, uint8_t timeOff)
+{
+   // Account for any listening so far at the previous duty cycle before switching to the new one
+   sim_radio_t *radio = current_radio();
+   set_state(sim_current_device, radio->state);
+   radio->sniff_on_ps = enable ? ((sim_time_t)(timeOn + 1) * SNIFF_PAC_PS) : 0;
+   radio->sniff_off_ps = enable ? ((sim_time_t)timeOff * SNIFF_OFF_UNIT_PS) : 0;
+}
+
+void dwt_setrxtimeout(uint32_t time)
+{
+   current_radio()->rx_timeout = time;
+}
+
+void dwt_setdelayedtrxtime(uint32_t starttime)
+{
+   current_radio()->delayed_time = starttime;
+}
+
+void dwt_writetxfctrl(uint16_t txFrameLength, uint16_t txBufferOffset, uint8_t ranging)
+{
+   current_radio()->tx_length = txFrameLength;
+}
+
+int dwt_writetxdata(uint16_t txDataLength, uint8_t *txDataBytes, uint16_t txBufferOffset)
+{
+   if ((txBufferOffset + txDataLength) > SIM_MAX_FRAME_LENGTH)
+      return DWT_ERROR;
+   memcpy(current_radio()->tx_buffer + txBufferOffset, txDataBytes, txDataLength);
+   return DWT_SUCCESS;
+}
+
+int dwt_starttx(uint8_t mode)
+{
+   // Ensure that the radio is awake and not already transmitting
+   sim_device_t *device = sim_current_device;
+   sim_radio_t *radio = &device->radio;
+   if ((radio->state == RADIO_SLEEP) || radio->tx_frame || (radio->tx_length > SIM_MAX_FRAME_LENGTH))
+      return DWT_ERROR;
+   stop_activity(device);
+
+   // Determine the time of the RMARKER in both local and global time
+   sim_frame_t *frame = (sim_frame_t*)calloc(1, sizeof(sim_frame_t));
+   uint64_t rmarker_local;
+   if (mode & (DWT_START_TX_DELAYED | DWT_START_TX_DLY_RS | DWT_START_TX_DLY_TS))
+   {
+      uint64_t delta;
+      if (!compute_delayed_target(device, mode, &rmarker_local, &delta) || (global_duration(device, delta) < (PREAMBLE_AND_SFD_PS + TX_STARTUP_PS)))
+      {
+         ++radio->late_tx;
+         free(frame);
+         return DWT_ERROR;
+      }
+      frame->rmarker = sim_now() + global_duration(device, delta + PHYSICAL_TX_ANTENNA_DELAY_TICKS);
+   }
+   else
+   {
+      frame->rmarker = sim_now() + TX_STARTUP_PS + PREAMBLE_AND_SFD_PS;
+      rmarker_local = (local_time(device, frame->rmarker) - PHYSICAL_TX_ANTENNA_DELAY_TICKS) & SIM_DW_TIMESTAMP_MASK;
+   }
+
+   // Put the frame on the air
+   const uint32_t data_bits = (8 * radio->tx_length) + (48 * ((8 * radio->tx_length + 329) / 330));
+   frame->sender = device;
+   frame->channel = radio->channel;
+   frame->antenna = radio->antenna;
+   frame->length = radio->tx_length;
+   memcpy(frame->data, radio->tx_buffer, frame->length);
+   frame->pan_id = (uint16_t)frame->data[offsetof(ieee154_header_t, panID)] | ((uint16_t)frame->data[offsetof(ieee154_header_t, panID) + 1] << 8);
+   frame->start = frame->rmarker - PREAMBLE_AND_SFD_PS;
+   frame->end = frame->rmarker + ((21 + data_bits) * DATA_BIT_PS);
+   frame->next = frames_in_air;
+   frames_in_air = frame;
+   radio->tx_frame = frame;
+   radio->tx_timestamp = rmarker_local;
+   sim_schedule_event(frame->start, frame_start_handler, frame);
+   sim_schedule_event(frame->rmarker - PREAMBLE_ACQUISITION_PS, frame_acquire_handler, frame);
+   sim_schedule_event(frame->end, frame_end_handler, frame);
+   return DWT_SUCCESS;
+}
+
+int dwt_rxenable(int mode)
+{
+   // Ensure that the radio is awake
+   sim_device_t *device = sim_current_device;
+   sim_radio_t *radio = &device->radio;
+   if (radio->state == RADIO_SLEEP)
+      return DWT_ERROR;
+   stop_activity(device);
+
+   // Turn on the receiver immediately or schedule it for the requested time
+   if (mode & (DWT_START_RX_DELAYED | DWT_START_RX_DLY_RS | DWT_START_RX_DLY_TS))
+   {
+      uint64_t target, delta;
+      if (!compute_delayed_target(device, mode, &target, &delta) || (global_duration(device, delta) < DELAYED_RX_MIN_LEAD_PS))
+      {
+         ++radio->late_rx;
+         if (!(mode & DWT_IDLE_ON_DLY_ERR))
+            start_listening(device);
+         return DWT_ERROR;
+      }
+      radio->rx_on_event = sim_schedule_event(sim_now() + global_duration(device, delta), rx_on_handler, device);
+   }
+   else
+      start_listening(device);
+   return DWT_SUCCESS;
+}
+
+void dwt_readrxdata(uint8_t *buffer, uint16_t length, uint16_t rxBufferOffset)
+{
+   // Keep track of payload bytes read over blocking SPI from within the radio interrupt
+   const sim_radio_t *radio = current_radio();
+   if (!sim_current_task && !sim_current_device->spi_event)
+      sim_current_device->spi_isr_rx_bytes += length;
+   if ((rxBufferOffset + length) <= SIM_MAX_FRAME_LENGTH)
+      memcpy(buffer, radio->rx_buffer + rxBufferOffset, length);
+}
+
+void dwt_readtxtimestamp(uint8_t *timestamp)
+{
+   const uint64_t value = current_radio()->tx_timestamp;
+   for (int i = 0; i < 5; ++i)
+      timestamp[i] = (uint8_t)(value >> (8 * i));
+}
+
+void dwt_readrxtimestamp(uint8_t *timestamp)
+{
+   const uint64_t value = current_radio()->rx_timestamp;
+   for (int i = 0; i < 5; ++i)
+      timestamp[i] = (uint8_t)(value >> (8 * i));
+}
+
+uint32_t dwt_readsystimestamphi32(void)
+{
+   return (uint32_t)(local_time(sim_current_device, sim_now()) >> 8);
+}
+
+int16_t dwt_readclockoffset(void)
+{
+   // Positive values indicate that the local clock runs faster than the remote clock, in units of 1/16 ppm
+   const sim_device_t *device = sim_current_device;
+   return (int16_t)lround(16.0 * (device->clock_ppm - device->radio.rx_remote_ppm));
+}
+
+int32_t dwt_readcarrierintegrator(void)
+{
+   // Positive values indicate that the local clock runs faster than the remote clock
+   const sim_device_t *device = sim_current_device;
+   const double hertz_to_ppm = (device->radio.channel == 5) ? HERTZ_TO_PPM_MULTIPLIER_CHAN_5 : HERTZ_TO_PPM_MULTIPLIER_CHAN_9;
+   return (int32_t)lround((device->radio.rx_remote_ppm - device->clock_ppm) / (FREQ_OFFSET_MULTIPLIER * hertz_to_ppm));
+}
+
+void sim_radio_spi_read(sim_device_t *device, uint64_t instruction, uint8_t *buffer, uint32_t length)
+{
+   // Serve the raw CIA diagnostics and DGC register reads issued by the firmware's RX fast path
+   uint8_t registers[0x60] = { 0 };
+   const sim_radio_t *radio = &device->radio;
+   if (instruction == SIM_CIA_DIAGNOSTICS_READ_HEADER)
+   {
+      // Synthesize first-path amplitudes and a total channel impulse response power which reproduce the modeled
+      //   received signal level and the attenuation of its first path
+      const double accumulation_count = 1024.0;
+      const double first_path_level = radio->rx_signal_level - radio->rx_first_path_attenuation;
+      const double amplitude = accumulation_count * sqrt(pow(10.0, (first_path_level + 121.7) / 10.0) / 3.0);
+      const uint32_t first_path_amplitude = (uint32_t)lround(4.0 * amplitude);
+      const uint32_t cir_power = (uint32_t)lround(accumulation_count * accumulation_count * pow(10.0, (radio->rx_signal_level + 121.7) / 10.0) / (double)(1UL << 21));
+      const uint32_t accumulated_symbols = (uint32_t)accumulation_count;
+      for (int i = 0; i < 5; ++i)
+         registers[i] = (uint8_t)(radio->rx_timestamp >> (8 * i));
+      memcpy(registers + 0x2C, &cir_power, sizeof(cir_power));
+      memcpy(registers + 0x30, &first_path_amplitude, sizeof(first_path_amplitude));
+      memcpy(registers + 0x34, &first_path_amplitude, sizeof(first_path_amplitude));
+      memcpy(registers + 0x38, &first_path_amplitude, sizeof(first_path_amplitude));
+      memcpy(registers + 0x58, &accumulated_symbols, sizeof(accumulated_symbols));
+   }
+   memcpy(buffer, registers, (length < sizeof(registers)) ? length : sizeof(registers));
+}
+
+void dwt_isr(void)
+{
+   // Pop the next pending radio event and dispatch it to the registered callback
+   sim_radio_t *radio = current_radio();
+   if (!radio->irq_count)
+      return;
+   const dwt_cb_data_t data = { .status = radio->irq_status[radio->irq_head], .status_hi = 0,
+      .datalength = radio->irq_length[radio->irq_head], .rx_flags = 0, .dss_stat = 0, .dw = NULL };
+   radio->irq_head = (radio->irq_head + 1) % SIM_IRQ_QUEUE_LENGTH;
+   --radio->irq_count;
+   if ((data.status & DWT_INT_TXFRS_BIT_MASK) && radio->tx_done)
+      radio->tx_done(&data);
+   else if ((data.status & DWT_INT_RXFCG_BIT_MASK) && radio->rx_ok)
+      radio->rx_ok(&data);
+   else if ((data.status & DWT_INT_RX_TIMEOUTS) && radio->rx_timeout_cb)
+      radio->rx_timeout_cb(&data);
+   else if ((data.status & DWT_INT_RX_ERRORS) && radio->rx_error)
+      radio->rx_error(&data);
+   else if ((data.status & DWT_INT_SPIRDY_BIT_MASK) && radio->spi_ready)
+      radio->spi_ready(&data);
+}
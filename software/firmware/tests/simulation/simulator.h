@@ -0,0 +1,161 @@
+#ifndef __SIMULATOR_HEADER_H__
+#define __SIMULATOR_HEADER_H__
+
+// Header Inclusions ---------------------------------------------------------------------------------------------------
+
+#include <stdio.h>
+#include <ucontext.h>
+#include "app_tasks.h"
+#include "deca_device_api.h"
+
+
+// Simulation Definitions ----------------------------------------------------------------------------------------------
+
+#define SIM_MAX_DEVICES                             64
+#define SIM_MAX_FRAME_LENGTH                        1024
+#define SIM_IRQ_QUEUE_LENGTH                        16
+#define SIM_TASK_STACK_SIZE                         (256 * 1024)
+
+#define SIM_PS_PER_US                               1000000LL
+#define SIM_PS_PER_MS                               (1000LL * SIM_PS_PER_US)
+#define SIM_PS_PER_SECOND                           (1000LL * SIM_PS_PER_MS)
+#define SIM_US(_us)                                 ((sim_time_t)((_us) * (double)SIM_PS_PER_US))
+#define SIM_TO_US(_ps)                              ((double)(_ps) / (double)SIM_PS_PER_US)
+#define SIM_DW_TIMESTAMP_MASK                       0xFFFFFFFFFFULL
+#define SIM_CIA_DIAGNOSTICS_READ_HEADER             0x18
+
+typedef int64_t sim_time_t;
+typedef void (*sim_event_handler_t)(void *context, uint64_t event_id);
+typedef void (*sim_task_function_t)(void *argument);
+
+typedef enum { RADIO_SLEEP = 0, RADIO_IDLE, RADIO_TX, RADIO_LISTEN, RADIO_RECEIVE, RADIO_NUM_STATES } sim_radio_state_t;
+typedef enum { AIR_SCHEDULE = 0, AIR_RANGING, AIR_STATUS, AIR_OTHER, AIR_NUM_TYPES } sim_air_type_t;
+
+
+// Simulation Data Structures ------------------------------------------------------------------------------------------
+
+struct sim_device;
+
+typedef struct sim_task
+{
+   ucontext_t context;
+   void *stack;
+   struct sim_device *device;
+   sim_task_function_t function;
+   void *argument;
+   const char *name;
+   uint32_t notification_value;
+   uint64_t wakeup_event;
+   bool notification_pending, waiting_for_notification, wakeup_from_notification, finished;
+} sim_task_t;
+
+typedef struct sim_frame
+{
+   struct sim_device *sender;
+   uint8_t channel, antenna, data[SIM_MAX_FRAME_LENGTH];
+   uint16_t pan_id, length;
+   sim_time_t start, rmarker, end, aborted_at;
+   bool aborted;
+   struct sim_frame *next;
+} sim_frame_t;
+
+typedef struct
+{
+   sim_radio_state_t state;
+   sim_time_t state_since, state_time[RADIO_NUM_STATES];
+   uint8_t channel, antenna, tx_buffer[SIM_MAX_FRAME_LENGTH], rx_buffer[SIM_MAX_FRAME_LENGTH];
+   uint16_t pan_id, tx_length, rx_length;
+   uint32_t delayed_time, rx_timeout, interrupt_mask;
+   uint64_t tx_timestamp, rx_timestamp, rx_on_event, rx_timeout_event, spi_ready_event;
+   bool frame_filtering, wakeup_pin;
+   sim_time_t rx_on_time, sniff_on_ps, sniff_off_ps;
+   sim_frame_t *tx_frame, *rx_frame;
+   float rx_signal_level, rx_first_path_attenuation;
+   double rx_remote_ppm;
+   dwt_cb_t tx_done, rx_ok, rx_timeout_cb, rx_error, spi_ready;
+   uint32_t irq_status[SIM_IRQ_QUEUE_LENGTH];
+   uint16_t irq_length[SIM_IRQ_QUEUE_LENGTH];
+   uint8_t irq_head, irq_count;
+   uint32_t frames_sent, frames_received, rx_timeouts, rx_errors, collisions, late_tx, late_rx;
+} sim_radio_t;
+
+typedef struct sim_device
+{
+   uint32_t index, network;
+   uint8_t uid[EUI_LEN], obstructed_antenna, antenna_select_pins, network_channel;
+   bool is_master;
+   double x, y, clock_ppm, clock_offset_s, mcu_ppm;
+   void *library;
+   void (*ranging_radio_init)(uint8_t *uid);
+   void (*ranging_radio_sleep)(bool deep_sleep);
+   void (*scheduler_init)(uint8_t *uid);
+   void (*scheduler_run)(schedule_role_t role, uint8_t channel, uint32_t timestamp);
+   void (*scheduler_add_device)(uint16_t device_id);
+   void (*scheduler_set_motion_status)(bool in_motion);
+   void (*scheduler_rtc_isr)(void);
+   void (*am_timer02_isr)(void);
+   int16_t (*schedule_phase_get_clock_offset)(void);
+   sim_task_t *task;
+   sim_radio_t radio;
+   am_hal_gpio_handler_t radio_isr;
+   void *radio_isr_args;
+   am_hal_iom_transfer_t spi_transfer;
+   am_hal_iom_callback_t spi_callback;
+   void *spi_callback_context;
+   uint64_t rtc_event, timer_event, spi_event;
+   sim_time_t rtc_origin, rtc_period, timer_start;
+   uint32_t timer_compare0;
+   bool rtc_interrupt_enabled, timer_interrupt_enabled;
+   uint32_t network_joins, network_drops, range_reports, ranges_reported;
+   uint64_t spi_isr_rx_bytes, spi_dma_rx_bytes;
+   uint32_t clock_sync_reports, clock_unsynchronized_reports;
+   double range_error_sum, range_error_squared_sum, range_error_max, clock_sync_error_max;
+   sim_time_t last_range_time[SIM_MAX_DEVICES], max_range_period[SIM_MAX_DEVICES];
+} sim_device_t;
+
+typedef struct
+{
+   uint32_t num_devices, num_networks, num_channels, seconds, seed;
+   double packet_loss, antenna_loss, room_size_m, radio_range_m, clock_ppm, mcu_ppm, timestamp_noise_ticks, isr_latency_us, moving_seconds, join_delay_s, nlos_probability;
+   bool colliding_ids, verbose;
+} sim_config_t;
+
+
+// Global Simulation State ---------------------------------------------------------------------------------------------
+
+extern sim_config_t sim_config;
+extern sim_device_t sim_devices[SIM_MAX_DEVICES];
+extern sim_device_t *sim_current_device;
+extern sim_task_t *sim_current_task;
+
+
+// Simulation Kernel API -----------------------------------------------------------------------------------------------
+
+sim_time_t sim_now(void);
+uint64_t sim_schedule_event(sim_time_t time, sim_event_handler_t handler, void *context);
+void sim_run_until(sim_time_t end_time);
+sim_task_t* sim_task_create(sim_device_t *device, const char *name, sim_task_function_t function, void *argument);
+void sim_task_sleep(sim_time_t duration);
+void sim_run_isr(sim_device_t *device, void (*isr)(void));
+void sim_random_seed(uint32_t seed);
+double sim_random_uniform(void);
+double sim_random_gaussian(void);
+
+
+// Simulated Radio API -------------------------------------------------------------------------------------------------
+
+void sim_radio_reset(sim_device_t *device);
+void sim_radio_finalize(sim_device_t *device);
+void sim_radio_set_wakeup_pin(sim_device_t *device, bool asserted);
+bool sim_radio_interrupt_pending(sim_device_t *device);
+void sim_radio_spi_read(sim_device_t *device, uint64_t instruction, uint8_t *buffer, uint32_t length);
+uint64_t sim_air_frame_count(sim_air_type_t type);
+sim_time_t sim_air_time(sim_air_type_t type);
+void sim_air_report_rounds(FILE *output);
+
+
+// Simulated Platform API ----------------------------------------------------------------------------------------------
+
+double sim_distance_m(const sim_device_t *a, const sim_device_t *b);
+
+#endif  // #ifndef __SIMULATOR_HEADER_H__
@@ -0,0 +1,274 @@
+// Header Inclusions ---------------------------------------------------------------------------------------------------
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "computation_phase.h"
+#include "timing.h"
+
+
+// Test Definitions ----------------------------------------------------------------------------------------------------
+
+#define NUM_SYNTHETIC_EXCHANGES                     1000000
+#define NUM_RANDOM_EXCHANGES                        1000000
+#define NUM_BENCHMARK_PASSES                        20
+#define MAX_CLOCK_PPM                               20.0
+#define MAX_TIMESTAMP_NOISE_TICKS                   10.0
+#define FILTER_TEST_DEVICE_ID                       0x4202
+#define FILTER_TEST_NOISE_MM                        100.0
+#define NUM_SINGLE_SIDED_EXCHANGES                  10000
+
+typedef struct { uint32_t round_trip1, reply1, round_trip2, reply2; } exchange_t;
+
+// Timestamp sets recorded from the simulator in pairwise mode (where reply times are implied) and broadcast mode
+static const exchange_t recorded_exchanges[] = {
+   { 63962651, 0, 63964517, 0 }, { 63964116, 0, 63965340, 0 }, { 63964449, 0, 63964775, 0 }, { 63963925, 0, 63963722, 0 },
+   { 63965056, 0, 63965891, 0 }, { 63962843, 0, 63964343, 0 }, { 63964116, 0, 63964506, 0 }, { 63963718, 0, 63964874, 0 },
+   { 63965540, 0, 63964652, 0 }, { 63962936, 0, 63964346, 0 }, { 63964122, 0, 63963810, 0 }, { 63964147, 0, 63963774, 0 },
+   { 63963268, 0, 63964525, 0 }, { 63964058, 0, 63963865, 0 }, { 63964082, 0, 63963833, 0 }, { 63964004, 0, 63963647, 0 },
+   { 255620201, 255553459, 255630675, 255560599 }, { 191721528, 191653306, 319528888, 319459272 },
+   { 63923419, 63856098, 447326155, 447257381 }, { 191721167, 191655389, 319530237, 319459633 },
+   { 255619861, 255553121, 255631020, 255560939 }, { 191719367, 191653608, 319532513, 319461433 },
+   { 191701926, 191636122, 319549491, 319478874 }, { 191724274, 191656053, 319526120, 319456526 },
+   { 127885119, 127817194, 383358840, 383295681 }, { 191726344, 191659632, 319521140, 319454456 },
+   { 191708304, 191642513, 319543573, 319472496 }, { 63926831, 63859021, 447325159, 447253969 },
+   { 127828097, 127761154, 383421095, 383352703 }, { 127831679, 127762874, 383417411, 383349121 },
+   { 191718773, 191650557, 319531622, 319462027 }, { 127829871, 127761094, 383419209, 383350929 },
+};
+
+static exchange_t synthetic_exchanges[NUM_SYNTHETIC_EXCHANGES];
+static uint64_t random_state = 0x9E3779B97F4A7C15ULL;
+
+
+// Private Helper Functions --------------------------------------------------------------------------------------------
+
+static uint32_t random_uint32(void)
+{
+   random_state ^= random_state << 13;
+   random_state ^= random_state >> 7;
+   random_state ^= random_state << 17;
+   return (uint32_t)(random_state >> 32);
+}
+
+static double random_uniform(double min, double max)
+{
+   return min + ((max - min) * ((double)random_uint32() / UINT32_MAX));
+}
+
+static uint64_t read_cycle_counter(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+   return __builtin_ia32_rdtsc();
+#else
+   struct timespec now;
+   clock_gettime(CLOCK_MONOTONIC, &now);
+   return ((uint64_t)now.tv_sec * 1000000000ULL) + (uint64_t)now.tv_nsec;
+#endif
+}
+
+static double reference_distance_millimeters(const exchange_t *exchange)
+{
+   // Double-precision computation previously used by compute_ranges and ranging_radio_time_to_millimeters
+   const double broadcast_interval_dwt = APP_US_TO_DEVICETIMEU64(RANGING_BROADCAST_INTERVAL_US);
+   const double reply1_dwt = exchange->reply1 ? (double)exchange->reply1 : broadcast_interval_dwt;
+   const double reply2_dwt = exchange->reply2 ? (double)exchange->reply2 : broadcast_interval_dwt;
+   const double TOF = (((double)exchange->round_trip1 * exchange->round_trip2) - (reply1_dwt * reply2_dwt)) /
+         ((double)exchange->round_trip1 + exchange->round_trip2 + reply1_dwt + reply2_dwt);
+   return (TOF - RADIO_TX_PLUS_RX_DELAY) * SPEED_OF_LIGHT * DWT_TIME_UNITS * 1000.0;
+}
+
+static exchange_t synthesize_exchange(void)
+{
+   // Model a DS-TWR exchange between two devices with independent clock errors, reply delays, and timestamp noise
+   const double time_of_flight = (random_uniform(MIN_VALID_RANGE_MM, MAX_VALID_RANGE_MM) / (SPEED_OF_LIGHT * DWT_TIME_UNITS * 1000.0)) + RADIO_TX_PLUS_RX_DELAY;
+   const double initiator_clock = 1.0 + (1e-6 * random_uniform(-MAX_CLOCK_PPM, MAX_CLOCK_PPM));
+   const double responder_clock = 1.0 + (1e-6 * random_uniform(-MAX_CLOCK_PPM, MAX_CLOCK_PPM));
+   const double reply1 = APP_US_TO_DEVICETIMEU64(random_uniform(200.0, 64000.0)), reply2 = APP_US_TO_DEVICETIMEU64(random_uniform(200.0, 64000.0));
+   const bool implied_replies = random_uint32() & 1;
+   exchange_t exchange;
+   exchange.reply1 = implied_replies ? 0 : (uint32_t)((reply1 * responder_clock) + random_uniform(-MAX_TIMESTAMP_NOISE_TICKS, MAX_TIMESTAMP_NOISE_TICKS));
+   exchange.reply2 = implied_replies ? 0 : (uint32_t)((reply2 * initiator_clock) + random_uniform(-MAX_TIMESTAMP_NOISE_TICKS, MAX_TIMESTAMP_NOISE_TICKS));
+   exchange.round_trip1 = (uint32_t)((((2.0 * time_of_flight) + (implied_replies ? APP_US_TO_DEVICETIMEU64(RANGING_BROADCAST_INTERVAL_US) : reply1)) * initiator_clock) +
+         random_uniform(-MAX_TIMESTAMP_NOISE_TICKS, MAX_TIMESTAMP_NOISE_TICKS));
+   exchange.round_trip2 = (uint32_t)((((2.0 * time_of_flight) + (implied_replies ? APP_US_TO_DEVICETIMEU64(RANGING_BROADCAST_INTERVAL_US) : reply2)) * responder_clock) +
+         random_uniform(-MAX_TIMESTAMP_NOISE_TICKS, MAX_TIMESTAMP_NOISE_TICKS));
+   return exchange;
+}
+
+static bool check_exchange(const exchange_t *exchange, uint32_t *num_valid, uint32_t *exact_matches, double *max_error_mm)
+{
+   // Reference ranges near the valid interval must be reproduced to within one millimeter, and all others must remain invalid
+   const double reference_mm = reference_distance_millimeters(exchange);
+   const int32_t fixed_point_mm = compute_distance_millimeters(exchange->round_trip1, exchange->reply1, exchange->round_trip2, exchange->reply2);
+   if ((reference_mm < (MIN_VALID_RANGE_MM - 2)) || (reference_mm > (MAX_VALID_RANGE_MM + 2)))
+      return (fixed_point_mm < MIN_VALID_RANGE_MM) || (fixed_point_mm > MAX_VALID_RANGE_MM);
+   ++*num_valid;
+   const double error_mm = fabs((double)fixed_point_mm - reference_mm);
+   *exact_matches += (fixed_point_mm == (int32_t)reference_mm);
+   if (error_mm > *max_error_mm)
+      *max_error_mm = error_mm;
+   return abs(fixed_point_mm - (int32_t)reference_mm) <= 1;
+}
+
+static bool check_exchanges(const char *description, const exchange_t *exchanges, uint32_t num_exchanges)
+{
+   // Compare the fixed-point and double-precision results for every exchange
+   uint32_t num_valid = 0, exact_matches = 0, failures = 0;
+   double max_error_mm = 0.0;
+   for (uint32_t i = 0; i < num_exchanges; ++i)
+      if (!check_exchange(&exchanges[i], &num_valid, &exact_matches, &max_error_mm) && (++failures <= 5))
+         fprintf(stderr, "FAIL: %s exchange { %u, %u, %u, %u }: reference %.3f mm, fixed-point %d mm\n", description, exchanges[i].round_trip1, exchanges[i].reply1,
+               exchanges[i].round_trip2, exchanges[i].reply2, reference_distance_millimeters(&exchanges[i]),
+               compute_distance_millimeters(exchanges[i].round_trip1, exchanges[i].reply1, exchanges[i].round_trip2, exchanges[i].reply2));
+   printf("%-10s %8u exchanges, %8u in range: %8u identical, max deviation %.4f mm, %u failures\n", description, num_exchanges, num_valid, exact_matches, max_error_mm, failures);
+   return !failures;
+}
+
+static int16_t filter_round(double distance_mm, float signal_level_dbm)
+{
+   // Run a round in which every antenna sequence measures the same distance to a single peer, keeping the most
+   //   recently reported range if the filter does not report one
+   static int16_t reported_range_mm = INT16_MAX;
+   uint8_t ranging_results[1 + COMPRESSED_RANGE_DATUM_LENGTH];
+   const uint32_t round_trip = (uint32_t)((2.0 * ((distance_mm / (SPEED_OF_LIGHT * DWT_TIME_UNITS * 1000.0)) + RADIO_TX_PLUS_RX_DELAY)) +
+         APP_US_TO_DEVICETIMEU64(RANGING_BROADCAST_INTERVAL_US));
+   reset_computation_phase();
+   add_signal_level(FILTER_TEST_DEVICE_ID, signal_level_dbm);
+   for (uint8_t i = 0; i < RANGING_NUM_SEQUENCES; ++i)
+      add_ranging_times(FILTER_TEST_DEVICE_ID, i, round_trip, 0, round_trip, 0);
+   compute_ranges(ranging_results, SCHEDULING_INTERVAL_US);
+   if (ranging_results[0])
+      memcpy(&reported_range_mm, &ranging_results[1 + sizeof(uint16_t)], sizeof(reported_range_mm));
+   return reported_range_mm;
+}
+
+static bool check_range_filter(void)
+{
+   // A still peer should be tracked through measurement noise and a single outlier, and a peer which moved should be
+   //   followed as soon as enough consecutive measurements agree on its new position
+   reset_range_filters();
+   int16_t range_mm = 0;
+   for (uint32_t i = 0; i < 20; ++i)
+      range_mm = filter_round(5000.0 + random_uniform(-FILTER_TEST_NOISE_MM, FILTER_TEST_NOISE_MM), -70.0f);
+   const bool noise_tracked = abs(range_mm - 5000) <= (2 * FILTER_TEST_NOISE_MM);
+   range_mm = filter_round(7000.0, -70.0f);
+   const bool outlier_rejected = abs(range_mm - 5000) <= (2 * FILTER_TEST_NOISE_MM);
+   for (uint32_t i = 0; i < RANGE_FILTER_MAX_REJECTIONS; ++i)
+      range_mm = filter_round(8000.0, -70.0f);
+   const bool move_followed = abs(range_mm - 8000) <= 10;
+   printf("Range filter: noise %s, outlier %s, move %s\n", noise_tracked ? "tracked" : "NOT TRACKED",
+         outlier_rejected ? "rejected" : "NOT REJECTED", move_followed ? "followed" : "NOT FOLLOWED");
+   return noise_tracked && outlier_rejected && move_followed;
+}
+
+static bool check_nlos_selection(void)
+{
+   // A peer whose likely line-of-sight sequences are outnumbered by sequences with an obstructed first path should still
+   //   be ranged using only its line-of-sight sequences
+   uint8_t ranging_results[1 + COMPRESSED_RANGE_DATUM_LENGTH];
+   const uint8_t num_los_sequences = (RANGING_NUM_SEQUENCES > 3) ? (RANGING_NUM_SEQUENCES / 3) : 1;
+   reset_range_filters();
+   reset_computation_phase();
+   add_signal_level(FILTER_TEST_DEVICE_ID, -70.0f);
+   for (uint8_t i = 0; i < RANGING_NUM_SEQUENCES; ++i)
+   {
+      const bool obstructed = i >= num_los_sequences;
+      const uint32_t round_trip = (uint32_t)((2.0 * (((obstructed ? 6000.0 : 5000.0) / (SPEED_OF_LIGHT * DWT_TIME_UNITS * 1000.0)) + RADIO_TX_PLUS_RX_DELAY)) +
+            APP_US_TO_DEVICETIMEU64(RANGING_BROADCAST_INTERVAL_US));
+      add_nlos_indicator(FILTER_TEST_DEVICE_ID, i, obstructed ? (RANGE_NLOS_INDICATOR_THRESHOLD_DB + 6.0f) : 2.0f);
+      add_ranging_times(FILTER_TEST_DEVICE_ID, i, round_trip, 0, round_trip, 0);
+   }
+   compute_ranges(ranging_results, SCHEDULING_INTERVAL_US);
+   int16_t range_mm = INT16_MAX;
+   if (ranging_results[0])
+      memcpy(&range_mm, &ranging_results[1 + sizeof(uint16_t)], sizeof(range_mm));
+   bool passed = abs(range_mm - 5000) <= 10;
+#if RANGE_OUTPUT_QUALITY
+   passed = passed && (ranging_results[1 + sizeof(uint16_t) + sizeof(int16_t)] == ((((num_los_sequences > 3) ? 3 : num_los_sequences) << 6) | 2));
+#endif
+   printf("NLOS selection: %u of %u line-of-sight sequences, range %d mm %s\n", num_los_sequences, RANGING_NUM_SEQUENCES, (int)range_mm, passed ? "used" : "NOT USED");
+   return passed;
+}
+
+static int32_t single_sided_range(uint32_t round_trip, uint32_t reply)
+{
+   // Compute the range of a single-sided exchange through the same path used by the Ranging Phase
+   uint8_t ranging_results[1 + COMPRESSED_RANGE_DATUM_LENGTH];
+   int16_t range_mm = INT16_MAX;
+   reset_range_filters();
+   reset_computation_phase();
+   add_single_sided_times(FILTER_TEST_DEVICE_ID, 0, round_trip, reply);
+   compute_ranges(ranging_results, SCHEDULING_INTERVAL_US);
+   if (ranging_results[0])
+      memcpy(&range_mm, &ranging_results[1 + sizeof(uint16_t)], sizeof(range_mm));
+   return range_mm;
+}
+
+static bool check_single_sided(void)
+{
+   // Responders report quantized reply times in their own clock, which initiators must convert into their own clock
+   //   using the clock offset measured on the response, in units of 1/16 ppm
+   double max_error_mm = 0.0, max_uncorrected_error_mm = 0.0;
+   for (uint32_t i = 0; i < NUM_SINGLE_SIDED_EXCHANGES; ++i)
+   {
+      const double distance_mm = random_uniform(500.0, 20000.0), relative_ppm = random_uniform(-2.0 * MAX_CLOCK_PPM, 2.0 * MAX_CLOCK_PPM);
+      const uint32_t reply = (uint32_t)US_TO_DW_TICKS(RANGING_BROADCAST_INTERVAL_US) - (random_uint32() & 0x1FF);
+      const uint32_t round_trip = (uint32_t)llround((2.0 * ((distance_mm / (SPEED_OF_LIGHT * DWT_TIME_UNITS * 1000.0)) + RADIO_TX_PLUS_RX_DELAY)) + (reply * (1.0 + (relative_ppm * 1.0e-6))));
+      const int16_t clock_offset = (int16_t)lround(relative_ppm * CLOCK_OFFSET_UNITS_PER_PPM);
+      const double error_mm = fabs(single_sided_range(round_trip, (uint32_t)SYNCHRONIZED_DW_TICKS(reply, clock_offset)) - distance_mm);
+      const double uncorrected_error_mm = fabs(compute_distance_millimeters(round_trip, reply, round_trip, reply) - distance_mm);
+      max_error_mm = (error_mm > max_error_mm) ? error_mm : max_error_mm;
+      max_uncorrected_error_mm = (uncorrected_error_mm > max_uncorrected_error_mm) ? uncorrected_error_mm : max_uncorrected_error_mm;
+   }
+   printf("Single-sided ranging: max error %.1f mm with clock offset correction, %.1f mm without\n", max_error_mm, max_uncorrected_error_mm);
+   return max_error_mm <= 15.0;
+}
+
+static void benchmark(void)
+{
+   // Time both implementations over the synthetic exchanges
+   volatile int64_t sink = 0;
+   uint64_t reference_cycles = UINT64_MAX, fixed_point_cycles = UINT64_MAX;
+   for (uint32_t pass = 0; pass < NUM_BENCHMARK_PASSES; ++pass)
+   {
+      int64_t sum = 0;
+      uint64_t start = read_cycle_counter();
+      for (uint32_t i = 0; i < NUM_SYNTHETIC_EXCHANGES; ++i)
+         sum += (int32_t)reference_distance_millimeters(&synthetic_exchanges[i]);
+      uint64_t elapsed = read_cycle_counter() - start;
+      reference_cycles = (elapsed < reference_cycles) ? elapsed : reference_cycles;
+      start = read_cycle_counter();
+      for (uint32_t i = 0; i < NUM_SYNTHETIC_EXCHANGES; ++i)
+         sum += compute_distance_millimeters(synthetic_exchanges[i].round_trip1, synthetic_exchanges[i].reply1, synthetic_exchanges[i].round_trip2, synthetic_exchanges[i].reply2);
+      elapsed = read_cycle_counter() - start;
+      fixed_point_cycles = (elapsed < fixed_point_cycles) ? elapsed : fixed_point_cycles;
+      sink += sum;
+   }
+   printf("Host cost per range: double %.1f, fixed-point %.1f cycles\n",
+         (double)reference_cycles / NUM_SYNTHETIC_EXCHANGES, (double)fixed_point_cycles / NUM_SYNTHETIC_EXCHANGES);
+}
+
+
+// Main Test Function --------------------------------------------------------------------------------------------------
+
+int main(void)
+{
+   // Generate realistic and completely random timestamp sets
+   static exchange_t random_exchanges[NUM_RANDOM_EXCHANGES];
+   for (uint32_t i = 0; i < NUM_SYNTHETIC_EXCHANGES; ++i)
+      synthetic_exchanges[i] = synthesize_exchange();
+   for (uint32_t i = 0; i < NUM_RANDOM_EXCHANGES; ++i)
+      random_exchanges[i] = (exchange_t){ random_uint32(), random_uint32() >> (random_uint32() % 32), random_uint32(), random_uint32() >> (random_uint32() % 32) };
+
+   // Verify that the fixed-point DS-TWR computation matches the double-precision computation
+   bool passed = check_exchanges("recorded", recorded_exchanges, sizeof(recorded_exchanges) / sizeof(recorded_exchanges[0]));
+   passed = check_exchanges("synthetic", synthetic_exchanges, NUM_SYNTHETIC_EXCHANGES) && passed;
+   passed = check_exchanges("random", random_exchanges, NUM_RANDOM_EXCHANGES) && passed;
+   passed = check_range_filter() && passed;
+   passed = check_nlos_selection() && passed;
+   passed = check_single_sided() && passed;
+   benchmark();
+   printf("%s\n", passed ? "PASSED" : "FAILED");
+   return passed ? 0 : 1;
+}
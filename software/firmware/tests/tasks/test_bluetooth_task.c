@@ -70,7 +70,7 @@ static void button_pressed(void *button_number)
    portYIELD_FROM_ISR(xHigherPriorityTaskWoken);
 }
 
-static void ble_discovery_handler(const uint8_t ble_address[6], uint8_t ranging_role)
+static void ble_discovery_handler(const uint8_t ble_address[6], uint8_t ranging_role, uint8_t ranging_channel)
 {
    print("Discovered %02X:%02X:%02X:%02X:%02X:%02X\n", ble_address[0], ble_address[1], ble_address[2],
          ble_address[3], ble_address[4], ble_address[5]);
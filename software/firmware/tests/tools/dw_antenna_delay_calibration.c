@@ -1,142 +1,523 @@
-#include <stdlib.h>
+#include <errno.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
 #include <stdint.h>
 #include <stdio.h>
-#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+#include "range_bias.h"
 
 // Algorithm Constants -------------------------------------------------------------------------------------------------
 
-#define NUM_CALIBRATION_DEVICES                                 3
-#define NUM_REFINEMENT_ITERATIONS                             250
-#define ANTENNA_DISTANCE_MM                                3000.0
-#define NUM_CANDIDATE_DELAY_ESTIMATES                       10000
-#define INITIAL_DELAY_ESTIMATE_NS                           514.0
-#define INITIAL_DELAY_ESTIMATE_DISTRIBUTION_NS                6.0
-#define DELAY_PERTURBATION_LIMIT_NS                           0.2
+#define MIN_CALIBRATION_DEVICES                                 3
+#define MAX_CALIBRATION_DEVICES                               256
+#define MAX_SOLVER_THREADS                                     64
+#define NUM_REWEIGHTING_ITERATIONS                             10
+#define OUTLIER_THRESHOLD_NS                                 0.15       // Residuals beyond ~45 mm are progressively down-weighted
+#define MIN_CHOLESKY_PIVOT                                   1e-9
 #define SPEED_OF_LIGHT_MM_PER_NS                       299.702547
+#define DWT_TICKS_PER_NS                                  63.8976
+#define TX_ANTENNA_DELAY_FRACTION                           0.44
+#define NOMINAL_TX_PLUS_RX_DELAY_TICKS                     32756       // RADIO_TX_PLUS_RX_DELAY assumed by uncalibrated firmware
+
+
+// Benchmark Constants -------------------------------------------------------------------------------------------------
+
+#define BENCHMARK_NUM_CALIBRATIONS                            200
+#define BENCHMARK_AREA_SIZE_MM                            10000.0
+#define BENCHMARK_DELAY_SPREAD_NS                             3.0
+#define BENCHMARK_RANGE_NOISE_NS                             0.03
+#define BENCHMARK_OUTLIER_PROBABILITY                        0.05
+#define BENCHMARK_OUTLIER_DELAY_NS                            1.0
+#define BENCHMARK_MISSING_PROBABILITY                        0.05
 
+static const int benchmark_num_devices[] = { 8, 32, 64 };
+
+
+// Calibration Record Format (must match calibration_details_t in src/tasks/app_tasks.h) -------------------------------
+
+#define NUM_CALIBRATED_CHANNELS                                 2
+#define NUM_ANTENNAS                                            3
+#define NUM_CALIBRATION_PROBLEMS                                (NUM_CALIBRATED_CHANNELS * NUM_ANTENNAS)
+#define RANGE_BIAS_TABLE_LENGTH                                34
+
+typedef struct __attribute__ ((__packed__))
+{
+   uint16_t tx_antenna_delay, rx_antenna_delay;
+   int8_t range_bias[RANGE_BIAS_TABLE_LENGTH];
+} antenna_calibration_t;
+
+typedef struct __attribute__ ((__packed__))
+{
+   antenna_calibration_t antennas[NUM_CALIBRATED_CHANNELS][NUM_ANTENNAS];
+} calibration_details_t;
 
-// Static Global Variables ---------------------------------------------------------------------------------------------
+_Static_assert(sizeof(calibration_details_t) == 228, "Calibration record no longer matches the firmware format");
 
-static double perturbation_limit_ns = DELAY_PERTURBATION_LIMIT_NS;
-static double candidate_delay_estimates[NUM_CANDIDATE_DELAY_ESTIMATES] = { 0 };
-static double euclidean_distance_matrix_measured[NUM_CALIBRATION_DEVICES][NUM_CALIBRATION_DEVICES] = { 0 };
-static double euclidean_distance_matrix_estimated[NUM_CALIBRATION_DEVICES][NUM_CALIBRATION_DEVICES] = { 0 };
-static const double euclidean_distance_matrix_actual[NUM_CALIBRATION_DEVICES][NUM_CALIBRATION_DEVICES] = {
-      { 0.0, ANTENNA_DISTANCE_MM, ANTENNA_DISTANCE_MM },
-      { ANTENNA_DISTANCE_MM, 0.0, ANTENNA_DISTANCE_MM },
-      { ANTENNA_DISTANCE_MM, ANTENNA_DISTANCE_MM, 0.0 } };
+// Range bias is not solved by this tool, so every record carries the same default table used by uncalibrated firmware
+#define RANGE_BIAS_TICKS(_meters)       ((int8_t)((_meters) * 1000.0 / SPEED_OF_LIGHT_MM_PER_NS * DWT_TICKS_PER_NS))
+static const int8_t default_range_bias[RANGE_BIAS_TABLE_LENGTH] = DEFAULT_RANGE_BIAS_TABLE(RANGE_BIAS_TICKS);
+
+
+// Data Structures -----------------------------------------------------------------------------------------------------
+
+typedef struct
+{
+   int num_devices, success;
+   const double *actual_tof_ns;       // N x N time of flight implied by the surveyed device positions
+   double *measured_tof_ns;           // N x N raw time of flight including antenna delays, NAN where missing
+   double *delays_ns;                 // Solved aggregate TX+RX antenna delay of each device
+} calibration_problem_t;
+
+typedef struct
+{
+   calibration_problem_t *problems;
+   int num_problems;
+   atomic_int next_problem;
+} solver_queue_t;
 
 
 // Helper Functions ----------------------------------------------------------------------------------------------------
 
-static int compare_estimates(const void *a, const void *b)
+static uint16_t calculate_tx_antenna_delay(double aggregate_delay)
 {
-   double d0 = **(double**)a, d1 = **(double**)b;
-   return (d0 > d1) ? -1 : ((d0 < d1) ? 1 : 0);
+   // Convert the TX share of the aggregate delay into DWT units
+   return (uint16_t)((TX_ANTENNA_DELAY_FRACTION * aggregate_delay * DWT_TICKS_PER_NS) + 0.5);
 }
 
-static uint64_t calculate_tx_antenna_delay(double aggregate_delay)
+static uint16_t calculate_rx_antenna_delay(double aggregate_delay)
 {
-   // TODO: Convert aggregate delay into DWT units
-   return (uint64_t)(0.44 * aggregate_delay);
+   // Assign the remainder of the aggregate delay in DWT units to RX so that both always sum to the full delay
+   return (uint16_t)((uint32_t)((aggregate_delay * DWT_TICKS_PER_NS) + 0.5) - calculate_tx_antenna_delay(aggregate_delay));
 }
 
-static uint64_t calculate_rx_antenna_delay(double aggregate_delay)
+static double elapsed_seconds(const struct timespec *start)
 {
-   // TODO: Convert aggregate delay into DWT units
-   return (uint64_t)(0.56 * aggregate_delay);
+   struct timespec end;
+   clock_gettime(CLOCK_MONOTONIC, &end);
+   return (double)(end.tv_sec - start->tv_sec) + (1e-9 * (double)(end.tv_nsec - start->tv_nsec));
 }
 
-static void populate_candidate_delay_estimates(int iteration)
+static double random_uniform(void)
 {
-   // First iteration is used to generate the initial set of candidate delays
-   if (iteration == 0)
+   return (rand() + 0.5) / ((double)RAND_MAX + 1.0);
+}
+
+static double random_gaussian(void)
+{
+   return sqrt(-2.0 * log(random_uniform())) * cos(2.0 * M_PI * random_uniform());
+}
+
+static int cholesky_solve(double *matrix, double *vector, int n)
+{
+   // Factor the symmetric normal matrix in place into L * L^T, failing if it is not positive definite, which happens
+   //   when the measured pairs do not determine the delay of every device
+   for (int j = 0; j < n; ++j)
+   {
+      double *row_j = &matrix[j * n];
+      double pivot = row_j[j];
+      for (int k = 0; k < j; ++k)
+         pivot -= row_j[k] * row_j[k];
+      if (pivot < MIN_CHOLESKY_PIVOT)
+         return 0;
+      row_j[j] = sqrt(pivot);
+      for (int i = j + 1; i < n; ++i)
+      {
+         double *row_i = &matrix[i * n], sum = row_i[j];
+         for (int k = 0; k < j; ++k)
+            sum -= row_i[k] * row_j[k];
+         row_i[j] = sum / row_j[j];
+      }
+   }
+
+   // Solve L * y = b followed by L^T * x = y, leaving the solution in the vector
+   for (int i = 0; i < n; ++i)
    {
-      // Generate a set of random delays uniformly distributed around the initial delay
-      const double initial_estimate = INITIAL_DELAY_ESTIMATE_NS - INITIAL_DELAY_ESTIMATE_DISTRIBUTION_NS;
-      const double estimate_offset = (2.0 * INITIAL_DELAY_ESTIMATE_DISTRIBUTION_NS) / NUM_CANDIDATE_DELAY_ESTIMATES;
-      for (int i = 0; i < NUM_CANDIDATE_DELAY_ESTIMATES; ++i)
-         candidate_delay_estimates[i] = initial_estimate + (estimate_offset * i);
+      const double *row_i = &matrix[i * n];
+      double sum = vector[i];
+      for (int k = 0; k < i; ++k)
+         sum -= row_i[k] * vector[k];
+      vector[i] = sum / row_i[i];
    }
-   else
+   for (int i = n - 1; i >= 0; --i)
    {
-      // Halve the perturbation limit every 20 iterations
-      const int quarter_of_num_estimates = (NUM_CANDIDATE_DELAY_ESTIMATES / 4);
-      if (iteration == 20)
-         perturbation_limit_ns *= 0.5;
-
-      // Randomly perturb the top 25% of candidates 3 times to create a new set of candidates
-      for (int i = 1; i < 4; ++i)
-         for (int candidate_idx = 0; candidate_idx < quarter_of_num_estimates; ++candidate_idx)
-         {
-            double random_value = (rand() * 2.0 * perturbation_limit_ns / RAND_MAX) - perturbation_limit_ns;
-            candidate_delay_estimates[(i * quarter_of_num_estimates) + candidate_idx] = candidate_delay_estimates[candidate_idx] + random_value;
-         }
+      double sum = vector[i];
+      for (int k = i + 1; k < n; ++k)
+         sum -= matrix[k * n + i] * vector[k];
+      vector[i] = sum / matrix[i * n + i];
    }
+   return 1;
 }
 
-static void evaluate_candidate_delay_estimates(void)
+static int solve_antenna_delays(calibration_problem_t *problem)
 {
-   // Determine the "goodness" of each candidate delay estimate
-   static double candidate_delay_norms[NUM_CANDIDATE_DELAY_ESTIMATES];
-   for (int candidate_idx = 0; candidate_idx < NUM_CANDIDATE_DELAY_ESTIMATES; ++candidate_idx)
-   {
-      // Fill in the estimated euclidean distance matrix
-      const double candidate_delay_ns = candidate_delay_estimates[candidate_idx];
-      for (int device1 = 0; device1 < NUM_CALIBRATION_DEVICES; ++device1)
-         for (int device2 = 0; device2 < NUM_CALIBRATION_DEVICES; ++device2)
-            if (device1 != device2)
-               euclidean_distance_matrix_estimated[device1][device2] = (euclidean_distance_matrix_measured[device1][device2] - (2.0 * candidate_delay_ns)) * SPEED_OF_LIGHT_MM_PER_NS;
-
-      // Compute the norm of the difference between the actual and the estimated EDM
-      double norm = 0.0;
-      for (int device1 = 0; device1 < NUM_CALIBRATION_DEVICES; ++device1)
-         for (int device2 = 0; device2 < NUM_CALIBRATION_DEVICES; ++device2)
+   // Every measured time of flight contains half of the aggregate TX+RX delay of both devices, so the delays are the
+   //   least-squares solution of (D_i + D_j) / 2 = measured_ij - actual_ij over all measured pairs
+   const int n = problem->num_devices;
+   double *normal_matrix = malloc(sizeof(double) * n * n), *residuals = calloc((size_t)n * n, sizeof(double));
+   double *base_weights = calloc((size_t)n * n, sizeof(double)), *weights = malloc(sizeof(double) * n * n);
+   int success = normal_matrix && residuals && base_weights && weights;
+
+   // Combine the measurements made in either direction into one symmetric residual per pair, weighted by their count
+   for (int i = 0; success && (i < n); ++i)
+      for (int j = i + 1; j < n; ++j)
+      {
+         const double forward = problem->measured_tof_ns[i * n + j], backward = problem->measured_tof_ns[j * n + i];
+         const double count = !isnan(forward) + !isnan(backward);
+         if (count)
          {
-            const double edm_difference = euclidean_distance_matrix_estimated[device1][device2] - euclidean_distance_matrix_actual[device1][device2];
-            norm += (edm_difference * edm_difference);
+            const double residual = ((isnan(forward) ? 0.0 : forward) + (isnan(backward) ? 0.0 : backward)) / count;
+            residuals[i * n + j] = residuals[j * n + i] = residual - problem->actual_tof_ns[i * n + j];
+            base_weights[i * n + j] = base_weights[j * n + i] = count;
          }
-      candidate_delay_norms[candidate_idx] = sqrt(norm);
-   }
+      }
+   if (success)
+      memcpy(weights, base_weights, sizeof(double) * n * n);
 
-   // Sort the array of candidate delay estimates based on the computed norms
-   double *sorting_array[NUM_CANDIDATE_DELAY_ESTIMATES];
-   for (int i = 0; i < NUM_CANDIDATE_DELAY_ESTIMATES; ++i)
-      sorting_array[i] = &candidate_delay_estimates[i];
-   qsort(sorting_array, NUM_CANDIDATE_DELAY_ESTIMATES, sizeof(sorting_array[0]), compare_estimates);
-   for (int i = 0; i < NUM_CANDIDATE_DELAY_ESTIMATES; ++i)
-      if (i != (sorting_array[i] - candidate_delay_estimates))
+   // Iteratively reweight the pairs using Huber weights so that a few multipath-corrupted ranges cannot skew the result
+   for (int iteration = 0; success && (iteration < NUM_REWEIGHTING_ITERATIONS); ++iteration)
+   {
+      // Accumulate the normal equations one contiguous device row at a time on the calling thread, since this O(N^2) step
+      //   is dwarfed by the O(N^3) Cholesky solve and too short to be worth handing rows to other threads
+      for (int i = 0; i < n; ++i)
       {
-         size_t temp_candidate_delay_estimate = candidate_delay_estimates[i], j, k = i;
-         while (i != (j = (sorting_array[k] - candidate_delay_estimates)))
+         const double *row_weights = &weights[i * n], *row_residuals = &residuals[i * n];
+         double *normal_row = &normal_matrix[i * n], weight_sum = 0.0, weighted_residual_sum = 0.0;
+         for (int j = 0; j < n; ++j)
          {
-            candidate_delay_estimates[k] = candidate_delay_estimates[j];
-            sorting_array[k] = &candidate_delay_estimates[k];
-            k = j;
+            normal_row[j] = 0.25 * row_weights[j];
+            weight_sum += row_weights[j];
+            weighted_residual_sum += row_weights[j] * row_residuals[j];
          }
-         candidate_delay_estimates[k] = temp_candidate_delay_estimate;
-         sorting_array[k] = &candidate_delay_estimates[k];
-     }
+         normal_row[i] += 0.25 * weight_sum;
+         problem->delays_ns[i] = 0.5 * weighted_residual_sum;
+      }
+      success = cholesky_solve(normal_matrix, problem->delays_ns, n);
+
+      // Down-weight every pair in proportion to how far its residual exceeds the outlier threshold
+      for (int i = 0; success && (i < n); ++i)
+         for (int j = i + 1; j < n; ++j)
+            if (base_weights[i * n + j])
+            {
+               const double error = fabs(((problem->delays_ns[i] + problem->delays_ns[j]) * 0.5) - residuals[i * n + j]);
+               weights[i * n + j] = weights[j * n + i] = base_weights[i * n + j] * ((error <= OUTLIER_THRESHOLD_NS) ? 1.0 : (OUTLIER_THRESHOLD_NS / error));
+            }
+   }
+   free(normal_matrix);
+   free(residuals);
+   free(base_weights);
+   free(weights);
+   return success;
+}
+
+static void* solver_thread(void *args)
+{
+   // Keep solving the next unclaimed problem until none remain
+   solver_queue_t *queue = (solver_queue_t*)args;
+   for (int index = atomic_fetch_add(&queue->next_problem, 1); index < queue->num_problems; index = atomic_fetch_add(&queue->next_problem, 1))
+      queue->problems[index].success = solve_antenna_delays(&queue->problems[index]);
+   return NULL;
+}
+
+static void solve_all_problems(calibration_problem_t *problems, int num_problems, int num_threads)
+{
+   // Distribute the independent per-channel and per-antenna problems across all worker threads, including this one;
+   //   parallelism is per problem only, so a single calibration uses at most NUM_CALIBRATION_PROBLEMS threads
+   pthread_t threads[MAX_SOLVER_THREADS];
+   solver_queue_t queue = { .problems = problems, .num_problems = num_problems };
+   atomic_init(&queue.next_problem, 0);
+   if (num_threads > num_problems)
+      num_threads = num_problems;
+   int num_started = 0;
+   while ((num_started + 1 < num_threads) && (pthread_create(&threads[num_started], NULL, solver_thread, &queue) == 0))
+      ++num_started;
+   solver_thread(&queue);
+   for (int i = 0; i < num_started; ++i)
+      pthread_join(threads[i], NULL);
+}
+
+static int get_num_threads(void)
+{
+   const long num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+   return (num_cpus < 1) ? 1 : ((num_cpus > MAX_SOLVER_THREADS) ? MAX_SOLVER_THREADS : (int)num_cpus);
+}
+
+static double* compute_actual_tof(const double (*positions_mm)[3], int num_devices)
+{
+   // Compute the true time of flight between every pair of surveyed device positions
+   double *actual_tof_ns = malloc(sizeof(double) * num_devices * num_devices);
+   for (int i = 0; actual_tof_ns && (i < num_devices); ++i)
+      for (int j = 0; j < num_devices; ++j)
+      {
+         const double dx = positions_mm[i][0] - positions_mm[j][0], dy = positions_mm[i][1] - positions_mm[j][1];
+         const double dz = positions_mm[i][2] - positions_mm[j][2];
+         actual_tof_ns[i * num_devices + j] = sqrt((dx * dx) + (dy * dy) + (dz * dz)) / SPEED_OF_LIGHT_MM_PER_NS;
+      }
+   return actual_tof_ns;
+}
+
+static int read_device_positions(const char *file_name, double (*positions_mm)[3])
+{
+   // Read one line of surveyed X, Y, and Z antenna coordinates in millimeters per calibration device
+   FILE *file = fopen(file_name, "r");
+   if (!file)
+      return 0;
+   int num_devices = 0;
+   while ((num_devices < MAX_CALIBRATION_DEVICES) &&
+          (fscanf(file, "%lf %lf %lf", &positions_mm[num_devices][0], &positions_mm[num_devices][1], &positions_mm[num_devices][2]) == 3))
+      ++num_devices;
+   fclose(file);
+   return num_devices;
+}
+
+static int read_measured_distances(const char *file_name, calibration_problem_t *problems, int num_devices)
+{
+   // Read either one matrix of mean ranges in millimeters reported by each pair of uncalibrated devices, which is then
+   //   used for every channel and antenna, or one matrix per channel and antenna, with NAN marking unmeasured pairs
+   FILE *file = fopen(file_name, "r");
+   if (!file)
+      return 0;
+   const int num_entries = num_devices * num_devices;
+   int num_matrices = 0;
+   for (int entry = 0; num_matrices < NUM_CALIBRATION_PROBLEMS; entry = 0, ++num_matrices)
+   {
+      for (; entry < num_entries; ++entry)
+      {
+         // Convert each range back into the raw time of flight which still contains the antenna delays of both devices
+         double range_mm;
+         if (fscanf(file, "%lf", &range_mm) != 1)
+            break;
+         problems[num_matrices].measured_tof_ns[entry] = isnan(range_mm) ? NAN :
+               ((range_mm / SPEED_OF_LIGHT_MM_PER_NS) + (NOMINAL_TX_PLUS_RX_DELAY_TICKS / DWT_TICKS_PER_NS));
+      }
+      if (entry < num_entries)
+      {
+         fclose(file);
+         if ((num_matrices != 1) || entry)
+            return 0;
+         for (int i = 1; i < NUM_CALIBRATION_PROBLEMS; ++i)
+            memcpy(problems[i].measured_tof_ns, problems[0].measured_tof_ns, sizeof(double) * num_entries);
+         return 1;
+      }
+   }
+   fclose(file);
+   return 1;
+}
+
+static int write_calibration_record(const char *file_name, const calibration_problem_t *problems, int device)
+{
+   // Apply the estimated antenna delays of each channel and antenna along with the default range bias
+   calibration_details_t calibration;
+   for (int channel = 0; channel < NUM_CALIBRATED_CHANNELS; ++channel)
+      for (int antenna = 0; antenna < NUM_ANTENNAS; ++antenna)
+      {
+         const double aggregate_delay = problems[(channel * NUM_ANTENNAS) + antenna].delays_ns[device];
+         calibration.antennas[channel][antenna].tx_antenna_delay = calculate_tx_antenna_delay(aggregate_delay);
+         calibration.antennas[channel][antenna].rx_antenna_delay = calculate_rx_antenna_delay(aggregate_delay);
+         memcpy(calibration.antennas[channel][antenna].range_bias, default_range_bias, sizeof(default_range_bias));
+      }
+
+   // Write the record in the format expected by the BLE maintenance service
+   FILE *file = fopen(file_name, "wb");
+   if (!file)
+      return 0;
+   const int success = fwrite(&calibration, sizeof(calibration), 1, file) == 1;
+   fclose(file);
+   return success;
+}
+
+static calibration_problem_t* allocate_problems(int num_problems, int num_devices, const double *actual_tof_ns)
+{
+   // Allocate the measurement matrix and solution vector for each problem, all sharing the same actual distances
+   calibration_problem_t *problems = calloc(num_problems, sizeof(calibration_problem_t));
+   double *measurements = malloc(sizeof(double) * num_problems * num_devices * num_devices);
+   double *delays = malloc(sizeof(double) * num_problems * num_devices);
+   if (!problems || !measurements || !delays)
+   {
+      free(problems);
+      free(measurements);
+      free(delays);
+      return NULL;
+   }
+   for (int i = 0; i < num_problems; ++i)
+   {
+      problems[i].num_devices = num_devices;
+      problems[i].actual_tof_ns = actual_tof_ns;
+      problems[i].measured_tof_ns = &measurements[i * num_devices * num_devices];
+      problems[i].delays_ns = &delays[i * num_devices];
+   }
+   return problems;
+}
+
+static void free_problems(calibration_problem_t *problems)
+{
+   if (problems)
+   {
+      free(problems[0].measured_tof_ns);
+      free(problems[0].delays_ns);
+      free(problems);
+   }
+}
+
+
+// Benchmark Function --------------------------------------------------------------------------------------------------
+
+static int run_benchmark(void)
+{
+   const int num_threads = get_num_threads();
+   printf("Solving %d calibrations of %d channel/antenna problems each using 1 and %d threads, one problem per thread at a time\n", BENCHMARK_NUM_CALIBRATIONS, NUM_CALIBRATION_PROBLEMS, num_threads);
+   for (size_t n = 0; n < (sizeof(benchmark_num_devices) / sizeof(benchmark_num_devices[0])); ++n)
+   {
+      // Place the devices randomly throughout a room and give each of them random antenna delays
+      const int num_devices = benchmark_num_devices[n], num_problems = BENCHMARK_NUM_CALIBRATIONS * NUM_CALIBRATION_PROBLEMS;
+      double (*positions_mm)[3] = malloc(sizeof(double[3]) * num_devices);
+      double *true_delays_ns = malloc(sizeof(double) * num_problems * num_devices);
+      double *actual_tof_ns = NULL;
+      if (positions_mm)
+      {
+         for (int i = 0; i < num_devices; ++i)
+            for (int axis = 0; axis < 3; ++axis)
+               positions_mm[i][axis] = (axis == 2) ? 1000.0 : (BENCHMARK_AREA_SIZE_MM * random_uniform());
+         actual_tof_ns = compute_actual_tof((const double (*)[3])positions_mm, num_devices);
+      }
+      calibration_problem_t *problems = actual_tof_ns ? allocate_problems(num_problems, num_devices, actual_tof_ns) : NULL;
+      if (!problems || !true_delays_ns)
+      {
+         printf("ERROR: Unable to allocate benchmark data for %d devices\n", num_devices);
+         free(positions_mm);
+         free(true_delays_ns);
+         free(actual_tof_ns);
+         return 1;
+      }
+
+      // Simulate averaged range measurements with noise, occasional multipath outliers, and some unmeasured pairs
+      for (int p = 0; p < num_problems; ++p)
+      {
+         double *delays = &true_delays_ns[p * num_devices];
+         for (int i = 0; i < num_devices; ++i)
+            delays[i] = (NOMINAL_TX_PLUS_RX_DELAY_TICKS / DWT_TICKS_PER_NS) + (BENCHMARK_DELAY_SPREAD_NS * ((2.0 * random_uniform()) - 1.0));
+         for (int i = 0; i < num_devices; ++i)
+            for (int j = 0; j < num_devices; ++j)
+            {
+               double measurement = actual_tof_ns[i * num_devices + j] + (0.5 * (delays[i] + delays[j])) + (BENCHMARK_RANGE_NOISE_NS * random_gaussian());
+               if (random_uniform() < BENCHMARK_OUTLIER_PROBABILITY)
+                  measurement += BENCHMARK_OUTLIER_DELAY_NS * random_uniform();
+               problems[p].measured_tof_ns[i * num_devices + j] = (random_uniform() < BENCHMARK_MISSING_PROBABILITY) ? NAN : measurement;
+            }
+      }
+
+      // Time the solver using a single thread and then using every available core
+      struct timespec start;
+      clock_gettime(CLOCK_MONOTONIC, &start);
+      solve_all_problems(problems, num_problems, 1);
+      const double single_thread_seconds = elapsed_seconds(&start);
+      clock_gettime(CLOCK_MONOTONIC, &start);
+      solve_all_problems(problems, num_problems, num_threads);
+      const double multi_thread_seconds = elapsed_seconds(&start);
+
+      // Compare the solved delays against the simulated ones
+      int num_failures = 0;
+      double squared_error_sum = 0.0, max_error_ticks = 0.0;
+      for (int p = 0; p < num_problems; ++p)
+         if (!problems[p].success)
+            ++num_failures;
+         else
+            for (int i = 0; i < num_devices; ++i)
+            {
+               const double error_ticks = fabs(problems[p].delays_ns[i] - true_delays_ns[p * num_devices + i]) * DWT_TICKS_PER_NS;
+               squared_error_sum += error_ticks * error_ticks;
+               max_error_ticks = (error_ticks > max_error_ticks) ? error_ticks : max_error_ticks;
+            }
+      const int num_solved = num_problems - num_failures;
+      printf("BENCHMARK devices=%d ms_per_calibration_1_thread=%.3f ms_per_calibration_%d_threads=%.3f speedup=%.2f rms_error_ticks=%.2f max_error_ticks=%.2f failures=%d\n",
+             num_devices, 1000.0 * single_thread_seconds / BENCHMARK_NUM_CALIBRATIONS, num_threads, 1000.0 * multi_thread_seconds / BENCHMARK_NUM_CALIBRATIONS,
+             single_thread_seconds / multi_thread_seconds, num_solved ? sqrt(squared_error_sum / ((double)num_solved * num_devices)) : 0.0, max_error_ticks, num_failures);
+      free_problems(problems);
+      free(positions_mm);
+      free(true_delays_ns);
+      free(actual_tof_ns);
+   }
+   return 0;
 }
 
 
 // Main Calibration Function -------------------------------------------------------------------------------------------
 
-int main(void)
+int main(int argc, char *argv[])
 {
-   // Collect a large number of time-of-flight measurements
+   // Validate the command line arguments
    srand(1);
-   // TODO: Fill in euclidean_distance_matrix_measured using ranging algorithm
+   if ((argc == 2) && (strcmp(argv[1], "--benchmark") == 0))
+      return run_benchmark();
+   if (argc != 4)
+   {
+      printf("Usage: %s <device_positions_mm.txt> <measured_ranges_mm.txt> <output_directory>\n", argv[0]);
+      printf("       %s --benchmark\n", argv[0]);
+      printf("Solves the TX/RX antenna delays only; every calibration record carries the default range bias table\n");
+      return 1;
+   }
 
-   // Carry out the antenna delay estimation algorithm some number of times
-   for (int i = 0; i < NUM_REFINEMENT_ITERATIONS; ++i)
+   // Load the surveyed device positions and the time-of-flight measurements collected between every pair of devices
+   static double positions_mm[MAX_CALIBRATION_DEVICES][3];
+   const int num_devices = read_device_positions(argv[1], positions_mm);
+   if (num_devices < MIN_CALIBRATION_DEVICES)
+   {
+      printf("ERROR: Unable to read the positions of at least %d devices from %s\n", MIN_CALIBRATION_DEVICES, argv[1]);
+      return 1;
+   }
+   double *actual_tof_ns = compute_actual_tof((const double (*)[3])positions_mm, num_devices);
+   calibration_problem_t *problems = actual_tof_ns ? allocate_problems(NUM_CALIBRATION_PROBLEMS, num_devices, actual_tof_ns) : NULL;
+   if (!problems)
    {
-      populate_candidate_delay_estimates(i);
-      evaluate_candidate_delay_estimates();
+      printf("ERROR: Unable to allocate calibration data for %d devices\n", num_devices);
+      free(actual_tof_ns);
+      return 1;
+   }
+   if (!read_measured_distances(argv[2], problems, num_devices))
+   {
+      printf("ERROR: Unable to read 1 or %d %dx%d matrices of measured ranges from %s\n", NUM_CALIBRATION_PROBLEMS, num_devices, num_devices, argv[2]);
+      free_problems(problems);
+      free(actual_tof_ns);
+      return 1;
    }
 
-   // Print out the best calculated TX/RX antenna delays
-   printf("TX Antenna Delay: %llu\n", calculate_tx_antenna_delay(candidate_delay_estimates[0]));
-   printf("RX Antenna Delay: %llu\n", calculate_rx_antenna_delay(candidate_delay_estimates[0]));
-   return 0;
+   // Solve for the antenna delays of every device on each channel and antenna
+   solve_all_problems(problems, NUM_CALIBRATION_PROBLEMS, get_num_threads());
+   for (int i = 0; i < NUM_CALIBRATION_PROBLEMS; ++i)
+      if (!problems[i].success)
+      {
+         printf("ERROR: Measured pairs do not determine every antenna delay on channel index %d, antenna %d\n", i / NUM_ANTENNAS, i % NUM_ANTENNAS);
+         free_problems(problems);
+         free(actual_tof_ns);
+         return 1;
+      }
+
+   // Print out the calculated TX/RX antenna delays and store them in one calibration record per device
+   int result = 0;
+   if ((mkdir(argv[3], 0755) != 0) && (errno != EEXIST))
+   {
+      printf("ERROR: Unable to create output directory %s\n", argv[3]);
+      result = 1;
+   }
+   for (int device = 0; !result && (device < num_devices); ++device)
+   {
+      char file_name[4096];
+      printf("Device %d TX/RX Antenna Delays:", device);
+      for (int i = 0; i < NUM_CALIBRATION_PROBLEMS; ++i)
+         printf(" %u/%u", calculate_tx_antenna_delay(problems[i].delays_ns[device]), calculate_rx_antenna_delay(problems[i].delays_ns[device]));
+      printf("\n");
+      snprintf(file_name, sizeof(file_name), "%s/calibration_%d.bin", argv[3], device);
+      if (!write_calibration_record(file_name, problems, device))
+      {
+         printf("ERROR: Unable to write calibration record to %s\n", file_name);
+         result = 1;
+      }
+   }
+   free_problems(problems);
+   free(actual_tof_ns);
+   return result;
 }
@@ -29,6 +29,7 @@ MAINTENANCE_DATA_SERVICE_UUID = 'd68c3163-a23f-ee90-0c45-5231395e5d2e'
 MAINTENANCE_NEW_EXPERIMENT = 0x01
 MAINTENANCE_DELETE_EXPERIMENT = 0x02
 MAINTENANCE_DOWNLOAD_LOG = 0x03
+MAINTENANCE_LOAD_CALIBRATION = 0x04
 MAINTENANCE_DOWNLOAD_COMPLETE = 0xFF
 
 FIND_MY_TOTTAG_ACTIVATION_SECONDS = 10
@@ -39,6 +40,16 @@ STORAGE_TYPE_VOLTAGE = 1
 STORAGE_TYPE_CHARGING_EVENT = 2
 STORAGE_TYPE_MOTION = 3
 STORAGE_TYPE_RANGES = 4
+STORAGE_TYPE_TELEMETRY = 5
+RANGE_DATUM_LENGTH = 4  # Set to 5 for firmware built with RANGE_OUTPUT_QUALITY
+NUM_ANTENNAS = 3
+NUM_CALIBRATED_CHANNELS = 2
+RANGE_BIAS_TABLE_LENGTH = 34
+CALIBRATION_DETAILS_LENGTH = NUM_CALIBRATED_CHANNELS * NUM_ANTENNAS * (4 + RANGE_BIAS_TABLE_LENGTH)
+MAX_TELEMETRY_DATA_LENGTH = 128
+TELEMETRY_COUNTERS_FORMATS = { 1: '<3I3I' + str(NUM_ANTENNAS+1) + 'I3I',
+                               2: '<3I3I' + str(NUM_ANTENNAS+1) + 'I4I' }
+assert all(1 + 4 + 2*struct.calcsize(counters_format) <= MAX_TELEMETRY_DATA_LENGTH for counters_format in TELEMETRY_COUNTERS_FORMATS.values())
 
 BATTERY_CODES = defaultdict(lambda: 'Unknown Battery Event')
 BATTERY_CODES[1] = 'Plugged'
@@ -113,11 +124,28 @@ def unpack_experiment_details(data):
       'labels': experiment_struct[(5+6*MAX_NUM_DEVICES):],
    }
 
+def unpack_telemetry_counters(version, data):
+   counters = struct.unpack(TELEMETRY_COUNTERS_FORMATS[version], data)
+   unpacked = {
+      'rx_timeouts': { 'schedule': counters[0], 'ranging': counters[1], 'status': counters[2] },
+      'tx_failures': counters[3],
+      'collisions': counters[4],
+      'schedule_misses': counters[5],
+      'peers_ranged': list(counters[6:7+NUM_ANTENNAS]),
+      'max_event_latency_us': counters[7+NUM_ANTENNAS],
+      'mean_event_latency_us': counters[8+NUM_ANTENNAS],
+      'wakeup_margin_us': counters[9+NUM_ANTENNAS],
+   }
+   if version >= 2:
+      unpacked['radio_on_time_us'] = counters[10+NUM_ANTENNAS]
+   return unpacked
+
 def process_tottag_data(from_uid, storage_directory, details, data):
    uid_to_labels = defaultdict(lambda: 'Unknown')
    for i in range(details['num_devices']):
       label = details['labels'][i].decode().rstrip('\x00')
-      uid_to_labels[int(details['uids'][i][0])] = label if label else details['uids'][i][0]
+      device_id = int(details['uids'][i][0]) | (int(details['uids'][i][1]) << 8)
+      uid_to_labels[device_id] = label if label else device_id
    i = 0
    log_data = defaultdict(dict)
    while i < len(data):
@@ -132,10 +160,22 @@ def process_tottag_data(from_uid, storage_directory, details, data):
          log_data[timestamp]['m'] = data[i+5] > 0
          i += 6
       elif data[i] == STORAGE_TYPE_RANGES:
+         timestamp = (timestamp[0] + (struct.unpack('<H', data[i+5:i+7])[0] / 1000.0),)
          log_data[timestamp]['r'] = {}
-         for j in range(data[i+5]):
-            log_data[timestamp]['r'][uid_to_labels[data[i+6+(j*3)]]] = struct.unpack('<h', data[i+7+(j*3):i+9+(j*3)])
-         i += 6 + data[i+5]*3
+         for j in range(data[i+7]):
+            device_id, range_mm = struct.unpack('<Hh', data[i+8+(j*RANGE_DATUM_LENGTH):i+12+(j*RANGE_DATUM_LENGTH)])
+            log_data[timestamp]['r'][uid_to_labels[device_id]] = (range_mm,)
+         i += 8 + data[i+7]*RANGE_DATUM_LENGTH
+      elif data[i] == STORAGE_TYPE_TELEMETRY:
+         version = data[i+5]
+         if version not in TELEMETRY_COUNTERS_FORMATS:
+            print('Unable to parse telemetry format version', version, '...ignoring remaining log data')
+            break
+         counters_length = struct.calcsize(TELEMETRY_COUNTERS_FORMATS[version])
+         log_data[timestamp]['telemetry'] = { 'rounds': struct.unpack('<I', data[i+6:i+10])[0],
+                                              'round': unpack_telemetry_counters(version, data[i+10:i+10+counters_length]),
+                                              'total': unpack_telemetry_counters(version, data[i+10+counters_length:i+10+2*counters_length]) }
+         i += 10 + 2*counters_length
    log_data = [dict({'t': ts}, **datum) for ts, datum in log_data.items()]
    with open(os.path.join(storage_directory, uid_to_labels[from_uid] + '.pkl'), 'wb') as file:
       pickle.dump(dict(log_data), file, protocol=pickle.HIGHEST_PROTOCOL)
@@ -157,6 +197,7 @@ class TotTagBLE(threading.Thread):
                           'NEW_EXPERIMENT': self.create_new_experiment,
                           'GET_EXPERIMENT': self.retrieve_experiment,
                           'DELETE_EXPERIMENT': self.delete_experiment,
+                          'LOAD_CALIBRATION': self.load_calibration,
                           'DOWNLOAD': self.download_logs,
                           'DOWNLOAD_DONE': self.download_logs_done }
       self.storage_directory = get_download_directory()
@@ -310,6 +351,20 @@ class TotTagBLE(threading.Thread):
       except Exception:
          self.result_queue.put_nowait(('ERROR', ('TotTag Error', 'Unable to delete scheduled deployment from TotTag')))
 
+   async def load_calibration(self):
+      calibration_file = await self.command_queue.get()
+      self.result_queue.put_nowait(('RETRIEVING', True))
+      try:
+         with open(calibration_file, 'rb') as file:
+            calibration_details = file.read()
+         if len(calibration_details) != CALIBRATION_DETAILS_LENGTH:
+            raise ValueError('Invalid calibration record length')
+         await self.connected_device.write_gatt_char(MAINTENANCE_COMMAND_SERVICE_UUID, struct.pack('B', MAINTENANCE_LOAD_CALIBRATION) + calibration_details, True)
+         self.result_queue.put_nowait(('CALIBRATED', True))
+      except Exception:
+         self.result_queue.put_nowait(('ERROR', ('TotTag Error', 'Unable to load calibration record ' + calibration_file + ' onto TotTag')))
+      self.command_queue.task_done()
+
    async def download_logs(self):
       self.storage_directory = await self.command_queue.get()
       try:
@@ -328,7 +383,7 @@ class TotTagBLE(threading.Thread):
          self.result_queue.put_nowait(('DOWNLOADED', True))
          await self.connected_device.stop_notify(MAINTENANCE_DATA_SERVICE_UUID)
          if self.data_index == self.data_length:
-            process_tottag_data(int(self.connected_device.address.split[':'][-1]), self.storage_directory, self.data_details, self.data)
+            process_tottag_data(int(''.join(self.connected_device.address.split(':')[-2:]), 16), self.storage_directory, self.data_details, self.data)
       except Exception:
          self.result_queue.put_nowait(('ERROR', ('TotTag Error', 'Unable to write log file to ' + self.storage_directory)))
 
@@ -394,6 +449,7 @@ class TotTagGUI(tk.Frame):
       ttk.Button(self.operations_bar, text="Get Scheduled Deployment Details", command=partial(ble_issue_command, self.event_loop, self.ble_command_queue, 'GET_EXPERIMENT'), state=['disabled']).grid(row=6, sticky=tk.W+tk.E)
       ttk.Button(self.operations_bar, text="Cancel Scheduled Pilot Deployment", command=self._delete_experiment, state=['disabled']).grid(row=7, sticky=tk.W+tk.E)
       ttk.Button(self.operations_bar, text="Download Deployment Logs", command=self._download_logs, state=['disabled']).grid(row=8, sticky=tk.W+tk.E)
+      ttk.Button(self.operations_bar, text="Load Antenna Calibration", command=self._load_calibration, state=['disabled']).grid(row=9, sticky=tk.W+tk.E)
 
       # Create the workspace canvas
       self.canvas = tk.Frame(self)
@@ -427,6 +483,12 @@ class TotTagGUI(tk.Frame):
       ttk.Button(prompt_area, text="Yes", command=partial(ble_issue_command, self.event_loop, self.ble_command_queue, 'DELETE_EXPERIMENT')).grid(column=1, row=1)
       ttk.Button(prompt_area, text="No", command=partial(self._clear_canvas_with_prompt)).grid(column=2, row=1)
 
+   def _load_calibration(self):
+      calibration_file = filedialog.askopenfilename(parent=self, title='Choose TotTag Calibration Record', filetypes=[('Calibration Records', '*.bin'), ('All Files', '*')])
+      if calibration_file:
+         ble_issue_command(self.event_loop, self.ble_command_queue, 'LOAD_CALIBRATION')
+         ble_issue_command(self.event_loop, self.ble_command_queue, calibration_file)
+
    def _download_logs(self):
       self._clear_canvas()
       prompt_area = tk.Frame(self.canvas)
@@ -640,7 +702,7 @@ class TotTagGUI(tk.Frame):
       self.txt_area['state'] = tk.NORMAL
       txt_string = 'Ranges to %d devices:\n'%data[0]
       for i in range(data[0]):
-         txt_string += '   0x%02X: %d mm\n'%(data[(3*i)+1], struct.unpack('<H', data[(3*i)+2:(3*i)+4])[0])
+         txt_string += '   0x%04X: %d mm\n'%struct.unpack('<HH', data[(RANGE_DATUM_LENGTH*i)+1:(RANGE_DATUM_LENGTH*i)+5])
       self.txt_area.insert(tk.INSERT, txt_string)
       self.txt_area.see(tk.END)
       self.txt_area['state'] = tk.DISABLED
@@ -746,6 +808,9 @@ class TotTagGUI(tk.Frame):
          elif key == 'DELETED':
             self._clear_canvas()
             tk.Label(self.canvas, text="Deployment was successfully canceled!").pack(fill=tk.BOTH, expand=True)
+         elif key == 'CALIBRATED':
+            self._clear_canvas()
+            tk.Label(self.canvas, text="Antenna calibration was successfully loaded!").pack(fill=tk.BOTH, expand=True)
          elif key == 'RANGES':
             self._range_received(data)
          elif key == 'LOGDATA':